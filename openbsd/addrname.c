@@ -0,0 +1,228 @@
+/*
+ * addrname: numeric address formatters
+ *
+ * The *_r functions write into a caller supplied buffer of at least
+ * ADDRNAMELEN bytes and return it, so a caller may format several
+ * addresses for one printf.  They never allocate and never consult the
+ * resolver; the only outside help is ifcache_name() for IPv6 scopes and
+ * link_print() for AF_LINK.  Kept apart from show.c so that
+ * regress/addrbench can time them on Linux.
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include <net/route.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "externs.h"
+
+/* Count bits without branches (SWAR). */
+static inline int
+popcount32(u_int32_t v)
+{
+	v = v - ((v >> 1) & 0x55555555);
+	v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+	v = (v + (v >> 4)) & 0x0f0f0f0f;
+	return ((v * 0x01010101) >> 24);
+}
+
+/* A mask word is contiguous when its complement is of the form 0..01..1 */
+#define NONCONTIG32(w)	((~(w) & (~(w) + 1)) != 0)
+
+/*
+ * Return the prefix length of a netmask sockaddr of family af.
+ * Kernel masks may be shorter than a full sockaddr; missing bytes are 0.
+ * A NULL mask means a host route.  If illegal is not NULL it is set when
+ * the mask has holes, in which case the bit count is still returned.
+ */
+int
+mask_prefixlen(int af, struct sockaddr *mask, int *illegal)
+{
+	u_int32_t w[4] = { 0, 0, 0, 0 };
+	size_t off, len;
+	int bad;
+
+	switch (af) {
+	case AF_INET:
+		if (mask == NULL)
+			return (32);
+		off = offsetof(struct sockaddr_in, sin_addr);
+		len = sizeof(struct in_addr);
+		break;
+	case AF_INET6:
+		if (mask == NULL)
+			return (128);
+		off = offsetof(struct sockaddr_in6, sin6_addr);
+		len = sizeof(struct in6_addr);
+		break;
+	default:
+		return (-1);
+	}
+	if (mask->sa_len <= off)
+		len = 0;
+	else if (mask->sa_len - off < len)
+		len = mask->sa_len - off;
+	memcpy(w, (char *)mask + off, len);
+
+	w[0] = ntohl(w[0]);
+	w[1] = ntohl(w[1]);
+	w[2] = ntohl(w[2]);
+	w[3] = ntohl(w[3]);
+
+	if (illegal) {
+		bad = NONCONTIG32(w[0]) | NONCONTIG32(w[1]) |
+		    NONCONTIG32(w[2]) | NONCONTIG32(w[3]);
+		bad |= (w[1] != 0) & (w[0] != 0xffffffff);
+		bad |= (w[2] != 0) & (w[1] != 0xffffffff);
+		bad |= (w[3] != 0) & (w[2] != 0xffffffff);
+		*illegal = bad;
+	}
+
+	return (popcount32(w[0]) + popcount32(w[1]) + popcount32(w[2]) +
+	    popcount32(w[3]));
+}
+
+/*
+ * inet_ntop(3) an IPv6 sockaddr, recovering a KAME embedded scope and
+ * appending it as %ifname the way getnameinfo(NI_NUMERICHOST) would.
+ */
+char *
+inet6_ntop_r(struct sockaddr_in6 *sa6, char *buf, size_t len)
+{
+	struct sockaddr_in6 sin6;
+	const char *ifname;
+	size_t n;
+
+	memset(&sin6, 0, sizeof(sin6));
+	memcpy(&sin6, sa6, sa6->sin6_len < sizeof(sin6) ?
+	    sa6->sin6_len : sizeof(sin6));
+	in6_fillscopeid(&sin6);
+
+	if (inet_ntop(AF_INET6, &sin6.sin6_addr, buf, len) == NULL) {
+		buf[0] = '\0';
+		return (buf);
+	}
+	if (sin6.sin6_scope_id != 0) {
+		n = strlen(buf);
+		if ((ifname = ifcache_name(sin6.sin6_scope_id)) != NULL)
+			snprintf(buf + n, len - n, "%%%s", ifname);
+		else
+			snprintf(buf + n, len - n, "%%%u", sin6.sin6_scope_id);
+	}
+	return (buf);
+}
+
+char *
+routename_r(struct sockaddr *sa, char *buf, size_t len)
+{
+	switch (sa->sa_family) {
+	case AF_INET:
+		if (sa->sa_len == 0)
+			strlcpy(buf, "0.0.0.0", len);
+		else if (inet_ntop(AF_INET, &((struct sockaddr_in *)sa)->
+		    sin_addr, buf, len) == NULL)
+			buf[0] = '\0';
+		break;
+	case AF_INET6:
+		inet6_ntop_r((struct sockaddr_in6 *)sa, buf, len);
+		break;
+	case AF_LINK:
+		strlcpy(buf, link_print(sa), len);
+		break;
+	case AF_UNSPEC:
+		if (sa->sa_len == sizeof(struct sockaddr_rtlabel)) {
+			strlcpy(buf, ((struct sockaddr_rtlabel *)sa)->sr_label,
+			    len);
+			break;
+		}
+		/* FALLTHROUGH */
+	default:
+		snprintf(buf, len, "(%d) %s", sa->sa_family, any_ntoa(sa));
+		break;
+	}
+	return (buf);
+}
+
+/*
+ * Format the network whose address is given, as address/prefixlen.
+ * The address is assumed to be that of a net or subnet, not a host.
+ */
+char *
+netname_r(struct sockaddr *sa, struct sockaddr *mask, char *buf, size_t len)
+{
+	int plen, illegal;
+	size_t n;
+
+	switch (sa->sa_family) {
+	case AF_INET:
+	case AF_INET6:
+		routename_r(sa, buf, len);
+		plen = mask_prefixlen(sa->sa_family, mask, &illegal);
+		/* This will warn us if the kernel supplies an insane mask */
+		if (illegal)
+			printf("%% netname: illegal prefixlen\n");
+		n = strlen(buf);
+		snprintf(buf + n, len - n, "/%d", plen);
+		break;
+	case AF_LINK:
+		strlcpy(buf, link_print(sa), len);
+		break;
+	default:
+		snprintf(buf, len, "af %d: %s", sa->sa_family, any_ntoa(sa));
+		break;
+	}
+	return (buf);
+}
+
+void
+in6_fillscopeid(struct sockaddr_in6 *sin6)
+{
+	if ((IN6_IS_ADDR_LINKLOCAL(&sin6->sin6_addr) ||
+	    IN6_IS_ADDR_MC_LINKLOCAL(&sin6->sin6_addr) ||
+	    IN6_IS_ADDR_MC_INTFACELOCAL(&sin6->sin6_addr)) &&
+	    sin6->sin6_scope_id == 0) {
+		sin6->sin6_scope_id =
+		    ntohs(*(u_int16_t *)&sin6->sin6_addr.s6_addr[2]);
+		sin6->sin6_addr.s6_addr[2] = sin6->sin6_addr.s6_addr[3] = 0;
+	}
+}
+
+void
+in6_clearscopeid(struct sockaddr_in6 *sin6)
+{
+	if ((IN6_IS_ADDR_LINKLOCAL(&sin6->sin6_addr) ||
+	    IN6_IS_ADDR_MC_LINKLOCAL(&sin6->sin6_addr) ||
+	    IN6_IS_ADDR_MC_INTFACELOCAL(&sin6->sin6_addr)) &&
+	    *(u_int16_t *)&sin6->sin6_addr.s6_addr[2] == 0 &&
+	    sin6->sin6_scope_id) {
+		*(u_int16_t *)&sin6->sin6_addr.s6_addr[2] =
+		    htons(sin6->sin6_scope_id & 0xffff);
+		sin6->sin6_scope_id = 0;
+	}
+}
+
+static const char hexlist[] = "0123456789abcdef";
+
+char *
+any_ntoa(const struct sockaddr *sa)
+{
+	static char obuf[240];
+	const char *in = sa->sa_data;
+	char *out = obuf;
+	int len = sa->sa_len - offsetof(struct sockaddr, sa_data);
+
+	*out++ = 'Q';
+	do {
+		*out++ = hexlist[(*in >> 4) & 15];
+		*out++ = hexlist[(*in++)    & 15];
+		*out++ = '.';
+	} while (--len > 0 && (out + 3) < &obuf[sizeof(obuf) - 1]);
+	out[-1] = '\0';
+	return (obuf);
+}
@@ -57,15 +57,17 @@
 #include <limits.h>
 #include <ifaddrs.h>
 #include "externs.h"
+#include "json.h"
 
 /* ROUNDUP() is nasty, but it is identical to what's in the kernel. */
 #define ROUNDUP(a) \
 	((a) > 0 ? (1 + (((a) - 1) | (sizeof(long) - 1))) : sizeof(long))
 #define ADVANCE(x, n) (x += ROUNDUP((n)->sa_len))
 
-int rtget(struct sockaddr_inarp **, struct sockaddr_dl **, int, int, int);
+int rtget(struct sockaddr_inarp **, struct sockaddr_dl **,
+	struct sockaddr_dl **, int, int, int);
 int arpdelete(const char *, const char *);
-int arpsearch(FILE *, char *, in_addr_t addr, void (*action)(FILE *, char *,
+void arpsearch(FILE *, char *, void (*action)(FILE *, char *,
 	struct sockaddr_dl *sdl, struct sockaddr_inarp *sin,
 	struct rt_msghdr *rtm));
 void print_entry(FILE *, char *, struct sockaddr_dl *sdl,
@@ -75,6 +77,9 @@ void nuke_entry(struct sockaddr_dl *sdl,
 void conf_arp_entry(FILE *, char *, struct sockaddr_dl *,
 	struct sockaddr_inarp *, struct rt_msghdr *);
 int getinetaddr(const char *, struct in_addr *);
+static void print_entry_json(const char *, const char *,
+	struct sockaddr_dl *, struct sockaddr_inarp *, struct rt_msghdr *,
+	time_t);
 static int getsocket(void);
 int rtmsg_arp(int, int, int, int);
 
@@ -91,6 +96,8 @@ static int
 getsocket(void)
 {
 	socklen_t len = sizeof(cli_rtable);
+	u_int msgfilter = ROUTE_FILTER(RTM_ADD) | ROUTE_FILTER(RTM_DELETE) |
+	    ROUTE_FILTER(RTM_GET);
 
 	if (s >= 0)
 		return s;
@@ -103,6 +110,12 @@ getsocket(void)
 		printf("%% getsocket: setsockopt: %s\n", strerror(errno));
 		return -1;
 	}
+	/* only replies to our own requests are of interest */
+	if (setsockopt(s, PF_ROUTE, ROUTE_MSGFILTER, &msgfilter,
+	    sizeof(msgfilter)) < 0) {
+		printf("%% getsocket: setsockopt: %s\n", strerror(errno));
+		return -1;
+	}
 
 	return s;
 }
@@ -113,13 +126,18 @@ static struct sockaddr_dl	blank_sdl = { sizeof(blank_sdl), AF_LINK }, sdl_m;
 static struct sockaddr_dl	ifp_m = { sizeof(ifp_m), AF_LINK };
 static time_t			expire_time;
 
+/*
+ * Look up the route for sin_m with RTM_GET.  The returned destination,
+ * interface and, if gatep is not NULL, link layer gateway point into
+ * m_rtmsg.
+ */
 int
 rtget(struct sockaddr_inarp **sinp, struct sockaddr_dl **sdlp,
-    int flags, int doing_proxy, int export_only)
+    struct sockaddr_dl **gatep, int flags, int doing_proxy, int export_only)
 {
 	struct rt_msghdr *rtm = &(m_rtmsg.m_rtm);
 	struct sockaddr_inarp *sin = NULL;
-	struct sockaddr_dl *sdl = NULL;
+	struct sockaddr_dl *sdl = NULL, *gate = NULL;
 	struct sockaddr *sa;
 	char *cp;
 	unsigned int i;
@@ -136,6 +154,10 @@ rtget(struct sockaddr_inarp **sinp, struct sockaddr_dl **sdlp,
 				case RTA_DST:
 					sin = (struct sockaddr_inarp *)sa;
 					break;
+				case RTA_GATEWAY:
+					if (sa->sa_family == AF_LINK)
+						gate = (struct sockaddr_dl *)sa;
+					break;
 				case RTA_IFP:
 					sdl = (struct sockaddr_dl *)sa;
 					break;
@@ -152,6 +174,8 @@ rtget(struct sockaddr_inarp **sinp, struct sockaddr_dl **sdlp,
 
 	*sinp = sin;
 	*sdlp = sdl;
+	if (gatep)
+		*gatep = gate;
 
 	return (0);
 }
@@ -242,8 +266,8 @@ arpset(int argc, char *argv[])
 	}
 
 tryagain:
-	if (rtget(&sin, &sdl, flags, doing_proxy, export_only) < 0) {
-		printf("%% %s\n", host);
+	if (rtget(&sin, &sdl, NULL, flags, doing_proxy, export_only) != 0) {
+		printf("%% arpset: no route to %s\n", host);
 		return (1);
 	}
 	if (sin->sin_addr.s_addr == sin_m.sin_addr.s_addr) {
@@ -287,6 +311,8 @@ overwrite:
 #define W_LL	17
 #define W_IF	6
 
+static struct json arpjson;	/* print_entry() in output json mode */
+
 /*
  * Display an individual arp entry
  */
@@ -294,26 +320,49 @@ int
 arpget(const char *host)
 {
 	struct sockaddr_inarp *sin;
-	int found_entry;
+	struct sockaddr_dl *sdl, *gate;
+	struct rt_msghdr *rtm;
+	char addr[INET_ADDRSTRLEN];
 
 	sin = &sin_m;
+	rtm = &m_rtmsg.m_rtm;
+	if (getsocket() < 0)
+		return (1);
 	sin_m = blank_sin;		/* struct copy */
 	if (getinetaddr(host, &sin->sin_addr) == -1) {
 		printf("%% arpget: getinetaddr: failure %s\n", strerror(errno));
 		return (1);
 	}
 
-	printf("%-*.*s %-*.*s %*.*s %-10.10s %5s\n",
-	    W_ADDR, W_ADDR, "Host", W_LL, W_LL, "Ethernet Address",
-	    W_IF, W_IF, "Netif", "Expire", "Flags");
+	if (!json_output)
+		printf("%-*.*s %-*.*s %*.*s %-10.10s %5s\n",
+		    W_ADDR, W_ADDR, "Host", W_LL, W_LL, "Ethernet Address",
+		    W_IF, W_IF, "Netif", "Expire", "Flags");
 
-	found_entry = arpsearch(NULL, "", sin->sin_addr.s_addr, print_entry);
-	if (found_entry == 0) {
-		printf("%% %-*.*s no entry\n", W_ADDR, W_ADDR,
-		    inet_ntoa(sin->sin_addr));
-		return (1);
+	/* ask the kernel for this one host, then for a published entry */
+tryagain:
+	if (rtget(&sin, &sdl, &gate, 0, 0, 0) == 0 &&
+	    sin->sin_addr.s_addr == sin_m.sin_addr.s_addr &&
+	    (rtm->rtm_flags & RTF_LLINFO) && gate != NULL) {
+		ifcache_sync();
+		if (json_output) {
+			json_begin(&arpjson, stdout);
+			json_array(&arpjson, NULL);
+		}
+		print_entry(NULL, "", gate, sin, rtm);
+		if (json_output)
+			json_end(&arpjson);
+		return (0);
 	}
-	return (0);
+	if (!(sin_m.sin_other & SIN_PROXY)) {
+		sin_m.sin_other = SIN_PROXY;
+		goto tryagain;
+	}
+
+	if (inet_ntop(AF_INET, &sin_m.sin_addr, addr, sizeof(addr)) == NULL)
+		addr[0] = '\0';
+	printf("%% %-*.*s no entry\n", W_ADDR, W_ADDR, addr);
+	return (1);
 }
 
 /*
@@ -324,7 +373,7 @@ arpdelete(const char *host, const char *info)
 {
 	struct sockaddr_inarp *sin;
 	struct rt_msghdr *rtm;
-	struct sockaddr_dl *sdl;
+	struct sockaddr_dl *sdl = NULL;
 	int doing_proxy = 0, export_only = 0;
 
 	sin = &sin_m;
@@ -338,8 +387,8 @@ arpdelete(const char *host, const char *info)
 	if (getinetaddr(host, &sin->sin_addr) == -1)
 		return (1);
 tryagain:
-	if (rtget(&sin, &sdl, 0, doing_proxy, export_only) < 0) {
-		printf("%% %s\n", host);
+	if (rtget(&sin, &sdl, NULL, 0, doing_proxy, export_only) != 0) {
+		printf("%% arpdelete: can't locate %s\n", host);
 		return (1);
 	}
 	if (sin->sin_addr.s_addr == sin_m.sin_addr.s_addr) {
@@ -379,10 +428,11 @@ delete:
 }
 
 /*
- * Search the entire arp table, and do some action on matching entries.
+ * Walk the entire arp table, and do some action on each entry.
+ * Single entries are looked up with rtget() instead.
  */
-int
-arpsearch(FILE *output, char *delim, in_addr_t addr, void (*action)
+void
+arpsearch(FILE *output, char *delim, void (*action)
     (FILE *output, char *delim, struct sockaddr_dl *sdl,
     struct sockaddr_inarp *sin, struct rt_msghdr *rtm))
 {
@@ -391,11 +441,11 @@ arpsearch(FILE *output, char *delim, in_addr_t addr, void (*action)
 	struct sockaddr_inarp *sin;
 	struct sockaddr_dl *sdl;
 	struct rtdump *rtdump;
-	int found_entry = 0;
 
-	rtdump = getrtdump(AF_INET, RTF_LLINFO, 0);
+	rtdump = getrtdump(AF_INET, RTF_LLINFO, cli_rtable);
 	if (rtdump == NULL)
-		return 0;
+		return;
+	ifcache_sync();
 	for (next = rtdump->buf; next < rtdump->lim; next += rtm->rtm_msglen)
 	{
 		rtm = (struct rt_msghdr *)next;
@@ -403,15 +453,9 @@ arpsearch(FILE *output, char *delim, in_addr_t addr, void (*action)
 			continue;
 		sin = (struct sockaddr_inarp *)(next + rtm->rtm_hdrlen);
 		sdl = (struct sockaddr_dl *)(sin + 1);
-		if (addr) {
-			if (addr != sin->sin_addr.s_addr)
-				continue;
-			found_entry = 1;
-		}
 		(*action)(output, delim, sdl, sin, rtm);
 	}
 	freertdump(rtdump);
-	return(found_entry);
 }
 
 /*
@@ -420,36 +464,64 @@ arpsearch(FILE *output, char *delim, in_addr_t addr, void (*action)
 void
 arpdump(void)
 {
+	if (json_output) {
+		json_begin(&arpjson, stdout);
+		json_array(&arpjson, NULL);
+		arpsearch(NULL, "", print_entry);
+		json_end(&arpjson);
+		return;
+	}
+
 	printf("%-*.*s %-*.*s %*.*s %-10.10s %5s\n",
 	    W_ADDR, W_ADDR, "Host", W_LL, W_LL, "Ethernet Address",
 	    W_IF, W_IF, "Netif", "Expire", "Flags");
 
-	arpsearch(NULL, "", 0, print_entry);
+	arpsearch(NULL, "", print_entry);
 }
 
+/*
+ * Print static ARP entries from a RTF_LLINFO dump of any address family
+ */
 void
-conf_arp(FILE *output, char *delim)
+conf_arp(FILE *output, char *delim, struct rtdump *rtdump)
 {
-	arpsearch(output, delim, 0, conf_arp_entry);
+	char *next;
+	struct rt_msghdr *rtm;
+	struct sockaddr_inarp *sin;
+
+	if (rtdump == NULL)
+		return;
+	for (next = rtdump->buf; next < rtdump->lim; next += rtm->rtm_msglen) {
+		rtm = (struct rt_msghdr *)next;
+		if (rtm->rtm_version != RTM_VERSION)
+			continue;
+		sin = (struct sockaddr_inarp *)(next + rtm->rtm_hdrlen);
+		if (sin->sin_family != AF_INET)
+			continue;
+		conf_arp_entry(output, delim, (struct sockaddr_dl *)(sin + 1),
+		    sin, rtm);
+	}
 }
 
 void
 conf_arp_entry(FILE *output, char *delim, struct sockaddr_dl *sdl,
     struct sockaddr_inarp *sin, struct rt_msghdr *rtm)
 {
-	char *host;
+	char host[INET_ADDRSTRLEN], lladdr[ETHER_STRLEN];
 
         if (output == NULL) {
 		printf("%% conf_arp_entry: unprepared\n");
 		return;
 	}
 
-	host = inet_ntoa(sin->sin_addr);
-
 	if ((rtm->rtm_flags & RTF_LOCAL) || rtm->rtm_rmx.rmx_expire != 0)
 		return;
 
-	fprintf(output, "%s%s %s", delim, host, ether_str(sdl));
+	if (inet_ntop(AF_INET, &sin->sin_addr, host, sizeof(host)) == NULL)
+		return;
+
+	fprintf(output, "%s%s %s", delim, host,
+	    ether_str_r(sdl, lladdr, sizeof(lladdr)));
 	if (rtm->rtm_flags & RTF_PERMANENT_ARP)
 		fputs(" permanent", output);
 	if (rtm->rtm_flags & RTF_ANNOUNCE)
@@ -457,6 +529,40 @@ conf_arp_entry(FILE *output, char *delim, struct sockaddr_dl *sdl,
 	fputs("\n", output);
 }
 
+/*
+ * One arp entry as a JSON record; expire is the seconds left for a
+ * dynamic entry and 0 otherwise.
+ */
+static void
+print_entry_json(const char *host, const char *lladdr,
+    struct sockaddr_dl *sdl, struct sockaddr_inarp *sin,
+    struct rt_msghdr *rtm, time_t now)
+{
+	const char *state;
+	time_t expire = 0;
+
+	if (rtm->rtm_flags & (RTF_PERMANENT_ARP|RTF_LOCAL))
+		state = "permanent";
+	else if (rtm->rtm_rmx.rmx_expire == 0)
+		state = "static";
+	else if (rtm->rtm_rmx.rmx_expire > now) {
+		state = "dynamic";
+		expire = rtm->rtm_rmx.rmx_expire - now;
+	} else
+		state = "expired";
+
+	json_object(&arpjson, NULL);
+	json_string(&arpjson, "host", host);
+	json_string(&arpjson, "lladdr", lladdr);
+	json_string(&arpjson, "interface", ifcache_name(sdl->sdl_index));
+	json_string(&arpjson, "state", state);
+	json_uint(&arpjson, "expire", expire);
+	json_bool(&arpjson, "local", rtm->rtm_flags & RTF_LOCAL);
+	json_bool(&arpjson, "proxy", sin->sin_other & SIN_PROXY);
+	json_bool(&arpjson, "published", rtm->rtm_flags & RTF_ANNOUNCE);
+	json_end(&arpjson);
+}
+
 /*
  * Display an arp entry
  */
@@ -464,7 +570,8 @@ void
 print_entry(FILE *output, char *delim, struct sockaddr_dl *sdl,
     struct sockaddr_inarp *sin, struct rt_msghdr *rtm)
 {
-	char ifix_buf[IFNAMSIZ], *ifname, *host;
+	const char *ifname;
+	char host[INET_ADDRSTRLEN], lladdr[ETHER_STRLEN];
 	int addrwidth, llwidth, ifwidth ;
 	struct timeval now;
 
@@ -475,15 +582,22 @@ print_entry(FILE *output, char *delim, struct sockaddr_dl *sdl,
 
 	gettimeofday(&now, 0);
 
-	host = inet_ntoa(sin->sin_addr);
+	if (inet_ntop(AF_INET, &sin->sin_addr, host, sizeof(host)) == NULL)
+		host[0] = '\0';
+	ether_str_r(sdl, lladdr, sizeof(lladdr));
+
+	if (json_output) {
+		print_entry_json(host, lladdr, sdl, sin, rtm, now.tv_sec);
+		return;
+	}
 
 	addrwidth = strlen(host);
 	if (addrwidth < W_ADDR)
 		addrwidth = W_ADDR;
-	llwidth = strlen(ether_str(sdl));
+	llwidth = strlen(lladdr);
 	if (W_ADDR + W_LL - addrwidth > llwidth)
 		llwidth = W_ADDR + W_LL - addrwidth;
-	ifname = if_indextoname(sdl->sdl_index, ifix_buf);
+	ifname = ifcache_name(sdl->sdl_index);
 	if (!ifname)
 		ifname = "?";
 	ifwidth = strlen(ifname);
@@ -491,7 +605,7 @@ print_entry(FILE *output, char *delim, struct sockaddr_dl *sdl,
 		ifwidth = W_ADDR + W_LL + W_IF - addrwidth - llwidth;
 
 	printf("%s%-*.*s %-*.*s %*.*s", delim, addrwidth, addrwidth, host,
-	    llwidth, llwidth, ether_str(sdl), ifwidth, ifwidth, ifname);
+	    llwidth, llwidth, lladdr, ifwidth, ifwidth, ifname);
 
 	if (rtm->rtm_flags & (RTF_PERMANENT_ARP|RTF_LOCAL))
 		printf(" %-10.10s", "permanent");
@@ -516,26 +630,45 @@ void
 nuke_entry(struct sockaddr_dl *sdl, struct sockaddr_inarp *sin,
     struct rt_msghdr *rtm)
 {
-	char ip[20];
+	char ip[INET_ADDRSTRLEN];
 
-	strlcpy(ip, inet_ntoa(sin->sin_addr), sizeof(ip));
-	arpdelete(ip, NULL);
+	if (inet_ntop(AF_INET, &sin->sin_addr, ip, sizeof(ip)) != NULL)
+		arpdelete(ip, NULL);
 }
 
 char *
 ether_str(struct sockaddr_dl *sdl)
 {
-	static char hbuf[NI_MAXHOST];
+	static char hbuf[ETHER_STRLEN];
+
+	return(ether_str_r(sdl, hbuf, sizeof(hbuf)));
+}
+
+/*
+ * Format a link layer address into buf, which should hold ETHER_STRLEN
+ */
+char *
+ether_str_r(struct sockaddr_dl *sdl, char *buf, size_t len)
+{
+	static const char hex[] = "0123456789abcdef";
 	u_char *cp;
+	char *p;
+	int i;
 
-	if (sdl->sdl_alen) {
-		cp = (u_char *)LLADDR(sdl);
-		snprintf(hbuf, sizeof(hbuf), "%02x:%02x:%02x:%02x:%02x:%02x",
-		    cp[0], cp[1], cp[2], cp[3], cp[4], cp[5]);
-	} else
-		snprintf(hbuf, sizeof(hbuf), "(incomplete)");
+	if (sdl->sdl_alen == 0 || len < sizeof("00:00:00:00:00:00")) {
+		strlcpy(buf, "(incomplete)", len);
+		return(buf);
+	}
 
-	return(hbuf);
+	cp = (u_char *)LLADDR(sdl);
+	for (i = 0, p = buf; i < 6; i++) {
+		*p++ = hex[cp[i] >> 4];
+		*p++ = hex[cp[i] & 0xf];
+		*p++ = ':';
+	}
+	p[-1] = '\0';
+
+	return(buf);
 }
 
 /* -1 error */
@@ -599,12 +732,16 @@ doit:
 	l = rtm->rtm_msglen;
 	rtm->rtm_seq = ++seq;
 	rtm->rtm_type = cmd;
-	if (write(s, (char *)&m_rtmsg, l) < 0)
+	if (write(s, (char *)&m_rtmsg, l) < 0) {
+		/* a lookup without any route is reported by the caller */
+		if (errno == ESRCH && cmd == RTM_GET)
+			return (-1);
 		if (errno != ESRCH || cmd != RTM_DELETE) {
 			printf("%% rtmsg_arp: writing to routing socket: %s\n",
 			    strerror(errno));
 			return (-1);
 		}
+	}
 
 	do {
 		l = read(s, (char *)&m_rtmsg, sizeof(m_rtmsg));
@@ -20,6 +20,8 @@
 
 int is_bridge(int, char *);
 int db_select_rtable_rtables(StringList *);
+u_int ifcache_generation(void);
+int rtdump_names(int, int, int, const char *, size_t, StringList *);
 
 int
 is_bridge(int s, char *brdg)
@@ -32,3 +34,16 @@ db_select_rtable_rtables(StringList *words)
 {
 	return -1;
 }
+
+u_int
+ifcache_generation(void)
+{
+	return 0;
+}
+
+int
+rtdump_names(int af, int flags, int tableid, const char *prefix,
+    size_t max, StringList *sl)
+{
+	return 0;
+}
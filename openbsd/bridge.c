@@ -761,22 +761,19 @@ bridge_cfg(int s, char *brdg, int type)
 }
 
 /*
- * hacked up bridge_list()
- *
- * conf() will ask us for a text list of interfaces filled into br_str
- *        except for ifpriority which will be filled in with "ifpriority"
- *	  as well since it returns multiple lines
- * show_int() will ask for SHOW_STPSTATE which has NULL br/str_len
+ * Fetch the member list of bridge brdg with SIOCBRDGIFS, growing the
+ * buffer until every member fits.  Returns the members, *nreq of them,
+ * to be released with free(), or NULL on failure.  A bridge without
+ * members yields an empty, non-NULL array.
  */
-int
-bridge_list(int s, char *brdg, char *delim, char *br_str, int str_len, int type)
+struct ifbreq *
+bridge_members(int s, char *brdg, u_int *nreq)
 {
-	struct ifbreq *reqp;
 	struct ifbifconf bifc;
-	u_int i, len = 8192;
-	int identified = 0;
-	char buf[256], *inbuf = NULL, *inb;
-	uint32_t v;
+	u_int len = 8192;
+	char *inbuf = NULL, *inb;
+
+	*nreq = 0;
 
 	while (1) {
 		strlcpy(bifc.ifbic_name, brdg, sizeof(bifc.ifbic_name));
@@ -784,128 +781,124 @@ bridge_list(int s, char *brdg, char *delim, char *br_str, int str_len, int type)
 		inb = realloc(inbuf, len);
 		if (inb == NULL) {
 			free(inbuf);
-			printf("%% bridge_list: malloc: %s\n", strerror(errno));
-			return(0);
+			printf("%% bridge_members: malloc: %s\n",
+			    strerror(errno));
+			return(NULL);
 		}
 		bifc.ifbic_buf = inbuf = inb;
 		if (ioctl(s, SIOCBRDGIFS, &bifc) < 0) {
 			if (errno != ENOTTY)
-				printf("%% bridge_list: SIOCBRDGIFS: %s\n",
+				printf("%% bridge_members: SIOCBRDGIFS: %s\n",
 				    strerror(errno));
 			free(inbuf);
-			return(0);
+			return(NULL);
 		}
-		if (bifc.ifbic_len + sizeof(*reqp) < len)
+		if (bifc.ifbic_len + sizeof(struct ifbreq) < len)
 			break;
 		len *= 2;
 	}
 
-	/* clear out br_str */
-	br_str[0] = '\0';
+	*nreq = bifc.ifbic_len / sizeof(struct ifbreq);
+	return(bifc.ifbic_req);
+}
 
-	for (i = 0; i < bifc.ifbic_len / sizeof(*reqp); i++) {
-		reqp = bifc.ifbic_req + i;
+/*
+ * Print the members of a bridge, as fetched by bridge_members(), which
+ * match type.  Name list types (MEMBER, STP, SPAN, NOLEARNING,
+ * NODISCOVER, BLOCKNONIP) go on one line led by delim; the others print
+ * one line per member, each led by delim.  With a NULL output only
+ * count.  Returns the number of members which matched.
+ */
+int
+bridge_list(struct ifbreq *req, u_int nreq, char *delim, int type,
+    FILE *output)
+{
+	struct ifbreq *reqp;
+	u_int i;
+	int identified = 0, match;
+	uint32_t v;
+
+	for (i = 0; i < nreq; i++) {
+		reqp = req + i;
 		switch (type) {
 		case CONF_IFPRIORITY:
-			if((reqp->ifbr_ifsflags & IFBIF_STP) &&
-			    (reqp->ifbr_priority != DEFAULT_IFPRIORITY)) {
-			/* rework flow at some point XXX */
-				snprintf(buf, sizeof(buf),
-				    "%sifpriority %s %u\n", delim,
+			match = (reqp->ifbr_ifsflags & IFBIF_STP) &&
+			    reqp->ifbr_priority != DEFAULT_IFPRIORITY;
+			if (match && output)
+				fprintf(output, "%sifpriority %s %u\n", delim,
 				    reqp->ifbr_ifsname, reqp->ifbr_priority);
-				strlcat(br_str, buf, str_len);
-				identified++;
-			}
 			break;
 		case CONF_IFCOST:
-			if((reqp->ifbr_ifsflags & IFBIF_STP) &&
-			(reqp->ifbr_path_cost != DEFAULT_IFCOST)) {
-			/* rework flow at some point XXX */
-				snprintf(buf, sizeof(buf),
-				    "%sifcost %s %u\n", delim,
+			match = (reqp->ifbr_ifsflags & IFBIF_STP) &&
+			    reqp->ifbr_path_cost != DEFAULT_IFCOST;
+			if (match && output)
+				fprintf(output, "%sifcost %s %u\n", delim,
 				    reqp->ifbr_ifsname, reqp->ifbr_path_cost);
-				strlcat(br_str, buf, str_len);
-				identified++;
-			}
 			break;
 		case SHOW_STPSTATE:
-			if (reqp->ifbr_ifsflags & IFBIF_STP) {
-				snprintf(buf, sizeof(buf),
-				    "%s%s: %s\n", delim, reqp->ifbr_ifsname,
+			match = reqp->ifbr_ifsflags & IFBIF_STP;
+			if (match && output)
+				fprintf(output, "%s%s: %s\n", delim,
+				    reqp->ifbr_ifsname,
 				    stpstates[reqp->ifbr_state]);
-				strlcat(br_str, buf, str_len);
-				identified++;
-			}
 			break;
-		case MEMBER:
-			if (reqp->ifbr_ifsname[0] != '\0') {
-				snprintf(buf, sizeof(buf), "%s ",
-				    reqp->ifbr_ifsname);
-				strlcat(br_str, buf, str_len);
-				identified++;
-			}
+		case PROTECTED:
+			match = reqp->ifbr_protected != 0;
+			if (!match || output == NULL)
+				break;
+			v = ffs(reqp->ifbr_protected);
+			fprintf(output, "%sprotect %s %u", delim,
+			    reqp->ifbr_ifsname, v);
+			while (++v < 32)
+				if ((1 << (v - 1)) & reqp->ifbr_protected)
+					fprintf(output, ",%u", v);
+			fputc('\n', output);
 			break;
+		case MEMBER:
+			match = reqp->ifbr_ifsname[0] != '\0';
+			goto name;
 		case NOLEARNING:
-			if (!(reqp->ifbr_ifsflags & IFBIF_LEARNING) &&
-			    !(reqp->ifbr_ifsflags & IFBIF_SPAN)) {
-				snprintf(buf, sizeof(buf), "%s ",
-				    reqp->ifbr_ifsname);
-				strlcat(br_str, buf, str_len);
-				identified++;
-			}
-			break;
+			match = !(reqp->ifbr_ifsflags & IFBIF_LEARNING) &&
+			    !(reqp->ifbr_ifsflags & IFBIF_SPAN);
+			goto name;
 		case NODISCOVER:
-			if (!(reqp->ifbr_ifsflags & IFBIF_DISCOVER) &&
-			    !(reqp->ifbr_ifsflags & IFBIF_SPAN)) {
-				snprintf(buf, sizeof(buf), "%s ",
-				    reqp->ifbr_ifsname);
-				strlcat(br_str, buf, str_len);
-				identified++;
-			}
-			break;
+			match = !(reqp->ifbr_ifsflags & IFBIF_DISCOVER) &&
+			    !(reqp->ifbr_ifsflags & IFBIF_SPAN);
+			goto name;
 		case BLOCKNONIP:
-			if (reqp->ifbr_ifsflags & IFBIF_BLOCKNONIP) {
-				snprintf(buf, sizeof(buf), "%s ",
-				    reqp->ifbr_ifsname);
-				strlcat(br_str, buf, str_len);
-				identified++;
-			}
-			break;
+			match = reqp->ifbr_ifsflags & IFBIF_BLOCKNONIP;
+			goto name;
 		case STP:
-			if (reqp->ifbr_ifsflags & IFBIF_STP) {
-				snprintf(buf, sizeof(buf), "%s ",
-				    reqp->ifbr_ifsname);
-				strlcat(br_str, buf, str_len);
-				identified++;
-			}
-			break;
+			match = reqp->ifbr_ifsflags & IFBIF_STP;
+			goto name;
 		case SPAN:
-			if (reqp->ifbr_ifsflags & IFBIF_SPAN) {
-				snprintf(buf, sizeof(buf), "%s ",
+			match = reqp->ifbr_ifsflags & IFBIF_SPAN;
+		name:
+			if (match && output)
+				fprintf(output, "%s %s",
+				    identified ? "" : delim,
 				    reqp->ifbr_ifsname);
-				strlcat(br_str, buf, str_len);
-				identified++;
-			}
 			break;
-		case PROTECTED:
-			if (reqp->ifbr_protected == 0)
-				break;
-			v = ffs(reqp->ifbr_protected);
-			snprintf(buf, sizeof(buf), "%sprotect %s %u", delim,
-			    reqp->ifbr_ifsname, v);
-			strlcat(br_str, buf, str_len);
-			while (++v < 32) {
-				if ((1 << (v - 1)) & reqp->ifbr_protected) {
-					snprintf(buf, sizeof(buf), ",%u", v);
-					strlcat(br_str, buf, str_len);
-				}
-			}
-			strlcat(br_str, "\n", str_len);
+		default:
+			match = 0;
+			break;
+		}
+		if (match)
 			identified++;
+	}
+
+	if (identified && output) {
+		switch (type) {
+		case MEMBER:
+		case NOLEARNING:
+		case NODISCOVER:
+		case BLOCKNONIP:
+		case STP:
+		case SPAN:
+			fputc('\n', output);
 			break;
 		}
 	}
-	free(bifc.ifbic_buf);
 	return (identified);
 }
 
@@ -918,9 +911,9 @@ int
 bridge_member_search(int ifs, char *ifname)
 {
 	struct if_nameindex *ifn_list, *ifnp;
+	struct ifbreq *req;
+	u_int i, nreq;
 	int idx = 0;
-	char buf[1024];
-	char *p, *s;
 
 	if (!is_valid_ifname(ifname) || is_bridge(ifs, ifname)) {
 		printf("%% bridge_member_search: bad interface %s\n", ifname);
@@ -933,25 +926,112 @@ bridge_member_search(int ifs, char *ifname)
 	}
 
 	/* Search all bridges. */
-	for (ifnp = ifn_list; ifnp->if_name != NULL; ifnp++) {
+	for (ifnp = ifn_list; ifnp->if_name != NULL && idx == 0; ifnp++) {
 		if (!is_bridge(ifs, ifnp->if_name))
 			continue;
-		if (bridge_list(ifs, ifnp->if_name, NULL, buf, sizeof(buf),
-		    MEMBER) == 0)
+		if ((req = bridge_members(ifs, ifnp->if_name, &nreq)) == NULL)
 			continue;
-		p = buf;
-		while ((s = strsep(&p, " ")) != NULL) {
-			if (strcmp(s, ifname) == 0) {
+		for (i = 0; i < nreq; i++) {
+			if (strcmp(req[i].ifbr_ifsname, ifname) == 0) {
 				idx = ifnp->if_index;
-				goto found;
+				break;
 			}
 		}
+		free(req);
 	}
-found:
 	if_freenameindex(ifn_list);
 	return idx;
 }
 
+static int
+brmember_cmp(const void *a, const void *b)
+{
+	const struct brmember *ma = a, *mb = b;
+
+	return (strcmp(ma->member, mb->member));
+}
+
+/*
+ * Record the bridge of every bridge member in one pass over all bridges,
+ * for listings which would otherwise call bridge_member_search() once
+ * per interface.  Returns -1 on failure, with brm left empty.
+ */
+int
+bridge_members_load(int ifs, struct brmembers *brm)
+{
+	struct if_nameindex *ifn_list, *ifnp;
+	struct brmember *m;
+	struct ifbreq *req;
+	u_int i, nreq;
+
+	memset(brm, 0, sizeof(*brm));
+
+	if ((ifn_list = if_nameindex()) == NULL) {
+		printf("%% bridge_members_load: if_nameindex failed\n");
+		return (-1);
+	}
+
+	for (ifnp = ifn_list; ifnp->if_name != NULL; ifnp++) {
+		if (!is_bridge(ifs, ifnp->if_name))
+			continue;
+		if ((req = bridge_members(ifs, ifnp->if_name, &nreq)) == NULL)
+			continue;
+		for (i = 0; i < nreq; i++) {
+			if (req[i].ifbr_ifsname[0] == '\0')
+				continue;
+			if (brm->n == brm->size) {
+				size_t size = brm->size ? brm->size * 2 : 64;
+
+				m = reallocarray(brm->m, size, sizeof(*m));
+				if (m == NULL) {
+					printf("%% bridge_members_load: "
+					    "reallocarray: %s\n",
+					    strerror(errno));
+					free(req);
+					if_freenameindex(ifn_list);
+					bridge_members_free(brm);
+					return (-1);
+				}
+				brm->m = m;
+				brm->size = size;
+			}
+			m = &brm->m[brm->n++];
+			strlcpy(m->member, req[i].ifbr_ifsname,
+			    sizeof(m->member));
+			strlcpy(m->bridge, ifnp->if_name, sizeof(m->bridge));
+		}
+		free(req);
+	}
+	if_freenameindex(ifn_list);
+
+	if (brm->n > 1)
+		qsort(brm->m, brm->n, sizeof(*brm->m), brmember_cmp);
+	return (0);
+}
+
+/*
+ * Name of the bridge ifname is a member of, or NULL if there is none.
+ */
+const char *
+bridge_members_find(struct brmembers *brm, const char *ifname)
+{
+	struct brmember key, *m;
+
+	if (brm->n == 0 ||
+	    strlcpy(key.member, ifname, sizeof(key.member)) >=
+	    sizeof(key.member))
+		return (NULL);
+	m = bsearch(&key, brm->m, brm->n, sizeof(*brm->m), brmember_cmp);
+	return (m ? m->bridge : NULL);
+}
+
+void
+bridge_members_free(struct brmembers *brm)
+{
+	free(brm->m);
+	memset(brm, 0, sizeof(*brm));
+}
+
 int
 bridge_add(int s, char *brdg, char *ifn)
 {
@@ -1660,8 +1740,10 @@ int
 show_bridge(char *ifname)
 {
 	struct if_nameindex *ifn_list, *ifnp;
+	struct ifbreq *req;
+	u_int i, nreq;
 	int ifs, flags, totlen, len, found_bridge = 0, header_shown = 0;
-	char buf[1024], *p, *member;
+	char *member;
 	struct ifreq ifr;
 	char ifdescr[IFDESCRSIZE], *description;
 
@@ -1696,9 +1778,7 @@ show_bridge(char *ifname)
 			puts("% Bridge    Status  Member Interfaces");
 			header_shown = 1;
 		}
-		if (bridge_list(ifs, ifnp->if_name, NULL, buf, sizeof(buf),
-		    MEMBER) == 0)
-			buf[0] = '\0';
+		req = bridge_members(ifs, ifnp->if_name, &nreq);
 
 		flags = get_ifflags(ifnp->if_name, ifs);
 
@@ -1711,8 +1791,10 @@ show_bridge(char *ifname)
 		}
 		totlen = len;
 
-		p = buf;
-		while ((member = strsep(&p, " ")) != NULL) {
+		for (i = 0; req != NULL && i < nreq; i++) {
+			member = req[i].ifbr_ifsname;
+			if (member[0] == '\0')
+				continue;
 			if (totlen + strlen(member) >= 80) {
 				printf("\n                   ");
 				len = 19;
@@ -1723,11 +1805,13 @@ show_bridge(char *ifname)
 			if (len < 0) {
 				printf("\n%% show_bridge: printf failed: %s\n",
 				    strerror(errno));
+				free(req);
 				goto out;
 			}
 			totlen += len;
 		}
 		printf("\n");
+		free(req);
 
 		memset(&ifr, 0, sizeof(ifr));
 		if (strlcpy(ifr.ifr_name, ifnp->if_name,
@@ -29,6 +29,28 @@
 #define CONF_IFCOST	103
 #define PROTECTED	104
 
+struct ifbreq;
+
+struct ifbreq *bridge_members(int, char *, u_int *);
+int	bridge_list(struct ifbreq *, u_int, char *, int, FILE *);
+
+/* bridge member to bridge map, see bridge_members_load() */
+
+struct brmember {
+	char	member[IF_NAMESIZE];
+	char	bridge[IF_NAMESIZE];
+};
+
+struct brmembers {
+	struct brmember	*m;		/* sorted by member */
+	size_t		 n;
+	size_t		 size;
+};
+
+int	bridge_members_load(int, struct brmembers *);
+const char *bridge_members_find(struct brmembers *, const char *);
+void	bridge_members_free(struct brmembers *);
+
 /* blah */
 
 #define IFBAFBITS	"\1STATIC"
@@ -122,7 +122,7 @@ cmdargs_output_setenv(char *cmd, char *arg[], int stdoutfd, int stderrfd,
 			if (pipefd)
 				return 0;
 			signal(SIGALRM, sigalarm);
-			wait(&status);  /* Wait for cmd to complete */
+			waitpid(child, &status, 0); /* Wait for cmd */
 			if (WIFEXITED(status)) /* normal exit? */
 				status = WEXITSTATUS(status); /* exit code */
 			break;
@@ -149,7 +149,7 @@ cmdargs_wait_for_child(void)
 
 	if (child != -1) {
 		signal(SIGALRM, sigalarm);
-		wait(&status);  /* Wait for cmd to complete */
+		waitpid(child, &status, 0); /* Wait for cmd */
 		if (WIFEXITED(status)) /* normal exit? */
 			status = WEXITSTATUS(status); /* exit code */
 		signal(SIGINT, sigint);
@@ -67,6 +67,7 @@
 #include "externs.h"
 #include "sysctl.h"
 #include "ctl.h"
+#include "filter.h"
 
 char hname[HSIZE];
 char hbuf[MAXHOSTNAMELEN];	/* host name */
@@ -78,6 +79,8 @@ pid_t	child;
 static int	disable(void);
 static int	doverbose(int, char**);
 static int	doediting(int, char**);
+static int	dooutput(int, char**);
+static int	clearcmd(int, char**);
 static int	doconfig(int, char**);
 static int	exitconfig(int, char**);
 int		rtable(int, char**);
@@ -87,14 +90,16 @@ static int	pr_routes(int, char **);
 static int	pr_routes6(int, char **);
 static int	pr_arp(int, char **);
 static int	pr_ndp(int, char **);
+static int	watchcmd(int, char **);
+static int	watch_stats(FILE *, void *);
 static int	pr_sadb(int, char **);
 static int	pr_kernel(int, char **);
 static int	pr_dhcp(int, char **);
-static int	pr_conf(int, char **);
+static int	pr_conf(int, char **, FILE *);
 static int	pr_s_conf(int, char **);
 static int	pr_a_conf(int, char **);
-static int	pr_conf_diff(int, char **);
-static int	pr_environment(int, char **);
+static int	pr_conf_diff(int, char **, FILE *);
+static int	pr_environment(int, char **, FILE *);
 static int	show_hostname(int, char **);
 static int	wr_startup(void);
 static int	wr_conf(char *);
@@ -102,7 +107,7 @@ static int	sysctlhelp(int, char **, char **, int);
 static int	flush_pf(char *);
 static int	flush_help(void);
 static int	flush_line(char *);
-static int	flush_ip_routes(void);
+static int	flush_ip_routes(char *, char *, char *);
 static int	flush_arp_cache(void);
 static int	flush_ndp_cache(void);
 static int	flush_history(void);
@@ -175,22 +180,26 @@ static struct stt {
 	char *name;
 	char *help;
 	void (*handler) ();
+	int counters;		/* handler takes stats_run() modes */
 } stts[] = {
-	{ "ip",		"Internet Protocol",			ip_stats },
-	{ "ah",		"Authentication Header",		ah_stats },
-	{ "esp",	"Encapsulated Security Payload",	esp_stats },
-	{ "tcp",	"Transmission Control Protocol",	tcp_stats },
-	{ "udp",	"Unreliable Datagram Protocol",		udp_stats },
-	{ "icmp",	"Internet Control Message Protocol",	icmp_stats },
-	{ "igmp",	"Internet Group Management Protocol",	igmp_stats },
-	{ "ipcomp",	"IP Compression",			ipcomp_stats },
-	{ "route",	"Routing",				rt_stats },
-	{ "carp",	"Common Address Redundancy Protocol",	carp_stats },
-	{ "mbuf",	"Packet memory buffer",			mbpr },
-	{ "pf",		"Packet Filter",			pf_stats },
-	{ 0,		0,					0 }
+	{ "ip",		"Internet Protocol",			ip_stats, 1 },
+	{ "ah",		"Authentication Header",		ah_stats, 1 },
+	{ "esp",	"Encapsulated Security Payload",	esp_stats, 1 },
+	{ "tcp",	"Transmission Control Protocol",	tcp_stats, 1 },
+	{ "udp",	"Unreliable Datagram Protocol",		udp_stats, 1 },
+	{ "icmp",	"Internet Control Message Protocol",	icmp_stats, 1 },
+	{ "igmp",	"Internet Group Management Protocol",	igmp_stats, 1 },
+	{ "ipcomp",	"IP Compression",			ipcomp_stats, 1 },
+	{ "route",	"Routing",				rt_stats, 1 },
+	{ "carp",	"Common Address Redundancy Protocol",	carp_stats, 1 },
+	{ "pfsync",	"pf state table synchronisation",	pfsync_stats, 1 },
+	{ "mbuf",	"Packet memory buffer",			mbpr, 0 },
+	{ "pf",		"Packet Filter",			pf_stats, 0 },
+	{ 0,		0,					0, 0 }
 };
 
+static int	pr_kernel_delta(struct stt *, int, char **);
+
 
 struct prot1 oscs[] = {
 	{ "fib",	"Forward Information Base",
@@ -399,6 +408,11 @@ quit(void)
 struct ghs showroutetab[] = {
 	{ "<cr>", "Type Enter to run command", CMPL0 NULL, 0 },
 	{ "<address[/prefix-length]>", "IP address parameter" , CMPL0 NULL, 0 },
+	{ "<address[/prefix-length]> longer-prefixes", "Prefix and more specific routes", CMPL0 NULL, 0 },
+	{ "<address[/prefix-length]> exact", "Routes for exactly this prefix", CMPL0 NULL, 0 },
+	{ "<address[/prefix-length]> best", "Longest prefix match", CMPL0 NULL, 0 },
+	{ "summary", "Route counts by prefix length, interface, priority", CMPL0 NULL, 0 },
+	{ "summary rtable <table id|all>", "Summary of another or every rtable", CMPL0 NULL, 0 },
 	{ NULL, NULL, NULL, NULL, 0 }
 };
 
@@ -411,6 +425,28 @@ struct ghs showarptab[] = {
 struct ghs showndptab[] = {
 	{ "<cr>", "Type Enter to run command", CMPL0 NULL, 0 },
 	{ "<IPv6-address>", "IPv6 address parameter", CMPL0 NULL, 0 },
+	{ "detail", "Include neighbor state, router flag and probes", CMPL0 NULL, 0 },
+	{ "summary", "Neighbor counts by state", CMPL0 NULL, 0 },
+	{ NULL, NULL, NULL, NULL, 0 }
+};
+
+struct ghs watchtab[] = {
+	{ "interface", "Counters of all interfaces", CMPL0 NULL, 0 },
+	{ "kernel <statistics>", "Kernel statistics, as in show kernel", CMPL0 NULL, 0 },
+	{ "<seconds>", "Refresh interval, default 2", CMPL0 NULL, 0 },
+	{ "delta", "Show changes since the last refresh", CMPL0 NULL, 0 },
+	{ NULL, NULL, NULL, NULL, 0 }
+};
+
+struct ghs cleartab[] = {
+	{ "counters", "Snapshot kernel statistics for show kernel delta", CMPL0 NULL, 0 },
+	{ NULL, NULL, NULL, NULL, 0 }
+};
+
+struct ghs outputtab[] = {
+	{ "<cr>", "Type Enter to show the output mode", CMPL0 NULL, 0 },
+	{ "json", "Show commands print JSON records", CMPL0 NULL, 0 },
+	{ "text", "Show commands print text for people", CMPL0 NULL, 0 },
 	{ NULL, NULL, NULL, NULL, 0 }
 };
 
@@ -427,19 +463,19 @@ struct ghs showvlantab[] = {
 
 Menu showlist[] = {
 	{ "hostname",	"Router hostname",	CMPL0 0, 0, 0, 0, show_hostname },
-	{ "interface",	"Interface config",	CMPL(i) 0, 0, 0, 2, show_int },
+	{ "interface",	"Interface config",	CMPL(i) 0, 0, 0, 4, show_int },
 	{ "autoconf",	"IPv4/IPv6 autoconf state", CMPL(i) 0, 0, 0, 1, show_autoconf },
 	{ "ip",		"IP address information", CMPL0 0, 0, 0, 0, show_ip },
 	{ "inet",	"IPv4 address information", CMPL0 0, 0, 0, 0, show_ip },
 	{ "inet6",	"IPv6 address information", CMPL0 0, 0, 0, 0, show_ip },
-	{ "route",	"IPv4 route table or route lookup", CMPL(h) (char **)showroutetab, sizeof(struct ghs), 0, 1, pr_routes },
-	{ "route6",	"IPv6 route table or route lookup", CMPL(h) (char **)showroutetab, sizeof(struct ghs), 0, 1, pr_routes6 },
+	{ "route",	"IPv4 route table or route lookup", CMPL(R) (char **)showroutetab, sizeof(struct ghs), 0, 3, pr_routes },
+	{ "route6",	"IPv6 route table or route lookup", CMPL(S) (char **)showroutetab, sizeof(struct ghs), 0, 3, pr_routes6 },
 	{ "sadb",	"Security Association Database", CMPL0 0, 0, 0, 0, pr_sadb },
-	{ "arp",	"ARP table",		CMPL(h) (char **)showarptab, sizeof(struct ghs), 0, 1, pr_arp },
-	{ "ndp",	"NDP table",		CMPL(h) (char **)showndptab, sizeof(struct ghs), 0, 1, pr_ndp },
+	{ "arp",	"ARP table",		CMPL(A) (char **)showarptab, sizeof(struct ghs), 0, 1, pr_arp },
+	{ "ndp",	"NDP table",		CMPL(N) (char **)showndptab, sizeof(struct ghs), 0, 1, pr_ndp },
 	{ "vlan",	"802.1Q/802.1ad VLANs",	CMPL(h) (char **)showvlantab, sizeof(struct ghs), 0, 2, show_vlans },
 	{ "bridge",	"Ethernet bridges",	CMPL(b) 0, 0, 0, 1, show_bridges },
-	{ "kernel",	"Kernel statistics",	CMPL(ta) (char **)stts, sizeof(struct stt), 0, 1, pr_kernel },
+	{ "kernel",	"Kernel statistics",	CMPL(ta) (char **)stts, sizeof(struct stt), 0, 3, pr_kernel },
 	{ "bgp",	"BGP information",	CMPL(ta) (char **)bgcs, sizeof(struct prot1), 0, 4, pr_prot1 },
 	{ "ospf",	"OSPF information",	CMPL(ta) (char **)oscs, sizeof(struct prot1), 0, 3, pr_prot1 },
 	{ "ospf6",	"OSPF6 information",	CMPL(ta) (char **)os6cs, sizeof(struct prot1), 0, 3, pr_prot1 },
@@ -454,7 +490,7 @@ Menu showlist[] = {
 	{ "dhcp",	"DHCP server",		CMPL(ta) (char **)dhcs, sizeof(struct prot1), 0, 1, pr_dhcp },
 	{ "smtp",	"SMTP server",		CMPL(ta) (char **)smcs, sizeof(struct prot1), 0, 1, pr_prot1 },
 	{ "ldap",	"LDAP server",		CMPL(ta) (char **)ldcs, sizeof(struct prot1), 0, 1, pr_prot1 },
-	{ "monitor",	"Monitor routing/arp table changes", CMPL0 0, 0, 0, 0, monitor },
+	{ "monitor",	"Monitor routing/arp table changes", CMPL0 0, 0, 0, 24, monitor },
 	{ "version",	"Software information",	CMPL0 0, 0, 0, 0, version },
 	{ "users",	"System users",		CMPL0 0, 0, 0, 0, who },
 	{ "crontab",	"Scheduled background jobs",	CMPL0 0, 0, 0, 0, pr_crontab },
@@ -473,9 +509,7 @@ static int
 showcmd(int argc, char **argv)
 {
 	Menu *s;	/* pointer to current command */
-	int error = 0, outfd = -1;
-	char outpath[PATH_MAX];
-	struct stat sb;
+	int error = 0;
 
 	if (argc < 2) {
 		show_help(argc, argv);
@@ -500,66 +534,20 @@ showcmd(int argc, char **argv)
 		return 0;
 	}
 
-	if (strlcpy(outpath, "/tmp/nsh.show.XXXXXXXX", sizeof(outpath)) >=
-	    sizeof(outpath))
-		return 0;
-
-	outfd = mkstemp(outpath);
-	if (outfd == -1) {
-		printf("%% mkstemp %s: %s\n", outpath, strerror(errno));
-		return 0;
-	}
-
-	if (fstat(outfd, &sb) == -1) {
-		printf("%% fstat %s: %s\n", outpath, strerror(errno));
-		goto done;
-	}
-
+	/*
+	 * Page the output while the handler produces it.  Handlers which
+	 * have not been converted to write to the output file yet print
+	 * straight to the terminal, which the pager leaves alone until it
+	 * has a screen of its own to show.
+	 */
 	if (s->handler)	{
 		FILE *f;
-		int fd;
-
-		fd = dup(outfd);
-		if (fd == -1) {
-			printf("%% dup %s\n", strerror(errno));
-			goto done;
-		}
 
-		f = fdopen(fd, "w+");
-		if (f == NULL) {
-			printf("%% dup %s\n", strerror(errno));
-			close(fd);
-			goto done;
-		}
+		f = more_open(NULL);
 		error = (*s->handler)(argc, argv, f);
-		if (fflush(f) == EOF)
-			printf("%% fflush %s: %s\n", outpath, strerror(errno));
-		fclose(f); /* fd is closed via f */
+		more_close(f);
 	}
 
-	/*
-	 * Until all show commands have been converted to write to the output
-	 * file we need to check here whether the file has been modified before
-	 * piping it to the pager.
-	 */
-	if (error == 0) {
-		struct stat sb2;
-
-		lseek(outfd, 0, SEEK_SET);
-		if (fstat(outfd, &sb2) == -1) {
-			printf("%% fstat %s: %s\n", outpath, strerror(errno));
-			goto done;
-		}
-		if (sb.st_size != sb2.st_size ||
-		    sb.st_mtim.tv_sec != sb2.st_mtim.tv_sec ||
-		    sb.st_mtim.tv_nsec != sb2.st_mtim.tv_nsec)
-			more(outpath);
-	}
-done:
-	if (close(outfd) == EOF)
-		printf("%% close %s: %s\n", outpath, strerror(errno));
-	if (unlink(outpath) == -1)
-		printf("%% unlink %s: %s\n", outpath, strerror(errno));
 	return(error);
 }
 
@@ -988,7 +976,7 @@ sysctlhelp(int unused1, char **unused2, char **unused3, int type)
  */
 
 Menu flushlist[] = {
-	{ "routes",	"IP routes", CMPL0 0, 0, 0, 0, flush_ip_routes },
+	{ "routes",	"IP routes", CMPL0 0, 0, 0, 3, flush_ip_routes },
 	{ "arp",	"ARP cache", CMPL0 0, 0, 0, 0, flush_arp_cache },
 	{ "ndp",	"NDP cache", CMPL0 0, 0, 0, 0, flush_ndp_cache },
 	{ "line",	"Active user", CMPL0 0, 0, 1, 1, flush_line },
@@ -1030,7 +1018,8 @@ flushcmd(int argc, char **argv)
 	}
 	if (f->handler)
 		(*f->handler)((f->maxarg > 0) ? argv[2] : 0,
-		    (f->maxarg > 1) ? argv[3] : 0);
+		    (f->maxarg > 1) ? argv[3] : 0,
+		    (f->maxarg > 2) ? argv[4] : 0);
 
 	return(1);
 }
@@ -1076,6 +1065,7 @@ static char sshhelp[];
 static char telnethelp[];
 static char crontabhelp[];
 static char showhelp[];
+static char watchhelp[];
 static char whohelp[];
 static char dohelp[];
 static char setenvhelp[];
@@ -1083,6 +1073,8 @@ static char unsetenvhelp[];
 static char saveenvhelp[];
 static char verbosehelp[];
 static char editinghelp[];
+static char outputhelp[];
+static char clearhelp[];
 static char shellhelp[];
 static char manhelp[];
 extern struct ghs mantab[];
@@ -1728,6 +1720,7 @@ static char
 	inethelp[] =	"Inet super-server control",
 	bridgehelp[] =	"Modify bridge parameters",
 	showhelp[] =	"Show system information",
+	watchhelp[] =	"Redraw interface or kernel counters periodically",
 	iphelp[] =	"Set IP networking parameters",
 	ip6help[] =	"Set IPv6 networking parameters",
 	mplshelp[] =	"Set MPLS network parameters",
@@ -1748,6 +1741,8 @@ static char
 	exithelp[] =	"Leave configuration mode and return to privileged mode",
 	verbosehelp[] =	"Set verbose diagnostics",
 	editinghelp[] = "Set command line editing",
+	outputhelp[] =	"Set text or JSON output for show commands",
+	clearhelp[] =	"Clear statistics",
 	confighelp[] =	"Set configuration mode",
 	whohelp[] =	"Display system users",
 	dohelp[] =	"Superfluous, do is ignored and its arguments executed",
@@ -1801,11 +1796,13 @@ Command cmdtab[] = {
 	{ "interface",	interfacehelp,	CMPL(i) 0, 0, interface,	1, 1, 1, 1 },
 	{ "rtable",	rtablehelp,	CMPL(rh) (char **)rtabletab, sizeof(struct ghs), rtable,	0, 0, 1, 2 },
 	{ "group",	grouphelp,	CMPL(gth) (char **)grouptab, sizeof(Menu), group, 1, 1, 1, 0 },
-	{ "arp",	arphelp,	CMPL0 0, 0, arpset,		1, 1, 1, 0 },
-	{ "ndp",	ndphelp,	CMPL0 0, 0, ndpset,		1, 1, 1, 0 },
+	{ "arp",	arphelp,	CMPL(A) 0, 0, arpset,		1, 1, 1, 0 },
+	{ "ndp",	ndphelp,	CMPL(N) 0, 0, ndpset,		1, 1, 1, 0 },
 	{ "nameserver",	nameserverhelp,	CMPL0 0, 0, nameserverset,	1, 1, 1, 0 },
 	{ "bridge",	bridgehelp,	CMPL(i) 0, 0, interface,	1, 1, 1, 1 },
 	{ "show",	showhelp,	CMPL(ta) (char **)showlist, sizeof(Menu), showcmd,	0, 0, 0, 0 },
+	{ "watch",	watchhelp,	CMPL(h) (char **)watchtab, sizeof(struct ghs), watchcmd,	0, 0, 0, 0 },
+	{ "clear",	clearhelp,	CMPL(h) (char **)cleartab, sizeof(struct ghs), clearcmd,	0, 0, 0, 0 },
 	{ "ip",		iphelp,		CMPL(ta) (char **)iptab, sizeof(Menu), ipcmd,		1, 1, 1, 0 },
 	{ "ip6",	ip6help,	CMPL(ta) (char **)ip6tab, sizeof(Menu), ipcmd,		1, 1, 1, 0 },
 	{ "mpls",	mplshelp,	CMPL(ta) (char **)mplstab, sizeof(Menu), ipcmd,		1, 1, 1, 0 },
@@ -1814,7 +1811,7 @@ Command cmdtab[] = {
 	{ "flush",	flushhelp,	CMPL(ta) (char **)flushlist, sizeof(Menu), flushcmd,	1, 0, 0, 0 },
 	{ "enable",	enablehelp,	CMPL(ta) (char **)enabletab, sizeof(Menu), enable,	0, 0, 0, 0 },
 	{ "disable",	disablehelp,	CMPL0 0, 0, disable,		1, 0, 0, 0 },
-	{ "route",	routehelp,	CMPL0 0, 0, route,		1, 1, 1, 0 },
+	{ "route",	routehelp,	CMPL(T) 0, 0, route,		1, 1, 1, 0 },
 	{ "pf",		pfhelp,		CMPL(t) (char **)ctl_pf, ssctl, ctlhandler,	1, 1, 0, 1 },
 	{ "ospf",	ospfhelp,	CMPL(t) (char **)ctl_ospf, ssctl, ctlhandler,	1, 1, 0, 1 },
 	{ "ospf6",	ospf6help,	CMPL(t) (char **)ctl_ospf6, ssctl, ctlhandler,	1, 1, 0, 1 },
@@ -1856,6 +1853,7 @@ Command cmdtab[] = {
 	{ "write-config", savehelp,	CMPL0 0, 0, wr_startup,		1, 0, 0, 0 },
 	{ "verbose",	verbosehelp,	CMPL0 0, 0, doverbose,		0, 0, 1, 0 },
 	{ "editing",	editinghelp,	CMPL0 0, 0, doediting,		0, 0, 1, 0 },
+	{ "output",	outputhelp,	CMPL(h) (char **)outputtab, sizeof(struct ghs), dooutput,	0, 0, 0, 0 },
 	{ "configure",	confighelp,	CMPL0 0, 0, doconfig,		1, 0, 1, 0 },
 	{ "who",	whohelp,	CMPL0 0, 0, who,		0, 0, 0, 0 },
 	{ "no",		0,		CMPL(c) 0, 0, nocmd,		0, 0, 0, 0 },
@@ -1897,6 +1895,8 @@ command()
 {
 	Command  *c;
 	u_int num;
+	char **fargv;
+	int i, fargc = 0;
 
 	init_bgpd_socket_path(getrtable());
 
@@ -1944,6 +1944,21 @@ command()
 		if (margv[0] == 0) {
 			break;
 		}
+
+		/* split off output filters, which start at the first bar */
+		fargv = NULL;
+		for (i = 0; i < margc; i++)
+			if (margv[i] == margbar) {
+				fargv = &margv[i];
+				fargc = margc - i;
+				margc = i;
+				break;
+			}
+		if (margc == 0) {
+			printf("%% Invalid command\n");
+			continue;
+		}
+
 		if (NO_ARG(margv[0]))
 			c = getcmd(margv[1]);
 		else
@@ -1976,6 +1991,20 @@ command()
 		}
 		if (c->modh)
 			strlcpy(hname, c->name, HSIZE);
+		if (fargv != NULL) {
+			struct filter *filter;
+			int ret;
+
+			if ((filter = filter_compile(fargc, fargv,
+			    margbar)) == NULL || more_stdout(filter) == -1)
+				continue;
+			margv[margc] = NULL;
+			ret = (*c->handler) (margc, margv, 0);
+			more_endstdout();
+			if (ret)
+				break;
+			continue;
+		}
 		if ((*c->handler) (margc, margv, 0)) {
 			break;
 		}
@@ -2716,6 +2745,32 @@ doediting(int argc, char **argv)
 	return 0;
 }
 
+/*
+ * output [json|text]
+ */
+int
+dooutput(int argc, char **argv)
+{
+	if (argc > 2 || (argc == 2 && argv[1][0] == '?')) {
+		printf("%% output [json|text]\n");
+		return 1;
+	}
+	if (argc == 2) {
+		if (isprefix(argv[1], "json"))
+			json_output = 1;
+		else if (isprefix(argv[1], "text"))
+			json_output = 0;
+		else {
+			printf("%% Invalid argument %s\n", argv[1]);
+			return 1;
+		}
+	}
+
+	printf("%% Output mode is %s\n", json_output ? "json" : "text");
+
+	return 0;
+}
+
 int
 doconfig(int argc, char **argv)
 {
@@ -3146,9 +3201,32 @@ powerdown(void)
  * Flush wrappers
  */
 int
-flush_ip_routes(void)
+flush_ip_routes(char *arg1, char *arg2, char *arg3)
 {
-	flushroutes(AF_INET, AF_INET);
+	char *prefix = NULL;
+	const char *errstr;
+	int tableid = cli_rtable;
+
+	/* flush routes [<prefix>] [rtable <table id>] */
+	if (arg1 && !isprefix(arg1, "rtable")) {
+		prefix = arg1;
+		arg1 = arg2;
+		arg2 = arg3;
+		arg3 = NULL;
+	}
+	if (arg1) {
+		if (!isprefix(arg1, "rtable") || arg2 == NULL || arg3) {
+			printf("%% flush routes [<prefix>] [rtable <table id>]\n");
+			return(0);
+		}
+		tableid = strtonum(arg2, 0, RT_TABLEID_MAX, &errstr);
+		if (errstr) {
+			printf("%% invalid table id: %s\n", errstr);
+			return(0);
+		}
+	}
+
+	flushroutes(AF_INET, AF_INET, prefix, tableid);
 
 	return(0);
 }
@@ -3156,7 +3234,7 @@ flush_ip_routes(void)
 int
 flush_arp_cache(void)
 {
-	flushroutes(AF_INET, AF_LINK);
+	flushroutes(AF_INET, AF_LINK, NULL, cli_rtable);
 
 	return(0);
 }
@@ -3164,7 +3242,7 @@ flush_arp_cache(void)
 int
 flush_ndp_cache(void)
 {
-	ndpdump(NULL, 1);
+	ndpdump(NULL, 1, NDP_BRIEF);
 	return(0);
 }
 
@@ -3172,19 +3250,14 @@ flush_ndp_cache(void)
  * Show wrappers
  */
 int
-pr_conf(int argc, char **argv)
+pr_conf(int argc, char **argv, FILE *outfile)
 {
 	if (priv != 1) {
 		printf ("%% Privilege required\n");
 		return(0);
 	}
 
-	if (!wr_conf(NSHRC_TEMP)) {
-		printf("%% Couldn't generate configuration\n");
-		return(0);
-	}
-
-	more(NSHRC_TEMP);
+	conf(outfile);
 
 	return(1);
 }
@@ -3230,13 +3303,14 @@ pr_a_conf(int argc, char **argv)
 
 /*
  * Show differences between startup and running config.
+ * diff(1) needs the running config in a file, its output is paged as
+ * it is produced.
  */
 int
-pr_conf_diff(int argc, char **argv)
+pr_conf_diff(int argc, char **argv, FILE *outfile)
 {
-	int conf_fd = -1, diff_fd = -1;
+	int conf_fd = -1;
 	char confpath[PATH_MAX];
-	char diffpath[PATH_MAX];
 	char *diff_argv[9] = {
 	    DIFF, "-u", "-L", NULL, "-L", NULL, NULL, NULL, NULL
 	};
@@ -3254,9 +3328,6 @@ pr_conf_diff(int argc, char **argv)
 	if (strlcpy(confpath, "/tmp/nshrc.XXXXXXXX", sizeof(confpath)) >=
 	    sizeof(confpath))
 		return 0;
-	if (strlcpy(diffpath, "/tmp/nshrc.diff.XXXXXXXX", sizeof(diffpath)) >=
-	    sizeof(diffpath))
-		return 0;
 
 	conf_fd = mkstemp(confpath);
 	if (conf_fd == -1) {
@@ -3264,12 +3335,6 @@ pr_conf_diff(int argc, char **argv)
 		return 0;
 	}
 
-	diff_fd = mkstemp(diffpath);
-	if (diff_fd == -1) {
-		printf("%% mkstemp %s: %s\n", diffpath, strerror(errno));
-		goto done;
-	}
-
 	if (!wr_conf(confpath)) {
 		printf("%% Couldn't generate configuration\n");
 		goto done;
@@ -3287,19 +3352,12 @@ pr_conf_diff(int argc, char **argv)
 		diff_argv[6] = NSHRC;
 	diff_argv[7] = confpath;
 
-	if (cmdargs_output(DIFF, diff_argv, diff_fd, -1) > 1)
+	fflush(outfile);
+	if (cmdargs_output(DIFF, diff_argv, fileno(outfile), -1) > 1)
 		printf("%% %s command failed\n", DIFF);
-
-	more(diffpath);
 done:
-	if (diff_fd != -1) {
-		unlink(diffpath);
-		close(diff_fd);
-	}
-	if (conf_fd != -1) {
-		unlink(confpath);
-		close(conf_fd);
-	}
+	unlink(confpath);
+	close(conf_fd);
 	return 0;
 }
 
@@ -3323,9 +3381,41 @@ pr_crontab(int argc, char **argv, FILE *outfile)
 	return 0;
 }
 
+/*
+ * show route[6] summary [rtable <table id>|all]
+ */
+static int
+pr_routes_summary(int af, int argc, char **argv)
+{
+	const char *errstr;
+	u_int tableid = cli_rtable;
+
+	if (argc == 5 && isprefix(argv[3], "rtable")) {
+		if (isprefix(argv[4], "all"))
+			tableid = RTABLE_ANY;
+		else {
+			tableid = strtonum(argv[4], 0, RT_TABLEID_MAX, &errstr);
+			if (errstr) {
+				printf("%% invalid table id: %s\n", errstr);
+				return 0;
+			}
+		}
+	} else if (argc != 3) {
+		printf("%% show %s summary [rtable <table id>|all]\n",
+		    af == AF_INET6 ? "route6" : "route");
+		return 0;
+	}
+
+	p_rtsummary(af, tableid);
+	return 0;
+}
+
 int
 pr_routes(int argc, char **argv)
 {
+	if (argc > 2 && isprefix(argv[2], "summary"))
+		return pr_routes_summary(AF_INET, argc, argv);
+
 	switch(argc) {
 	case 2:
 		/* show primary routing table */
@@ -3333,7 +3423,11 @@ pr_routes(int argc, char **argv)
 		break;
 	case 3:
 		/* show a specific route */
-		show_route(argv[2], cli_rtable);
+		show_route(argv[2], NULL, cli_rtable);
+		break;
+	case 4:
+		/* show routes matching a prefix */
+		show_route(argv[2], argv[3], cli_rtable);
 		break;
 	}
 
@@ -3343,6 +3437,9 @@ pr_routes(int argc, char **argv)
 int
 pr_routes6(int argc, char **argv)
 {
+	if (argc > 2 && isprefix(argv[2], "summary"))
+		return pr_routes_summary(AF_INET6, argc, argv);
+
 	switch(argc) {
 	case 2:
 		/* show primary routing table */
@@ -3350,7 +3447,11 @@ pr_routes6(int argc, char **argv)
 		break;
 	case 3:
 		/* show a specific route */
-		show_route(argv[2], cli_rtable);
+		show_route(argv[2], NULL, cli_rtable);
+		break;
+	case 4:
+		/* show routes matching a prefix */
+		show_route(argv[2], argv[3], cli_rtable);
 		break;
 	}
 
@@ -3379,11 +3480,16 @@ pr_ndp(int argc, char **argv)
 	switch(argc) {
 	case 2:
 		/* show ndp table */
-		ndpdump(NULL, 0);
+		ndpdump(NULL, 0, NDP_BRIEF);
 		break;
 	case 3:
-		/* specific address */
-		ndpget(argv[2]);
+		if (isprefix(argv[2], "detail"))
+			ndpdump(NULL, 0, NDP_DETAIL);
+		else if (isprefix(argv[2], "summary"))
+			ndpdump(NULL, 0, NDP_SUMMARY);
+		else
+			/* specific address */
+			ndpget(argv[2]);
 		break;
 	}
 	return 0;
@@ -3415,12 +3521,143 @@ pr_kernel(int argc, char **argv)
 		printf("%% Ambiguous argument %s\n", argv[2]);
 		return 0;
 	}
+	if (argc > 3)
+		return pr_kernel_delta(x, argc, argv);
 	if (x->handler) /* not likely to be false */
 		(*x->handler)();
 
 	return(0);
 }
 
+/*
+ * show kernel <statistics> delta [<seconds>]
+ *
+ * Without an interval, show what changed since the previous delta or
+ * clear counters of this session; with one, what changes meanwhile.
+ */
+static int
+pr_kernel_delta(struct stt *x, int argc, char **argv)
+{
+	const char *errstr;
+	int interval;
+
+	if (argc > 5 || !isprefix(argv[3], "delta")) {
+		printf("%% show kernel <statistics> [delta [<seconds>]]\n");
+		return 0;
+	}
+	if (!x->counters) {
+		printf("%% %s statistics have no delta\n", x->name);
+		return 0;
+	}
+	if (argc == 5) {
+		interval = strtonum(argv[4], 1, 3600, &errstr);
+		if (errstr) {
+			printf("%% interval %s is %s\n", argv[4], errstr);
+			return 0;
+		}
+		stats_run(x->handler, STATS_MARK);
+		sleep(interval);
+	}
+	stats_run(x->handler, STATS_DELTA);
+
+	return 0;
+}
+
+/*
+ * clear counters
+ *
+ * Kernel counters cannot be reset, so take a snapshot of every
+ * protocol's instead which show kernel <statistics> delta counts from.
+ */
+int
+clearcmd(int argc, char **argv)
+{
+	struct stt *x;
+
+	if (argc != 2 || !isprefix(argv[1], "counters")) {
+		printf("%% clear counters\n");
+		return 1;
+	}
+	for (x = stts; x->name != NULL; x++)
+		if (x->counters)
+			stats_run(x->handler, STATS_MARK);
+
+	return 0;
+}
+
+static int
+watch_stats(FILE *outfile, void *arg)
+{
+	struct stt *x = arg;
+
+	(*x->handler)();
+	return 0;
+}
+
+/*
+ * watch [show] interface|kernel <statistics> [<seconds>] [delta]
+ *
+ * Interfaces come from one NET_RT_IFLIST pass per refresh and kernel
+ * statistics from one sysctl each, never from the per interface path
+ * of show interface.
+ */
+int
+watchcmd(int argc, char **argv)
+{
+	struct stt *x = NULL;
+	int (*render)(FILE *, void *) = show_int_counters;
+	int i = 1, interval = 2, delta = 0;
+	const char *errstr;
+	char title[64];
+
+	if (i < argc && isprefix(argv[i], "show"))
+		i++;
+	if (i >= argc || argv[i][0] == '?') {
+		printf("%% watch [show] interface [<seconds>] [delta]\n");
+		printf("%% watch [show] kernel <statistics> [<seconds>] "
+		    "[delta]\n");
+		return 0;
+	}
+	if (isprefix(argv[i], "interface")) {
+		strlcpy(title, "interface counters", sizeof(title));
+		i++;
+	} else {
+		/* "kernel" is optional, "watch tcp" will do */
+		if (isprefix(argv[i], "kernel") && ++i >= argc) {
+			gen_help((char **)stts, "watch kernel", "statistics",
+			    sizeof(struct stt));
+			return 0;
+		}
+		x = (struct stt *) genget(argv[i], (char **)stts,
+		    sizeof(struct stt));
+		if (x == 0) {
+			printf("%% Invalid argument %s\n", argv[i]);
+			return 0;
+		} else if (Ambiguous(x)) {
+			printf("%% Ambiguous argument %s\n", argv[i]);
+			return 0;
+		}
+		snprintf(title, sizeof(title), "%s statistics", x->name);
+		render = watch_stats;
+		i++;
+	}
+
+	for (; i < argc; i++) {
+		if (isprefix(argv[i], "delta")) {
+			delta = 1;
+			continue;
+		}
+		interval = strtonum(argv[i], 1, 3600, &errstr);
+		if (errstr) {
+			printf("%% interval %s is %s\n", argv[i], errstr);
+			return 0;
+		}
+	}
+
+	watch(title, interval, delta, render, x);
+	return 0;
+}
+
 void
 pf_stats(void)
 {
@@ -3457,22 +3694,10 @@ envcmp(const void *item1, const void *item2)
 }
 
 static int
-pr_environment(int argc, char **argv)
+pr_environment(int argc, char **argv, FILE *outfile)
 {
 	extern char **environ;
 	char **ep;
-	int fd;
-	char path[PATH_MAX];
-
-	if (strlcpy(path, "/tmp/nshrc.env.XXXXXXXX", sizeof(path)) >=
-	    sizeof(path))
-		return 0;
-
-	fd = mkstemp(path);
-	if (fd == -1) {
-		printf("%% mkstemp %s: %s\n", path, strerror(errno));
-		return 0;
-	}
 
 	if (argc >= 3) {
 		char *name, *eq, *value;
@@ -3482,7 +3707,7 @@ pr_environment(int argc, char **argv)
 			eq = strchr(*ep, '=');
 			if (eq && strncmp(name, *ep, eq - *ep) == 0) {
 				value = eq + 1;
-				dprintf(fd, "%s\n", value);
+				fprintf(outfile, "%s\n", value);
 				break;
 			}
 		}
@@ -3498,7 +3723,7 @@ pr_environment(int argc, char **argv)
 		sorted_environ = calloc(nenv + 1, sizeof(*sorted_environ));
 		if (sorted_environ == NULL) {
 			printf("%% pr_environment: calloc: %s\n", strerror(errno));
-			goto done;
+			return 0;
 		}
 
 		for (nenv = 0, ep = environ; *ep; ep++) {
@@ -3509,15 +3734,10 @@ pr_environment(int argc, char **argv)
 		qsort(sorted_environ, nenv, sizeof(*sorted_environ), envcmp);
 		sorted_environ[nenv] = NULL;
 
-		for (ep = sorted_environ; *ep; ep++)
-			dprintf(fd, "%s\n", *ep);
+		for (ep = sorted_environ; *ep && !ferror(outfile); ep++)
+			fprintf(outfile, "%s\n", *ep);
+		free(sorted_environ);
 	}
 
-	fsync(fd);
-
-	more(path);
-done:
-	unlink(path);
-	close(fd);
 	return 0;
 }
@@ -38,8 +38,12 @@
 #include <sys/ioctl.h>
 #include <ifaddrs.h>
 #include <net/if.h>
+#include <net/route.h>
 #include <sys/param.h>
 #include <sys/tty.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
 #include "editing.h"
 #include "stringlist.h"
@@ -53,6 +57,8 @@ unsigned char complete(EditLine *, char **, size_t);
 static int	     comparstr(const void *, const void *);
 static unsigned char complete_ambiguous(char *, int, StringList *, EditLine *,
 				char *);
+static unsigned char complete_range(char *, int, char **, size_t, size_t,
+				EditLine *, char *);
 static unsigned char complete_command(char *, int, EditLine *, char **, int);
 static unsigned char complete_subcommand(char *, int, EditLine *, char **, int);
 static unsigned char complete_local(char *, int, EditLine *);
@@ -68,7 +74,7 @@ static unsigned char complete_docmd(struct ghs *, char *, int, EditLine *,
 static unsigned char complete_noint(char *, int, EditLine *, char **, int, int);
 static unsigned char complete_args(struct ghs *, char *, int, EditLine *,
 				   char **, int, int);
-static void list_vertical(StringList *);
+static void list_vertical(char **, size_t);
 
 unsigned char complt_c(EditLine *, int);
 unsigned char complt_i(EditLine *, int);
@@ -94,18 +100,31 @@ comparstr(const void *a, const void *b)
 static unsigned char
 complete_ambiguous(char *word, int list, StringList *words, EditLine *el,
     char *sep)
+{
+	qsort(words->sl_str, words->sl_cur, sizeof(char *), comparstr);
+	return (complete_range(word, list, words->sl_str, 0, words->sl_cur,
+	    el, sep));
+}
+
+/*
+ * As complete_ambiguous(), for the sorted matches names[lo] up to but
+ * not including names[hi].  Being sorted, the prefix common to all of
+ * them is the one the first and the last share.
+ */
+static unsigned char
+complete_range(char *word, int list, char **names, size_t lo, size_t hi,
+    EditLine *el, char *sep)
 {
 	char insertstr[MAXPATHLEN];
-	char *lastmatch;
-	int i, j;
+	const char *first, *last;
 	size_t matchlen, wordlen;
 
 	wordlen = strlen(word);
-	if (words->sl_cur == 0)
+	if (lo >= hi)
 		return (CC_ERROR);	/* no choices available */
 
-	if (words->sl_cur == 1) {	/* only one choice available */
-		(void)strlcpy(insertstr, words->sl_str[0], sizeof insertstr);
+	if (hi - lo == 1) {		/* only one choice available */
+		(void)strlcpy(insertstr, names[lo], sizeof insertstr);
 		(void)strlcat(insertstr, sep, sizeof insertstr);
 		if (el_insertstr(el, insertstr + wordlen) == -1)
 			return (CC_ERROR);
@@ -114,18 +133,13 @@ complete_ambiguous(char *word, int list, StringList *words, EditLine *el,
 	}
 
 	if (!list) {
-		matchlen = 0;
-		if ((lastmatch = words->sl_str[0]))
-			matchlen = strlen(lastmatch);
-		for (i = 1 ; i < words->sl_cur ; i++) {
-			for (j = wordlen ; j < strlen(words->sl_str[i]); j++)
-				if (lastmatch[j] != words->sl_str[i][j])
-					break;
-			if (j < matchlen)
-				matchlen = j;
-		}
-		if (matchlen > wordlen) {
-			(void)strlcpy(insertstr, lastmatch, matchlen+1);
+		first = names[lo];
+		last = names[hi - 1];
+		for (matchlen = wordlen; first[matchlen] != '\0' &&
+		    first[matchlen] == last[matchlen]; matchlen++)
+			;
+		if (matchlen > wordlen && matchlen < sizeof insertstr) {
+			(void)strlcpy(insertstr, first, matchlen + 1);
 			if (el_insertstr(el, insertstr + wordlen) == -1)
 				return (CC_ERROR);
 			else
@@ -137,8 +151,7 @@ complete_ambiguous(char *word, int list, StringList *words, EditLine *el,
 	}
 
 	putc('\n', ttyout);
-	qsort(words->sl_str, words->sl_cur, sizeof(char *), comparstr);
-	list_vertical(words);
+	list_vertical(names + lo, hi - lo);
 	return (CC_REDISPLAY);
 }
 
@@ -297,7 +310,7 @@ complete_showhelp(char *word, EditLine *el, char **table, int stlen,
 	if (cmdlist->sl_cur > 0)
 		putc('\n', ttyout);
 	if (vertical)
-		list_vertical(cmdlist);
+		list_vertical(cmdlist->sl_str, cmdlist->sl_cur);
 	else {
 		for (i = 0 ; i < cmdlist->sl_cur ; i++) {
 			if (i < helplist->sl_cur &&
@@ -348,70 +361,109 @@ complt_c(EditLine *el, int ch)
 	return(complete(el, (char **)cmdtab, sizeof(struct cmd)));
 }
 
-unsigned char
-complete_ifname(char *word, int list, EditLine *el)
+/*
+ * Completion caches.  Each keeps the sorted names offered by one source
+ * and reloads them only once they may have changed: interface, group
+ * and bridge names when the kernel announces an interface arriving or
+ * leaving, routing tables when the database is written to.  A TAB press
+ * is then a binary search instead of a round of ioctls or a query.
+ */
+#define NC_IFNAME	0
+#define NC_IFGROUP	1
+#define NC_IFBRIDGE	2
+#define NC_RTABLE	3
+#define NC_ARP		4
+#define NC_NDP		5
+#define NC_ROUTE	6
+#define NC_ROUTE6	7
+#define NC_STATIC	8
+
+/*
+ * Addresses from the kernel tables are only loaded when asked for, and
+ * then only those starting with the word being completed, at most
+ * NC_TABLE_MAX of them.  Routes change without notice, so they are
+ * thrown away after NC_TABLE_TTL seconds.
+ */
+#define NC_TABLE_MAX	4096
+#define NC_TABLE_TTL	5
+
+struct namecache {
+	StringList	*sl;		/* sorted, NULL until loaded */
+	u_int		 gen;		/* ifcache_generation() at load */
+	struct timespec	 mtim;		/* database mtime at load */
+	int		 stale;
+	int		(*load)(StringList *);
+	char		*word;		/* last word looked up ... */
+	size_t		 lo, hi;	/* ... and the range it matched */
+	/* kernel tables, which have no load function */
+	int		 af, rtflags;	/* getrtdump() arguments */
+	int		 rtable;	/* table loaded from, */
+	char		*filter;	/* for names with this prefix, */
+	time_t		 loaded;	/* at this time */
+	size_t		 matched;	/* may exceed NC_TABLE_MAX */
+};
+
+static int	nc_load_ifname(StringList *);
+static int	nc_load_ifgroup(StringList *);
+static int	nc_load_ifbridge(StringList *);
+static int	nc_load_rtable(StringList *);
+static StringList *nc_get(int, char *);
+static void	nc_uniq(StringList *);
+static void	nc_range(struct namecache *, char *, size_t *, size_t *);
+static unsigned char complete_cached(int, char *, int, EditLine *, char *);
+static unsigned char complete_rtentry(int, struct ghs *, char *, int,
+				EditLine *);
+
+static struct namecache namecache[] = {
+	[NC_IFNAME] =	{ .stale = 1, .load = nc_load_ifname },
+	[NC_IFGROUP] =	{ .stale = 1, .load = nc_load_ifgroup },
+	[NC_IFBRIDGE] =	{ .stale = 1, .load = nc_load_ifbridge },
+	[NC_RTABLE] =	{ .stale = 1, .load = nc_load_rtable },
+	[NC_ARP] =	{ .stale = 1, .af = AF_INET, .rtflags = RTF_LLINFO },
+	[NC_NDP] =	{ .stale = 1, .af = AF_INET6, .rtflags = RTF_LLINFO },
+	[NC_ROUTE] =	{ .stale = 1, .af = AF_INET },
+	[NC_ROUTE6] =	{ .stale = 1, .af = AF_INET6 },
+	[NC_STATIC] =	{ .stale = 1, .rtflags = RTF_STATIC },
+};
+
+static int
+nc_load_ifname(StringList *sl)
 {
-	StringList *words;
-	size_t wordlen;
-	unsigned char rv;
-	const char *status_cmd = "status";
 	struct if_nameindex *ifn_list, *ifnp;
-
-	words = sl_init();
-	wordlen = strlen(word);
+	char *s;
 
 	if ((ifn_list = if_nameindex()) == NULL)
-		return 0;
+		return (-1);
 
 	for (ifnp = ifn_list; ifnp->if_name != NULL; ifnp++) {
-                if (wordlen > strlen(ifnp->if_name))
-                        continue;
-                if (strncmp(word, ifnp->if_name, wordlen) == 0)
-                        sl_add(words, ifnp->if_name);
-        }
-
-	/* Handle the pseudo command "show interface status". */
-	if (margc >= 2 && isprefix(margv[0], "show") &&
-	    isprefix(margv[1], "interface") &&
-	    wordlen <= strlen(status_cmd) &&
-	    strncmp(word, status_cmd, wordlen) == 0) {
-		char *s = strdup(status_cmd);
-		if (s == NULL)
+		if ((s = strdup(ifnp->if_name)) == NULL)
 			err(1, "strdup");
-		sl_add(words, s);
+		sl_add(sl, s);
 	}
 
-        rv = complete_ambiguous(word, list, words, el, " ");
 	if_freenameindex(ifn_list);
-        sl_free(words, 0);
-        return (rv);
+	return (0);
 }
 
-unsigned char
-complete_ifgroup(char *word, int list, EditLine *el)
+static int
+nc_load_ifgroup(StringList *sl)
 {
-	StringList *words;
-	size_t wordlen;
-	unsigned char rv;
 	struct ifgroupreq ifgr;
-	struct ifg_req *ifg;
 	int ifs;
 	u_int len, ngroups, i;
-
-	words = sl_init();
-	wordlen = strlen(word);
+	char *s;
 
 	bzero(&ifgr, sizeof(ifgr));
 
 	if ((ifs = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
 		printf("%% complete_ifgroup: %s\n", strerror(errno));
-		return(1);
+		return (-1);
 	}
 
 	if (ioctl(ifs, SIOCGIFGLIST, (caddr_t)&ifgr) == -1) {
 		printf("%% SIOCGIFGLIST: %s\n", strerror(errno));
 		close(ifs);
-		return(1);
+		return (-1);
 	}
 
 	len = ifgr.ifgr_len;
@@ -419,108 +471,292 @@ complete_ifgroup(char *word, int list, EditLine *el)
 	if (ifgr.ifgr_groups == NULL) {
 		printf("%% calloc: %s\n", strerror(errno));
 		close(ifs);
-		return(1);
+		return (-1);
 	}
 
 	if (ioctl(ifs, SIOCGIFGLIST, (caddr_t)&ifgr) == -1) {
 		printf("%% SIOCGIFGLIST: %s\n", strerror(errno));
 		free(ifgr.ifgr_groups);
 		close(ifs);
-		return(1);
+		return (-1);
 	}
 
 	ngroups = len / sizeof(ifgr.ifgr_groups[0]);
 	for (i = 0; i < ngroups; i++) {
-		ifg = &ifgr.ifgr_groups[i];
-		if (wordlen > strlen(ifg->ifgrq_group))
-			continue;
-		if (strncmp(word, ifg->ifgrq_group, wordlen) == 0)
-			sl_add(words, ifg->ifgrq_group);
+		if ((s = strdup(ifgr.ifgr_groups[i].ifgrq_group)) == NULL)
+			err(1, "strdup");
+		sl_add(sl, s);
 	}
 
-	rv = complete_ambiguous(word, list, words, el, " ");
-	sl_free(words, 0);
 	free(ifgr.ifgr_groups);
 	close(ifs);
-	return (rv);
+	return (0);
 }
 
-unsigned char
-complete_ifbridge(char *word, int list, EditLine *el)
+static int
+nc_load_ifbridge(StringList *sl)
 {
-	StringList *words;
-	size_t wordlen;
-	unsigned char rv;
 	struct if_nameindex *ifn_list, *ifnp;
 	int ifs;
-
-	words = sl_init();
-	wordlen = strlen(word);
-
-	if ((ifn_list = if_nameindex()) == NULL)
-		return 0;
+	char *s;
 
 	if ((ifs = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
 		printf("%% complete_ifbridge: %s\n", strerror(errno));
-		return(1);
+		return (-1);
+	}
+
+	if ((ifn_list = if_nameindex()) == NULL) {
+		close(ifs);
+		return (-1);
 	}
 
 	for (ifnp = ifn_list; ifnp->if_name != NULL; ifnp++) {
-		if (wordlen > strlen(ifnp->if_name))
-			continue;
 		if (!is_bridge(ifs, ifnp->if_name))
 			continue;
-		if (strncmp(word, ifnp->if_name, wordlen) == 0)
-			sl_add(words, ifnp->if_name);
+		if ((s = strdup(ifnp->if_name)) == NULL)
+			err(1, "strdup");
+		sl_add(sl, s);
 	}
 
-	rv = complete_ambiguous(word, list, words, el, " ");
 	if_freenameindex(ifn_list);
-	sl_free(words, 0);
 	close(ifs);
-	return (rv);
+	return (0);
 }
 
-unsigned char
-complete_rtable(char *word, int list, EditLine *el)
+static int
+nc_load_rtable(StringList *sl)
 {
-	StringList *words, *rtables;
-	size_t wordlen = strlen(word);
-	int i, rv = CC_ERROR;
-	char *s = NULL;
-
-	words = sl_init();
-	rtables = sl_init();
+	char *s;
 
-	if (db_select_rtable_rtables(rtables) < 0) {
+	if (db_select_rtable_rtables(sl) < 0) {
 		printf("%% database failure select rtables rtable\n");
-		goto done;
+		return (-1);
 	}
 
 	/*
 	 * Routing table 0 always exists even if not created by nsh
 	 * and is never present in the database.
 	 */
-	s = strdup("0");
-	if (s == NULL) {
-		printf("%% strdup: %s", strerror(errno));
-		goto done;
-	}
-	sl_add(words, s);
+	if ((s = strdup("0")) == NULL)
+		err(1, "strdup");
+	sl_add(sl, s);
+	return (0);
+}
+
+/*
+ * Drop adjacent duplicates from sorted sl, such as multipath routes.
+ */
+static void
+nc_uniq(StringList *sl)
+{
+	size_t i, n;
 
-	for (i = 0; i < rtables->sl_cur; i++) {
-		char *rtable = rtables->sl_str[i];
-		if (wordlen > strlen(rtable))
+	for (i = n = 0; i < sl->sl_cur; i++) {
+		if (n > 0 && strcmp(sl->sl_str[i], sl->sl_str[n - 1]) == 0) {
+			free(sl->sl_str[i]);
 			continue;
-		if (strncmp(word, rtable, wordlen) == 0)
-			sl_add(words, rtable);
+		}
+		sl->sl_str[n++] = sl->sl_str[i];
+	}
+	sl->sl_cur = n;
+}
+
+/*
+ * Return the sorted names of cache nc, reloading them first if stale.
+ * Kernel tables are reloaded for word unless what was loaded last
+ * already covers it.  On failure the previous names, if any, are kept.
+ */
+static StringList *
+nc_get(int nc, char *word)
+{
+	struct namecache *c = &namecache[nc];
+	struct stat st;
+	StringList *sl;
+	u_int gen;
+
+	if (c->load == NULL) {
+		if (c->sl != NULL && (c->rtable != cli_rtable ||
+		    time(NULL) - c->loaded >= NC_TABLE_TTL ||
+		    strncmp(word, c->filter, strlen(c->filter)) != 0 ||
+		    (c->matched > NC_TABLE_MAX &&
+		    strcmp(word, c->filter) != 0)))
+			c->stale = 1;
+	} else if (nc == NC_RTABLE) {
+		/* other sessions write to the database as well */
+		if (stat(SQ3DBFILE, &st) == 0 &&
+		    timespeccmp(&st.st_mtim, &c->mtim, !=)) {
+			c->mtim = st.st_mtim;
+			c->stale = 1;
+		}
+	} else if ((gen = ifcache_generation()) != c->gen) {
+		c->gen = gen;
+		c->stale = 1;
+	}
+
+	if (c->sl != NULL && !c->stale)
+		return (c->sl);
+
+	sl = sl_init();
+	if (c->load == NULL) {
+		c->matched = rtdump_names(c->af, c->rtflags, cli_rtable, word,
+		    NC_TABLE_MAX, sl);
+		free(c->filter);
+		if ((c->filter = strdup(word)) == NULL)
+			err(1, "strdup");
+		c->rtable = cli_rtable;
+		c->loaded = time(NULL);
+	} else if ((*c->load)(sl) == -1) {
+		sl_free(sl, 1);
+		return (c->sl);
 	}
+	qsort(sl->sl_str, sl->sl_cur, sizeof(char *), comparstr);
+	nc_uniq(sl);
+	if (c->sl != NULL)
+		sl_free(c->sl, 1);
+	c->sl = sl;
+	c->stale = 0;
+	free(c->word);
+	c->word = NULL;
+	return (sl);
+}
+
+/*
+ * Mark every completion cache stale, for changes we make ourselves
+ * which the kernel does not announce.
+ */
+void
+complete_flush(void)
+{
+	size_t i;
+
+	for (i = 0; i < nitems(namecache); i++)
+		namecache[i].stale = 1;
+}
+
+/*
+ * Find the names in cache c which start with word, as [*lo, *hi).
+ * While the user keeps typing the same word each search only narrows
+ * the range found for the previous, shorter, word.
+ */
+static void
+nc_range(struct namecache *c, char *word, size_t *lo, size_t *hi)
+{
+	char **name = c->sl->sl_str;
+	size_t wordlen = strlen(word), l, h, end, mid;
+
+	l = 0;
+	end = c->sl->sl_cur;
+	if (c->word != NULL && strncmp(word, c->word, strlen(c->word)) == 0) {
+		l = c->lo;
+		end = c->hi;
+	}
+
+	h = end;
+	while (l < h) {
+		mid = (l + h) / 2;
+		if (strncmp(name[mid], word, wordlen) < 0)
+			l = mid + 1;
+		else
+			h = mid;
+	}
+	*lo = l;
+
+	h = end;
+	while (l < h) {
+		mid = (l + h) / 2;
+		if (strncmp(name[mid], word, wordlen) == 0)
+			l = mid + 1;
+		else
+			h = mid;
+	}
+	*hi = l;
+
+	free(c->word);
+	c->word = strdup(word);	/* NULL just means no narrowing */
+	c->lo = *lo;
+	c->hi = *hi;
+}
+
+/*
+ * Complete word from cache nc, offering extra as well if it matches.
+ */
+static unsigned char
+complete_cached(int nc, char *word, int list, EditLine *el, char *extra)
+{
+	struct namecache *c = &namecache[nc];
+	StringList *names, *words;
+	size_t lo = 0, hi = 0;
+	unsigned char rv;
 
+	if ((names = nc_get(nc, word)) != NULL)
+		nc_range(c, word, &lo, &hi);
+
+	if (c->load == NULL && c->matched > NC_TABLE_MAX) {
+		/* a partial list would complete wrongly */
+		putc('\n', ttyout);
+		printf("%% %zu entries match, type more of the address\n",
+		    c->matched);
+		return (CC_REDISPLAY);
+	}
+
+	if (extra == NULL || strncmp(word, extra, strlen(word)) != 0)
+		return (complete_range(word, list,
+		    names ? names->sl_str : NULL, lo, hi, el, " "));
+
+	words = sl_init();
+	for (; lo < hi; lo++)
+		sl_add(words, names->sl_str[lo]);
+	sl_add(words, extra);
 	rv = complete_ambiguous(word, list, words, el, " ");
-done:
-	sl_free(rtables, 1);
 	sl_free(words, 0);
-	free(s);
+	return (rv);
+}
+
+unsigned char
+complete_ifname(char *word, int list, EditLine *el)
+{
+	char *extra = NULL;
+
+	/* Handle the pseudo command "show interface status". */
+	if (margc >= 2 && isprefix(margv[0], "show") &&
+	    isprefix(margv[1], "interface"))
+		extra = "status";
+
+	return (complete_cached(NC_IFNAME, word, list, el, extra));
+}
+
+unsigned char
+complete_ifgroup(char *word, int list, EditLine *el)
+{
+	return (complete_cached(NC_IFGROUP, word, list, el, NULL));
+}
+
+unsigned char
+complete_ifbridge(char *word, int list, EditLine *el)
+{
+	return (complete_cached(NC_IFBRIDGE, word, list, el, NULL));
+}
+
+unsigned char
+complete_rtable(char *word, int list, EditLine *el)
+{
+	return (complete_cached(NC_RTABLE, word, list, el, NULL));
+}
+
+/*
+ * Complete an address from kernel table nc.  Commands which also have a
+ * help table show it for an empty word or one that no entry starts with.
+ */
+static unsigned char
+complete_rtentry(int nc, struct ghs *c, char *word, int list, EditLine *el)
+{
+	unsigned char rv = CC_ERROR;
+
+	if (word[0] != '\0' || c->table == NULL)
+		rv = complete_cached(nc, word, list, el, NULL);
+	if (rv == CC_ERROR && c->table != NULL)
+		return (complete_showhelp(word, el, c->table, c->stlen,
+		    c->name, 0));
 	return (rv);
 }
 
@@ -905,6 +1141,16 @@ complete_args(struct ghs *c, char *word, int dolist, EditLine *el, char **table,
 		return (complete_ifbridge(word, dolist, el));
 	case 'r':
 		return (complete_rtable(word, dolist, el));
+	case 'A':	/* ARP table addresses */
+		return (complete_rtentry(NC_ARP, c, word, dolist, el));
+	case 'N':	/* NDP table addresses */
+		return (complete_rtentry(NC_NDP, c, word, dolist, el));
+	case 'R':	/* IPv4 route destinations */
+		return (complete_rtentry(NC_ROUTE, c, word, dolist, el));
+	case 'S':	/* IPv6 route destinations */
+		return (complete_rtentry(NC_ROUTE6, c, word, dolist, el));
+	case 'T':	/* static route destinations */
+		return (complete_rtentry(NC_STATIC, c, word, dolist, el));
 	case 't':	/* points to a table */
 		if (c->table == NULL)
 			return(CC_ERROR);
@@ -933,10 +1179,10 @@ complete_args(struct ghs *c, char *word, int dolist, EditLine *el, char **table,
 }
 
 /*
- * List words in stringlist, vertically arranged
+ * List n words, vertically arranged
  */
 void
-list_vertical(StringList *sl)
+list_vertical(char **str, size_t n)
 {
 	int i, j, w;
 	int columns, width, lines;
@@ -944,8 +1190,8 @@ list_vertical(StringList *sl)
 
 	width = 0;
 
-	for (i = 0 ; i < sl->sl_cur ; i++) {
-		w = strlen(sl->sl_str[i]);
+	for (i = 0 ; i < n ; i++) {
+		w = strlen(str[i]);
 		if (w > width)
 			width = w;
 	}
@@ -954,13 +1200,13 @@ list_vertical(StringList *sl)
 	columns = winsize.ws_col / width;
 	if (columns == 0)
 		columns = 1;
-	lines = (sl->sl_cur + columns - 1) / columns;
+	lines = (n + columns - 1) / columns;
 	for (i = 0; i < lines; i++) {
 		for (j = 0; j < columns; j++) {
-			p = sl->sl_str[j * lines + i];
+			p = str[j * lines + i];
 			if (p)
 				fputs(p, ttyout);
-			if (j * lines + i + lines >= sl->sl_cur) {
+			if (j * lines + i + lines >= n) {
 				putc('\n', ttyout);
 				break;
 			}
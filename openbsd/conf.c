@@ -74,12 +74,13 @@ void conf_brcfg(FILE *, int, struct if_nameindex *, char *);
 void conf_ifxflags(FILE *, int, char *);
 void conf_rtables(FILE *);
 void conf_rtables_rtable(FILE *, int);
+void conf_rtentries(FILE *, char *, int);
 void conf_rdomain(FILE *, int, char *);
 void conf_tunnel(FILE *, int, char *);
 void conf_ifmetrics(FILE *, int, struct if_data, char *);
 void conf_pflow(FILE *, int, char *);
 void conf_pwe3(FILE *, int, char *);
-void conf_ctl(FILE *, char *, char *, int);
+int conf_ctl(FILE *, char *, char *, int);
 void conf_intrtlabel(FILE *, int, char *);
 void conf_intgroup(FILE *, int, char *);
 void conf_keepalive(FILE *, int, char *);
@@ -187,7 +188,6 @@ conf(FILE *output)
 {
 	char cpass[_PASSWORD_LEN+1];
 	char hostbuf[MAXHOSTNAMELEN];
-	off_t offset;
 
 	fprintf(output, "!\n");
 
@@ -233,10 +233,7 @@ conf(FILE *output)
 	/*
 	 * print static arp and route entries in configuration file format
 	 */
-	conf_arp(output, "arp ");
-	conf_ndp(output, "ndp ");
-	conf_routes(output, "route ", AF_INET, RTF_STATIC, 0);
-	conf_routes(output, "route ", AF_INET6, RTF_STATIC, 0);
+	conf_rtentries(output, "", 0);
 
 	fprintf(output, "!\n");
 	/*
@@ -287,9 +284,8 @@ conf(FILE *output)
 	conf_ctl(output, "", "inet", 0);
 	conf_ctl(output, "", "sshd", 0);
 
-	offset = ftello(output);
-	conf_ctl(output, "", "crontab", 0);
-	if (offset != ftello(output)) /* we have custom crontab rules */
+	/* output may be a pipe to the pager, so ask instead of ftello() */
+	if (conf_ctl(output, "", "crontab", 0)) /* custom crontab rules */
 		fprintf(output, "crontab install\n");
 
 	conf_rtables(output);
@@ -352,10 +348,7 @@ void conf_rtables_rtable(FILE *output, int rtableid)
 	 * rdomain is created by specifing one on an interface prior
 	 * to this point. An rdomain creates a new corresponding rtable)
 	 */
-	conf_arp(output, " arp ");
-	conf_ndp(output, " ndp ");
-	conf_routes(output, " route ", AF_INET, RTF_STATIC, rtableid);
-	conf_routes(output, " route ", AF_INET6, RTF_STATIC, rtableid);
+	conf_rtentries(output, " ", rtableid);
 
 	rtable_daemons = sl_init();
 
@@ -409,7 +402,7 @@ get_argnames(int flag_x, char *name, int *defenable, char **fenablenm,
 	}
 }
 
-void conf_ctl(FILE *output, char *delim, char *name, int rtableid)
+int conf_ctl(FILE *output, char *delim, char *name, int rtableid)
 {
 	FILE *conf;
 	struct daemons *x;
@@ -429,7 +422,7 @@ void conf_ctl(FILE *output, char *delim, char *name, int rtableid)
 		if (x2 == NULL || Ambiguous(x2)) {
 			printf("%% conf_ctl: %s: genget internal failure\n",
 			    name);
-			return;
+			return(0);
 		}
 		x_tmpfile = x2->tmpfile;
 		x_name = x2->name;
@@ -439,7 +432,7 @@ void conf_ctl(FILE *output, char *delim, char *name, int rtableid)
 		if (Ambiguous(x)) {
 			printf("%% conf_ctl: %s: genget internal failure\n",
 			    name);
-			return;
+			return(0);
 		}
 
 		x_tmpfile = x->tmpfile;
@@ -479,7 +472,7 @@ void conf_ctl(FILE *output, char *delim, char *name, int rtableid)
 	if ((dbflag = db_select_flag_x_dbflag_rtable("ctl", x_name, rtableid))
 	    < 0) {
 		printf("%% database ctl select failure (%s, %d)\n", x_name, rtableid);
-		return;
+		return(pntdrules);
 	}
 	switch(dbflag) {
 	case DB_X_ENABLE:
@@ -522,6 +515,7 @@ void conf_ctl(FILE *output, char *delim, char *name, int rtableid)
 	}
 	if (pntdflag)
 		fprintf(output, "%s!\n", delim);
+	return(pntdrules || pntdflag);
 }
 
 int
@@ -1193,8 +1187,8 @@ void conf_brcfg(FILE *output, int ifs, struct if_nameindex *ifn_list,
     char *ifname)
 {
 	struct if_nameindex *br_ifnp;
-
-	char tmp_str[TMPSIZ];
+	struct ifbreq *req;
+	u_int nreq;
 	long l_tmp;
 
 	if ((l_tmp = bridge_cfg(ifs, ifname, PRIORITY))
@@ -1216,24 +1210,18 @@ void conf_brcfg(FILE *output, int ifs, struct if_nameindex *ifn_list,
 	    != -1 && l_tmp != DEFAULT_TIMEOUT)
 		fprintf(output, " timeout %ld\n", l_tmp);
 
-	if (bridge_list(ifs, ifname, NULL, tmp_str, TMPSIZ, MEMBER))
-		fprintf(output, " member %s\n", tmp_str);
-	if (bridge_list(ifs, ifname, NULL, tmp_str, TMPSIZ, STP))
-		fprintf(output, " stp %s\n", tmp_str);
-	if (bridge_list(ifs, ifname, NULL, tmp_str, TMPSIZ, SPAN))
-		fprintf(output, " span %s\n", tmp_str);
-	if (bridge_list(ifs, ifname, NULL, tmp_str, TMPSIZ, NOLEARNING))
-		fprintf(output, " no learning %s\n", tmp_str);
-	if (bridge_list(ifs, ifname, NULL, tmp_str, TMPSIZ, NODISCOVER))
-		fprintf(output, " no discover %s\n", tmp_str);
-	if (bridge_list(ifs, ifname, NULL, tmp_str, TMPSIZ, BLOCKNONIP))
-		fprintf(output, " blocknonip %s\n", tmp_str);
-	if (bridge_list(ifs, ifname, " ", tmp_str, TMPSIZ, CONF_IFPRIORITY))
-		fprintf(output, "%s", tmp_str);
-	if (bridge_list(ifs, ifname, " ", tmp_str, TMPSIZ, CONF_IFCOST))
-		fprintf(output, "%s", tmp_str);
-	if (bridge_list(ifs, ifname, " ", tmp_str, TMPSIZ, PROTECTED))
-		fprintf(output, "%s", tmp_str);
+	if ((req = bridge_members(ifs, ifname, &nreq)) != NULL) {
+		bridge_list(req, nreq, " member", MEMBER, output);
+		bridge_list(req, nreq, " stp", STP, output);
+		bridge_list(req, nreq, " span", SPAN, output);
+		bridge_list(req, nreq, " no learning", NOLEARNING, output);
+		bridge_list(req, nreq, " no discover", NODISCOVER, output);
+		bridge_list(req, nreq, " blocknonip", BLOCKNONIP, output);
+		bridge_list(req, nreq, " ", CONF_IFPRIORITY, output);
+		bridge_list(req, nreq, " ", CONF_IFCOST, output);
+		bridge_list(req, nreq, " ", PROTECTED, output);
+		free(req);
+	}
 	bridge_confaddrs(ifs, ifname, " static ", output);
 
 	for (br_ifnp = ifn_list; br_ifnp->if_name != NULL; br_ifnp++)
@@ -1444,21 +1432,50 @@ default_llpriority(char *ifname)
 }
 
 /*
- * Show IPv4/6 or ARP entries from the routing table
+ * Print the static ARP, NDP and route entries of routing table tableid,
+ * each line prefixed by indent.  Every producer only needs the
+ * RTF_LLINFO or the RTF_STATIC part of the table, for both address
+ * families, so fetch those two dumps once and let them all walk the
+ * same buffers instead of asking the kernel once per producer.
+ */
+void
+conf_rtentries(FILE *output, char *indent, int tableid)
+{
+	struct rtdump *llinfo, *statics;
+	char delim[16];
+
+	if (tableid < 0 || tableid > RT_TABLEID_MAX) {
+		printf("%% conf_rtentries: tableid %d out of range\n", tableid);
+		return;
+	}
+
+	/* NULL means an empty table as well as an error */
+	llinfo = getrtdump(0, RTF_LLINFO, tableid);
+	snprintf(delim, sizeof(delim), "%sarp ", indent);
+	conf_arp(output, delim, llinfo);
+	snprintf(delim, sizeof(delim), "%sndp ", indent);
+	conf_ndp(output, delim, llinfo);
+	if (llinfo != NULL)
+		freertdump(llinfo);
+
+	statics = getrtdump(0, RTF_STATIC, tableid);
+	snprintf(delim, sizeof(delim), "%sroute ", indent);
+	conf_routes(output, delim, AF_INET, statics);
+	conf_routes(output, delim, AF_INET6, statics);
+	if (statics != NULL)
+		freertdump(statics);
+}
+
+/*
+ * Show IPv4/6 or ARP entries from a routing table dump
  */
 int
-conf_routes(FILE *output, char *delim, int af, int flags, int tableid)
+conf_routes(FILE *output, char *delim, int af, struct rtdump *rtdump)
 {
 	char *next;
 	struct rt_msghdr *rtm;
-	struct rtdump *rtdump;
 	struct sockaddr *sa;
 
-	if (tableid < 0 || tableid > RT_TABLEID_MAX) {
-		printf("%% conf_routes: tableid %d out of range\n", tableid);
-		return(1);
-	}
-	rtdump = getrtdump(0, flags, tableid);
 	if (rtdump == NULL)
 		return(1);
 
@@ -1477,7 +1494,6 @@ conf_routes(FILE *output, char *delim, int af, int flags, int tableid)
 			printf("%% conf_routes: rtm: %s (errno %d)\n",
 			    strerror(rtm->rtm_errno), rtm->rtm_errno);
 	}
-	freertdump(rtdump);
 	return(1);
 }
 
@@ -1620,6 +1636,7 @@ conf_print_rtm(FILE *output, struct rt_msghdr *rtm, char *delim, int af)
 {
 	int i;
 	char *cp, flags[TMPSIZ], ifname[IFNAMSIZ];
+	char dbuf[ADDRNAMELEN], gbuf[ADDRNAMELEN];
 	struct sockaddr *dst = NULL, *gate = NULL, *mask = NULL;
 	struct sockaddr_rtlabel *sa_rl = NULL;
 	struct sockaddr *sa;
@@ -1673,9 +1690,9 @@ conf_print_rtm(FILE *output, struct rt_msghdr *rtm, char *delim, int af)
 		/* Special case for dynamic default route via pppoe(4) */
 		if (af == AF_INET && isdefaultroute(dst, mask) &&
 		    isprefix("pppoe", ifname)) {
-			pppoe_conf_default_route(output, ifname,
-			    delim, netname(dst, mask),
-			    routename(gate), flags);
+			pppoe_conf_default_route(output, ifname, delim,
+			    netname_r(dst, mask, dbuf, sizeof(dbuf)),
+			    routename_r(gate, gbuf, sizeof(gbuf)), flags);
 		}
 		/*
 		 * Suppress printing IPv4 route if it's the default
@@ -1683,14 +1700,17 @@ conf_print_rtm(FILE *output, struct rt_msghdr *rtm, char *delim, int af)
 		 */
 		else if (!(af == AF_INET && isdefaultroute(dst, mask)
 		    && (dhcpleased_has_defaultroute(sa_rl) ||
-		    dhclient_isenabled(routename(gate))))) {
-			fprintf(output, "%s%s ", delim, netname(dst, mask));
-			fprintf(output, "%s%s\n", routename(gate), flags);
+		    dhclient_isenabled(routename_r(gate, gbuf,
+		    sizeof(gbuf)))))) {
+			fprintf(output, "%s%s %s%s\n", delim,
+			    netname_r(dst, mask, dbuf, sizeof(dbuf)),
+			    routename_r(gate, gbuf, sizeof(gbuf)), flags);
 		}
 	} else if (dst && gate && (af == AF_LINK)) {
 		/* print arp */
-		fprintf(output, "%s%s ", delim, routename(dst));
-		fprintf(output, "%s\n", routename(gate));
+		fprintf(output, "%s%s %s\n", delim,
+		    routename_r(dst, dbuf, sizeof(dbuf)),
+		    routename_r(gate, gbuf, sizeof(gbuf)));
 	}
 	explicit_bzero(flags, TMPSIZ);
 }
@@ -0,0 +1,548 @@
+/*
+ * export: serve counters to Prometheus, nsh -E socket | port
+ *
+ * A small HTTP/1.0 server on a local socket or a loopback TCP port
+ * answers GET /metrics with the text exposition of the interface
+ * counters, the protocol statistics of stats.c, the mbuf pools and the
+ * state of carp and pfsync interfaces.  A scrape collects everything in
+ * one pass into memory, and the result is served again to any scrape
+ * arriving within EXPORT_CACHE, so several Prometheus servers scraping
+ * the same host cost the kernel no more than one.  Clients are served
+ * one at a time, each within EXPORT_TIMEOUT.  The format itself is
+ * prom.c.
+ */
+
+#include <sys/param.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+#include <net/if.h>
+#include <net/if_types.h>
+#include <net/pfvar.h>
+#include <net/if_pfsync.h>
+#include <netinet/in.h>
+#include <netinet/ip_carp.h>
+#include <arpa/inet.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <ifaddrs.h>
+#include <poll.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "externs.h"
+#include "prom.h"
+
+#define EXPORT_CACHE	1000	/* ms a scrape is served again for */
+#define EXPORT_TIMEOUT	5000	/* ms a client has to talk to us */
+#define EXPORT_REQSIZE	4096	/* longest request header we read */
+#define EXPORT_BACKLOG	16
+
+struct scrape {
+	char		*buf;
+	size_t		 len;
+	struct timespec	 when;
+};
+
+/* if_data counters, by offset */
+static const struct {
+	const char	*name;
+	const char	*help;
+	size_t		 off;
+} ifcounters[] = {
+	{ "nsh_if_ipackets_total", "packets received",
+	    offsetof(struct if_data, ifi_ipackets) },
+	{ "nsh_if_ierrors_total", "input errors",
+	    offsetof(struct if_data, ifi_ierrors) },
+	{ "nsh_if_opackets_total", "packets sent",
+	    offsetof(struct if_data, ifi_opackets) },
+	{ "nsh_if_oerrors_total", "output errors",
+	    offsetof(struct if_data, ifi_oerrors) },
+	{ "nsh_if_collisions_total", "collisions",
+	    offsetof(struct if_data, ifi_collisions) },
+	{ "nsh_if_ibytes_total", "bytes received",
+	    offsetof(struct if_data, ifi_ibytes) },
+	{ "nsh_if_obytes_total", "bytes sent",
+	    offsetof(struct if_data, ifi_obytes) },
+	{ "nsh_if_imcasts_total", "multicast packets received",
+	    offsetof(struct if_data, ifi_imcasts) },
+	{ "nsh_if_omcasts_total", "multicast packets sent",
+	    offsetof(struct if_data, ifi_omcasts) },
+	{ "nsh_if_iqdrops_total", "packets dropped on input",
+	    offsetof(struct if_data, ifi_iqdrops) },
+	{ "nsh_if_oqdrops_total", "packets dropped on output",
+	    offsetof(struct if_data, ifi_oqdrops) },
+	{ "nsh_if_noproto_total", "packets for unknown protocols",
+	    offsetof(struct if_data, ifi_noproto) },
+};
+
+/* protocol statistics, see stats_export() */
+static void (*const export_stats[])(void) = {
+	ip_stats, icmp_stats, igmp_stats, tcp_stats, udp_stats, ah_stats,
+	esp_stats, ipip_stats, ipcomp_stats, carp_stats, pfsync_stats,
+	rt_stats, mbpr,
+};
+
+static volatile sig_atomic_t export_stop;
+
+static void	export_sig(int);
+static int	export_listen(const char *, struct sockaddr_un *);
+static int	export_scrape(struct scrape *);
+static void	export_ifs(struct prom *);
+static void	export_kernel(struct prom *);
+static void	export_carp(struct prom *, int, struct ifaddrs **, size_t);
+static void	export_pfsync(struct prom *, int, struct ifaddrs **, size_t);
+static int	export_wait(int, short, const struct timespec *);
+static void	export_client(int, struct scrape *);
+static void	export_reply(int, const char *, const char *, size_t,
+		    const struct timespec *);
+
+/* what a scrape collects, in order */
+static void (*const export_collectors[])(struct prom *) = {
+	export_ifs, export_kernel,
+};
+
+static void
+export_sig(int signo)
+{
+	export_stop = 1;
+}
+
+/*
+ * Serve until a signal.  where is a port number, which is bound on the
+ * IPv4 loopback address, or the path of a unix socket.
+ */
+int
+exporter(const char *where)
+{
+	struct sockaddr_un sun;
+	struct sigaction sa;
+	struct pollfd pfd;
+	struct scrape cache;
+	int s, c;
+
+	if ((s = export_listen(where, &sun)) == -1)
+		return (1);
+
+	memset(&sa, 0, sizeof(sa));
+	sigemptyset(&sa.sa_mask);
+	sa.sa_handler = export_sig;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	sigaction(SIGHUP, &sa, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	memset(&cache, 0, sizeof(cache));
+	printf("%% export: serving on %s\n", where);
+	fflush(stdout);
+
+	while (!export_stop) {
+		pfd.fd = s;
+		pfd.events = POLLIN;
+		if (poll(&pfd, 1, INFTIM) == -1) {
+			if (errno == EINTR)
+				continue;
+			printf("%% export: poll: %s\n", strerror(errno));
+			break;
+		}
+		c = accept4(s, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (c == -1)
+			continue;
+		export_client(c, &cache);
+		close(c);
+	}
+
+	close(s);
+	if (sun.sun_family == AF_UNIX)
+		unlink(sun.sun_path);
+	free(cache.buf);
+	return (0);
+}
+
+static int
+export_listen(const char *where, struct sockaddr_un *sun)
+{
+	struct sockaddr_in sin;
+	struct stat sb;
+	const char *errstr;
+	int s, probe, port, on = 1;
+
+	memset(sun, 0, sizeof(*sun));
+
+	if (where[0] != '\0' && where[strspn(where, "0123456789")] == '\0') {
+		port = strtonum(where, 1, 65535, &errstr);
+		if (errstr) {
+			printf("%% export: port %s is %s\n", where, errstr);
+			return (-1);
+		}
+		memset(&sin, 0, sizeof(sin));
+		sin.sin_len = sizeof(sin);
+		sin.sin_family = AF_INET;
+		sin.sin_port = htons(port);
+		sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		if ((s = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC,
+		    0)) == -1) {
+			printf("%% export: socket: %s\n", strerror(errno));
+			return (-1);
+		}
+		setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+		if (bind(s, (struct sockaddr *)&sin, sizeof(sin)) == -1) {
+			printf("%% export: bind 127.0.0.1:%d: %s\n", port,
+			    strerror(errno));
+			close(s);
+			return (-1);
+		}
+	} else {
+		sun->sun_family = AF_UNIX;
+		if (strlcpy(sun->sun_path, where, sizeof(sun->sun_path)) >=
+		    sizeof(sun->sun_path)) {
+			printf("%% export: %s: name too long\n", where);
+			return (-1);
+		}
+		if ((s = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC,
+		    0)) == -1) {
+			printf("%% export: socket: %s\n", strerror(errno));
+			return (-1);
+		}
+		/* replace a socket left behind, but nothing else */
+		if (lstat(where, &sb) == 0) {
+			if (!S_ISSOCK(sb.st_mode)) {
+				printf("%% export: %s exists and is not a "
+				    "socket\n", where);
+				close(s);
+				return (-1);
+			}
+			if ((probe = socket(AF_UNIX, SOCK_STREAM, 0)) != -1 &&
+			    connect(probe, (struct sockaddr *)sun,
+			    sizeof(*sun)) == 0) {
+				printf("%% export: %s is in use\n", where);
+				close(probe);
+				close(s);
+				return (-1);
+			}
+			if (probe != -1)
+				close(probe);
+			unlink(where);
+		}
+		if (bind(s, (struct sockaddr *)sun, sizeof(*sun)) == -1) {
+			printf("%% export: bind %s: %s\n", where,
+			    strerror(errno));
+			close(s);
+			return (-1);
+		}
+	}
+
+	if (listen(s, EXPORT_BACKLOG) == -1) {
+		printf("%% export: listen: %s\n", strerror(errno));
+		close(s);
+		if (sun->sun_family == AF_UNIX)
+			unlink(sun->sun_path);
+		return (-1);
+	}
+	return (s);
+}
+
+/*
+ * Render a scrape into cache, unless the one there is recent enough.
+ */
+static int
+export_scrape(struct scrape *cache)
+{
+	struct timespec now, age;
+	char *buf;
+	size_t len;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (cache->buf != NULL) {
+		timespecsub(&now, &cache->when, &age);
+		if (age.tv_sec * 1000 + age.tv_nsec / 1000000 < EXPORT_CACHE)
+			return (0);
+	}
+
+	if (prom_render(export_collectors, nitems(export_collectors), &buf,
+	    &len) == -1)
+		return (-1);
+
+	free(cache->buf);
+	cache->buf = buf;
+	cache->len = len;
+	cache->when = now;
+	return (0);
+}
+
+/*
+ * Protocol statistics and mbuf usage, from stats.c.
+ */
+static void
+export_kernel(struct prom *p)
+{
+	size_t i;
+
+	for (i = 0; i < nitems(export_stats); i++)
+		stats_export(export_stats[i], p);
+}
+
+/*
+ * Interface state and counters, from a single getifaddrs(3) snapshot.
+ */
+static void
+export_ifs(struct prom *p)
+{
+	struct ifaddrs *ifap, *ifa, **link;
+	struct if_data *ifd;
+	size_t n = 0, i, j;
+	int s;
+
+	if (getifaddrs(&ifap) == -1) {
+		printf("%% export: getifaddrs: %s\n", strerror(errno));
+		return;
+	}
+	for (ifa = ifap; ifa != NULL; ifa = ifa->ifa_next)
+		if (ifa->ifa_addr != NULL &&
+		    ifa->ifa_addr->sa_family == AF_LINK &&
+		    ifa->ifa_data != NULL)
+			n++;
+	if ((link = calloc(n + 1, sizeof(*link))) == NULL) {
+		printf("%% export: calloc: %s\n", strerror(errno));
+		freeifaddrs(ifap);
+		return;
+	}
+	for (n = 0, ifa = ifap; ifa != NULL; ifa = ifa->ifa_next)
+		if (ifa->ifa_addr != NULL &&
+		    ifa->ifa_addr->sa_family == AF_LINK &&
+		    ifa->ifa_data != NULL)
+			link[n++] = ifa;
+
+#define IFD(i)	((struct if_data *)link[(i)]->ifa_data)
+	prom_family(p, "nsh_if_up", "gauge", "interface is up");
+	for (i = 0; i < n; i++)
+		prom_sample(p, (link[i]->ifa_flags & IFF_UP) != 0,
+		    "interface", link[i]->ifa_name, NULL);
+	prom_family(p, "nsh_if_running", "gauge", "interface is running");
+	for (i = 0; i < n; i++)
+		prom_sample(p, (link[i]->ifa_flags & IFF_RUNNING) != 0,
+		    "interface", link[i]->ifa_name, NULL);
+	prom_family(p, "nsh_if_link_up", "gauge", "interface has link");
+	for (i = 0; i < n; i++)
+		prom_sample(p, LINK_STATE_IS_UP(IFD(i)->ifi_link_state),
+		    "interface", link[i]->ifa_name, NULL);
+	prom_family(p, "nsh_if_mtu", "gauge", NULL);
+	for (i = 0; i < n; i++)
+		prom_sample(p, IFD(i)->ifi_mtu,
+		    "interface", link[i]->ifa_name, NULL);
+	prom_family(p, "nsh_if_baudrate", "gauge", "line speed in bits/s");
+	for (i = 0; i < n; i++)
+		prom_sample(p, IFD(i)->ifi_baudrate,
+		    "interface", link[i]->ifa_name, NULL);
+
+	for (j = 0; j < nitems(ifcounters); j++) {
+		prom_family(p, ifcounters[j].name, "counter",
+		    ifcounters[j].help);
+		for (i = 0; i < n; i++) {
+			ifd = IFD(i);
+			prom_sample(p, *(u_int64_t *)((char *)ifd +
+			    ifcounters[j].off), "interface",
+			    link[i]->ifa_name, NULL);
+		}
+	}
+#undef IFD
+
+	if ((s = socket(AF_INET, SOCK_DGRAM, 0)) == -1) {
+		printf("%% export: socket: %s\n", strerror(errno));
+	} else {
+		export_carp(p, s, link, n);
+		export_pfsync(p, s, link, n);
+		close(s);
+	}
+
+	free(link);
+	freeifaddrs(ifap);
+}
+
+static void
+export_carp(struct prom *p, int s, struct ifaddrs **link, size_t n)
+{
+	struct ifreq ifr;
+	struct carpreq creq;
+	char vhid[8];
+	size_t i;
+	int j;
+
+	prom_family(p, "nsh_carp_state", "gauge",
+	    "carp state, 0 init, 1 backup, 2 master");
+	for (i = 0; i < n; i++) {
+		if (((struct if_data *)link[i]->ifa_data)->ifi_type !=
+		    IFT_CARP)
+			continue;
+		memset(&creq, 0, sizeof(creq));
+		memset(&ifr, 0, sizeof(ifr));
+		ifr.ifr_data = (caddr_t)&creq;
+		strlcpy(ifr.ifr_name, link[i]->ifa_name, sizeof(ifr.ifr_name));
+		if (ioctl(s, SIOCGVH, (caddr_t)&ifr) == -1)
+			continue;
+		for (j = 0; j < CARP_MAXNODES && creq.carpr_vhids[j]; j++) {
+			snprintf(vhid, sizeof(vhid), "%u",
+			    creq.carpr_vhids[j]);
+			prom_sample(p, creq.carpr_states[j],
+			    "interface", link[i]->ifa_name,
+			    "vhid", vhid, "carpdev", creq.carpr_carpdev, NULL);
+		}
+	}
+}
+
+static void
+export_pfsync(struct prom *p, int s, struct ifaddrs **link, size_t n)
+{
+	struct ifreq ifr;
+	struct pfsyncreq preq;
+	size_t i;
+
+	prom_family(p, "nsh_pfsync_up", "gauge",
+	    "pfsync interface is up, with its sync device and peer");
+	for (i = 0; i < n; i++) {
+		if (((struct if_data *)link[i]->ifa_data)->ifi_type !=
+		    IFT_PFSYNC)
+			continue;
+		memset(&preq, 0, sizeof(preq));
+		memset(&ifr, 0, sizeof(ifr));
+		ifr.ifr_data = (caddr_t)&preq;
+		strlcpy(ifr.ifr_name, link[i]->ifa_name, sizeof(ifr.ifr_name));
+		if (ioctl(s, SIOCGETPFSYNC, (caddr_t)&ifr) == -1)
+			continue;
+		prom_sample(p, (link[i]->ifa_flags & IFF_UP) != 0,
+		    "interface", link[i]->ifa_name,
+		    "syncdev", preq.pfsyncr_syncdev,
+		    "syncpeer", inet_ntoa(preq.pfsyncr_syncpeer),
+		    "defer", preq.pfsyncr_defer ? "yes" : "no", NULL);
+	}
+}
+
+/*
+ * Wait for events on fd until deadline: 1 when ready, 0 on timeout.
+ */
+static int
+export_wait(int fd, short events, const struct timespec *deadline)
+{
+	struct timespec now, left;
+	struct pollfd pfd;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (!timespeccmp(&now, deadline, <))
+		return (0);
+	timespecsub(deadline, &now, &left);
+	pfd.fd = fd;
+	pfd.events = events;
+	return (poll(&pfd, 1, left.tv_sec * 1000 + left.tv_nsec / 1000000 +
+	    1) > 0);
+}
+
+/*
+ * Read one request and answer it.  Anything but GET or HEAD of / or
+ * /metrics is turned away.
+ */
+static void
+export_client(int fd, struct scrape *cache)
+{
+	struct timespec deadline;
+	char req[EXPORT_REQSIZE], *path, *end;
+	size_t len = 0;
+	ssize_t r;
+	int head;
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += EXPORT_TIMEOUT / 1000;
+
+	while (len < sizeof(req) - 1) {
+		if (!export_wait(fd, POLLIN, &deadline))
+			return;
+		r = read(fd, req + len, sizeof(req) - 1 - len);
+		if (r == -1 && (errno == EAGAIN || errno == EINTR))
+			continue;
+		if (r <= 0)
+			return;
+		len += r;
+		req[len] = '\0';
+		if (strstr(req, "\r\n\r\n") != NULL ||
+		    strstr(req, "\n\n") != NULL)
+			break;
+	}
+	req[len] = '\0';
+
+	if (strncmp(req, "GET ", 4) == 0)
+		head = 0;
+	else if (strncmp(req, "HEAD ", 5) == 0)
+		head = 1;
+	else {
+		export_reply(fd, "405 Method Not Allowed", NULL, 0, &deadline);
+		return;
+	}
+	path = req + (head ? 5 : 4);
+	end = path + strcspn(path, " \r\n");
+	*end = '\0';
+	if (strcmp(path, "/metrics") != 0 && strcmp(path, "/") != 0) {
+		export_reply(fd, "404 Not Found", NULL, 0, &deadline);
+		return;
+	}
+
+	if (export_scrape(cache) == -1) {
+		export_reply(fd, "500 Internal Server Error", NULL, 0,
+		    &deadline);
+		return;
+	}
+	export_reply(fd, "200 OK", head ? NULL : cache->buf, cache->len,
+	    &deadline);
+}
+
+/*
+ * Send a reply of len bytes, of which body is written unless NULL.
+ */
+static void
+export_reply(int fd, const char *status, const char *body, size_t len,
+    const struct timespec *deadline)
+{
+	char hdr[256];
+	struct iovec iov[2];
+	ssize_t r;
+	int n, i = 0;
+
+	n = snprintf(hdr, sizeof(hdr), "HTTP/1.0 %s\r\n"
+	    "Content-Type: text/plain; version=0.0.4\r\n"
+	    "Content-Length: %zu\r\n"
+	    "Connection: close\r\n\r\n", status, len);
+	iov[0].iov_base = hdr;
+	iov[0].iov_len = n;
+	iov[1].iov_base = (void *)body;
+	iov[1].iov_len = body != NULL ? len : 0;
+
+	while (i < 2) {
+		if (iov[i].iov_len == 0) {
+			i++;
+			continue;
+		}
+		if (!export_wait(fd, POLLOUT, deadline))
+			return;
+		r = writev(fd, &iov[i], 2 - i);
+		if (r == -1 && (errno == EAGAIN || errno == EINTR))
+			continue;
+		if (r == -1)
+			return;
+		while (i < 2 && (size_t)r >= iov[i].iov_len) {
+			r -= iov[i].iov_len;
+			iov[i++].iov_len = 0;
+		}
+		if (i < 2) {
+			iov[i].iov_base = (char *)iov[i].iov_base + r;
+			iov[i].iov_len -= r;
+		}
+	}
+}
@@ -39,7 +39,9 @@ extern char saveline[1024];	/* command line */
 extern char line[1024];		/* command line for makeargv() */
 extern int  margc;		/* makeargv() arg count */
 extern char *margv[];		/* makeargv() args */
+extern char margbar[];		/* makeargv() output filter bar */
 extern int verbose;		/* is verbose mode on? */
+extern int json_output;		/* do show commands print JSON? */
 extern int editing;		/* is command line editing mode on? */
 extern int interactive_mode;	/* are we in interactive mode? */
 extern int config_mode;		/* are we in comfig mode? */
@@ -93,12 +95,19 @@ void conf_sppp(FILE *, int, char *);
 int conf(FILE *);
 void conf_interfaces(FILE *, char *, int);
 u_long default_mtu(char *);
-int conf_routes(FILE *, char *, int, int, int);
+int conf_routes(FILE *, char *, int, struct rtdump *);
 int conf_dhcrelay(char *, char *, int);
 int dhcpleased_has_address(char *, const char *, const char *);
 
 /* show.c */
 void p_rttables(int, u_int, int);
+void p_rtsummary(int, u_int);
+void pr_rthdr(int);
+#ifdef _NET_ROUTE_H_
+void p_rtentry(struct rt_msghdr *);
+#endif
+void p_rtbegin(void);
+void p_rtend(void);
 #ifdef _NETINET_IN_H_
 char *routename4(in_addr_t);
 char *netname4(in_addr_t, struct sockaddr_in *);
@@ -106,12 +115,24 @@ char *netname4(in_addr_t, struct sockaddr_in *);
 #ifdef _NETINET6_IN6_H_
 char *routename6(struct sockaddr_in6 *);
 char *netname6(struct sockaddr_in6 *, struct sockaddr_in6 *);
-void in6_fillscopeid(struct sockaddr_in6 *);
-void in6_clearscopeid(struct sockaddr_in6 *);
 #endif
 #ifdef _SYS_SOCKET_H_
 char *routename(struct sockaddr *);
 char *netname(struct sockaddr *, struct sockaddr *);
+char *link_print(struct sockaddr *);
+#endif
+
+/* addrname.c */
+#ifdef _NETINET6_IN6_H_
+char *inet6_ntop_r(struct sockaddr_in6 *, char *, size_t);
+void in6_fillscopeid(struct sockaddr_in6 *);
+void in6_clearscopeid(struct sockaddr_in6 *);
+#endif
+#ifdef _SYS_SOCKET_H_
+#define ADDRNAMELEN	128	/* routename_r()/netname_r() buffer size */
+char *routename_r(struct sockaddr *, char *, size_t);
+char *netname_r(struct sockaddr *, struct sockaddr *, char *, size_t);
+int mask_prefixlen(int, struct sockaddr *, int *);
 char *any_ntoa(const struct sockaddr *);
 #endif
 
@@ -146,9 +167,12 @@ extern u_long rtm_inits;
 #define FLUSH 0
 struct rtdump *getrtdump(int, int, int);
 void freertdump(struct rtdump *);
+#ifdef _STRINGLIST_H
+int rtdump_names(int, int, int, const char *, size_t, StringList *);
+#endif
 int monitor(int, char **);
 int rtmsg(int, int, int, int, int);
-void flushroutes(int, int);
+int flushroutes(int, int, char *, int);
 void bprintf(FILE *, int, u_char *);
 #ifdef _NET_IF_DL_H_
 char *mylink_ntoa(const struct sockaddr_dl *);
@@ -279,6 +303,13 @@ int inttxpower(char *, int, int, char **);
 int intbssid(char *, int, int, char **);
 
 /* stats.c */
+#define STATS_SHOW	0	/* print the counters */
+#define STATS_DELTA	1	/* print changes since the last snapshot */
+#define STATS_MARK	2	/* only take a snapshot */
+#define STATS_EXPORT	3	/* write the counters for the exporter */
+struct prom;
+void stats_run(void (*)(void), int);
+void stats_export(void (*)(void), struct prom *);
 void rt_stats(void);
 void tcp_stats(void);
 void udp_stats(void);
@@ -313,7 +344,7 @@ void conf_sysctls(FILE *);
 #define NO_NETMASK 0
 #define ASSUME_NETMASK 1
 int route(int, char**);
-void show_route(char *, int);
+void show_route(char *, char *, int);
 int is_ip_addr(char *);
 #ifdef _IP_T_
 void parse_ip_pfx(char *, int, ip_t *);
@@ -324,6 +355,17 @@ int rtnameserver(int, char *[], int);
 int parse_ipv6(char *, struct in6_addr *);
 #endif
 
+/* rtree.c */
+#define RTREE_EXACT	0	/* rtree_match() modes */
+#define RTREE_LONGER	1
+#define RTREE_BEST	2
+struct rtree;
+struct rtree *rtree_build(struct rtdump *, int);
+#ifdef _NET_ROUTE_H_
+int rtree_match(struct rtree *, void *, int, int, void (*)(struct rt_msghdr *));
+#endif
+void rtree_free(struct rtree *);
+
 /* if.c */
 #define DHCLIENT	"/sbin/dhclient"
 #define DHCRELAY	"/usr/sbin/dhcrelay"
@@ -341,9 +383,12 @@ int parse_ipv6(char *, struct in6_addr *);
 void imr_init(char *);
 int is_valid_ifname(char *);
 int show_int(int, char **, FILE *);
+struct ifaddrs;
+void show_int_status_list(struct ifaddrs *, int, FILE *);
+int show_int_counters(FILE *, void *);
 int show_vlans(int, char **);
 int show_ip(int, char **);
-int show_autoconf(int, char **);
+int show_autoconf(int, char **, FILE *);
 int get_rdomain(int, char *);
 int get_ifdata(char *, int);
 int get_ifflags(char *, int);
@@ -398,7 +443,6 @@ extern char compiled[], compiledby[], compiledon[], compilehost[];
 long bridge_cfg(int, char *, int);
 int bridge_confaddrs(int, char *, char *, FILE *);
 int bridge_rules(int, char *, char *, char *, FILE *);
-int bridge_list(int, char *, char *, char *, int, int);
 int bridge_member_search(int, char *);
 int bridge_addrs(int, char *, char *, char *, FILE *);
 int set_ifflag(int, char *, short);
@@ -478,25 +522,44 @@ int who(int, char **);
 int arpget(const char *);
 int arpset(int, char **);
 void arpdump(void);
-void conf_arp(FILE *, char *);
+void conf_arp(FILE *, char *, struct rtdump *);
 char *sec2str(time_t);
 struct sockaddr_dl;
+#define ETHER_STRLEN	sizeof("xx:xx:xx:xx:xx:xx") /* ether_str_r() buffer */
 char *ether_str(struct sockaddr_dl *);
+char *ether_str_r(struct sockaddr_dl *, char *, size_t);
 
 /* ndp.c */
 int ndpset(int, char **);
 void ndpget(const char *);
 int ndpdelete(const char *);
 struct sockaddr_in6;
-void ndpdump(struct sockaddr_in6 *, int);
-void conf_ndp(FILE *output, char *delim);
+#define NDP_BRIEF	0	/* columns from the route dump only */
+#define NDP_DETAIL	1	/* add state, router and probes per entry */
+#define NDP_SUMMARY	2	/* state counts only */
+void ndpdump(struct sockaddr_in6 *, int, int);
+void conf_ndp(FILE *output, char *delim, struct rtdump *);
 
 /* nameserver.c */
 int nameserverset(int, char **);
 void conf_nameserver(FILE *);
 
+/* watch.c */
+int watch(char *, int, int, int (*)(FILE *, void *), void *);
+
+/* export.c */
+int exporter(const char *);
+
 /* more.c */
 int more(char *);
+int more_fd(int);
+int more_buf(const char *, size_t);
+struct filter;
+FILE *more_open(struct filter *);
+int more_close(FILE *);
+int more_stdout(struct filter *);
+int more_endstdout(void);
+void more_abort(void);
 int nsh_cbreak(void);
 void nsh_nocbreak(void);
 void setwinsize(int);
@@ -511,6 +574,7 @@ void inithist(void);
 void endhist(void);
 void initedit(void);
 void endedit(void);
+void complete_flush(void);
 
 /* utils.c */
 int string_index(char *, char **);
@@ -579,6 +643,12 @@ int mbsavis(char**, int *, const char *);
 int pr_prot1(int, char **);
 char **step_optreq(char **, char **, int, char **, int);
 
+/* ifcache.c */
+void ifcache_sync(void);
+void ifcache_flush(void);
+u_int ifcache_generation(void);
+const char *ifcache_name(u_int);
+
 /* hashtable.c */
 struct hashtable;
 struct hashtable *hashtable_alloc(void);
@@ -0,0 +1,316 @@
+/*
+ * filter: output filters after a | on the command line
+ *
+ * "show running-config | section interface | include description"
+ * passes every line of output through each stage in turn, inside nsh,
+ * before the pager sees it.  Regular expressions are compiled once,
+ * when the command line is read.  Lines are handed on as they arrive,
+ * except that a section is held until it is known whether it matches
+ * and a count is only known at the end.
+ */
+
+#include <sys/types.h>
+
+#include <errno.h>
+#include <regex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "externs.h"
+#include "filter.h"
+
+#define FILTER_MATCH	0	/* include, exclude, grep */
+#define FILTER_BEGIN	1
+#define FILTER_SECTION	2
+#define FILTER_COUNT	3
+
+struct filter_stage {
+	int		 type;
+	int		 invert;	/* exclude, grep -v */
+	int		 hasre;
+	regex_t		 re;
+	int		 begun;		/* begin: a line has matched */
+	u_int64_t	 count;
+	char		*held;		/* section: NUL terminated lines */
+	size_t		 heldlen, heldsize;
+	int		 heldmatch;
+};
+
+struct filter {
+	struct filter_stage *stage;
+	size_t		 nstage;
+	void		(*out)(const char *, size_t, void *);
+	void		*arg;
+};
+
+static struct filtertab {
+	char	*name;
+	int	 type;
+	int	 invert;
+	int	 needre;
+	int	 options;	/* takes -i and -v */
+} filtertab[] = {
+	{ "include",	FILTER_MATCH,	0, 1, 0 },
+	{ "exclude",	FILTER_MATCH,	1, 1, 0 },
+	{ "begin",	FILTER_BEGIN,	0, 1, 0 },
+	{ "section",	FILTER_SECTION,	0, 1, 0 },
+	{ "count",	FILTER_COUNT,	0, 0, 0 },
+	{ "grep",	FILTER_MATCH,	0, 1, 1 },
+};
+
+static void	filter_usage(void);
+static int	filter_match(struct filter_stage *, const char *);
+static void	filter_pass(struct filter *, size_t, const char *, size_t);
+static void	filter_hold(struct filter *, size_t, const char *, size_t);
+static void	filter_release(struct filter *, size_t);
+
+static void
+filter_usage(void)
+{
+	printf("%% <command> | include|exclude|begin|section <regex>\n");
+	printf("%% <command> | grep [-iv] <regex>\n");
+	printf("%% <command> | count [<regex>]\n");
+}
+
+/*
+ * Compile the stages of argv, each of which starts with a bar token
+ * from makeargv().  The words after a filter name are its pattern.
+ */
+struct filter *
+filter_compile(int argc, char **argv, const char *bar)
+{
+	struct filter *f;
+	struct filter_stage *st;
+	struct filtertab *ft;
+	char pattern[1024], errbuf[128];
+	int i, j, k, cflags, error;
+	size_t n;
+
+	if ((f = calloc(1, sizeof(*f))) == NULL) {
+		printf("%% filter_compile: calloc: %s\n", strerror(errno));
+		return (NULL);
+	}
+
+	for (i = 1; i <= argc; i = j + 1) {
+		for (j = i; j < argc && argv[j] != bar; j++)
+			;
+		if (i == j || argv[i][0] == '?') {
+			filter_usage();
+			goto fail;
+		}
+		for (ft = filtertab; ft < filtertab + nitems(filtertab); ft++)
+			if (isprefix(argv[i], ft->name))
+				break;
+		if (ft == filtertab + nitems(filtertab)) {
+			printf("%% Unknown output filter %s\n", argv[i]);
+			filter_usage();
+			goto fail;
+		}
+
+		st = reallocarray(f->stage, f->nstage + 1, sizeof(*st));
+		if (st == NULL) {
+			printf("%% filter_compile: reallocarray: %s\n",
+			    strerror(errno));
+			goto fail;
+		}
+		f->stage = st;
+		st = &f->stage[f->nstage];
+		memset(st, 0, sizeof(*st));
+		st->type = ft->type;
+		st->invert = ft->invert;
+
+		cflags = REG_EXTENDED | REG_NOSUB;
+		for (k = i + 1; ft->options && k < j && argv[k][0] == '-' &&
+		    argv[k][1] != '\0'; k++) {
+			char *o;
+
+			for (o = argv[k] + 1; *o != '\0'; o++) {
+				if (*o == 'v')
+					st->invert = !st->invert;
+				else if (*o == 'i')
+					cflags |= REG_ICASE;
+				else {
+					filter_usage();
+					goto fail;
+				}
+			}
+		}
+
+		/* the rest of the stage, spaces and all, is the pattern */
+		pattern[0] = '\0';
+		for (n = 0; k < j; k++) {
+			if (n > 0)
+				n = strlcat(pattern, " ", sizeof(pattern));
+			n = strlcat(pattern, argv[k], sizeof(pattern));
+		}
+		if (n >= sizeof(pattern)) {
+			printf("%% %s: pattern too long\n", ft->name);
+			goto fail;
+		}
+		if (n == 0 && ft->needre) {
+			printf("%% %s: pattern required\n", ft->name);
+			goto fail;
+		}
+		if (n > 0) {
+			if ((error = regcomp(&st->re, pattern, cflags)) != 0) {
+				regerror(error, &st->re, errbuf,
+				    sizeof(errbuf));
+				printf("%% %s: %s\n", ft->name, errbuf);
+				goto fail;
+			}
+			st->hasre = 1;
+		}
+		f->nstage++;
+	}
+	return (f);
+
+ fail:
+	filter_free(f);
+	return (NULL);
+}
+
+static int
+filter_match(struct filter_stage *st, const char *line)
+{
+	int match = 1;
+
+	if (st->hasre)
+		match = (regexec(&st->re, line, 0, NULL, 0) == 0);
+	return (match != st->invert);
+}
+
+/*
+ * Feed line, which is NUL terminated at len, to stage i and on.
+ */
+static void
+filter_pass(struct filter *f, size_t i, const char *line, size_t len)
+{
+	struct filter_stage *st;
+
+	for (; i < f->nstage; i++) {
+		st = &f->stage[i];
+		switch (st->type) {
+		case FILTER_MATCH:
+			if (!filter_match(st, line))
+				return;
+			break;
+		case FILTER_BEGIN:
+			if (!st->begun && !filter_match(st, line))
+				return;
+			st->begun = 1;
+			break;
+		case FILTER_SECTION:
+			/* an unindented line starts the next section */
+			if (len == 0 || (line[0] != ' ' && line[0] != '\t')) {
+				filter_release(f, i);
+				st->heldmatch = 0;
+			}
+			if (filter_match(st, line))
+				st->heldmatch = 1;
+			filter_hold(f, i, line, len);
+			return;
+		case FILTER_COUNT:
+			if (filter_match(st, line))
+				st->count++;
+			return;
+		}
+	}
+	(*f->out)(line, len, f->arg);
+}
+
+static void
+filter_hold(struct filter *f, size_t i, const char *line, size_t len)
+{
+	struct filter_stage *st = &f->stage[i];
+	size_t size;
+	char *p;
+
+	if (st->heldlen + len + 1 > st->heldsize) {
+		size = st->heldsize ? st->heldsize : 1024;
+		while (size < st->heldlen + len + 1)
+			size *= 2;
+		if ((p = realloc(st->held, size)) == NULL) {
+			/* better shown unfiltered than lost */
+			filter_release(f, i);
+			filter_pass(f, i + 1, line, len);
+			return;
+		}
+		st->held = p;
+		st->heldsize = size;
+	}
+	memcpy(st->held + st->heldlen, line, len);
+	st->held[st->heldlen + len] = '\0';
+	st->heldlen += len + 1;
+}
+
+/*
+ * Hand on the section held by stage i if it matched, and forget it.
+ */
+static void
+filter_release(struct filter *f, size_t i)
+{
+	struct filter_stage *st = &f->stage[i];
+	size_t off, len;
+
+	if (st->heldmatch)
+		for (off = 0; off < st->heldlen; off += len + 1) {
+			len = strlen(st->held + off);
+			filter_pass(f, i + 1, st->held + off, len);
+		}
+	st->heldlen = 0;
+}
+
+/*
+ * Pass line, NUL terminated at len, through the filters to out.
+ */
+void
+filter_line(struct filter *f, const char *line, size_t len,
+    void (*out)(const char *, size_t, void *), void *arg)
+{
+	f->out = out;
+	f->arg = arg;
+	filter_pass(f, 0, line, len);
+}
+
+/*
+ * The output has ended: hand on held sections and counts, in order.
+ */
+void
+filter_end(struct filter *f, void (*out)(const char *, size_t, void *),
+    void *arg)
+{
+	struct filter_stage *st;
+	char buf[32];
+	size_t i;
+	int len;
+
+	f->out = out;
+	f->arg = arg;
+	for (i = 0; i < f->nstage; i++) {
+		st = &f->stage[i];
+		if (st->type == FILTER_SECTION)
+			filter_release(f, i);
+		else if (st->type == FILTER_COUNT) {
+			len = snprintf(buf, sizeof(buf), "%llu",
+			    (unsigned long long)st->count);
+			filter_pass(f, i + 1, buf, len);
+		}
+	}
+}
+
+void
+filter_free(struct filter *f)
+{
+	size_t i;
+
+	if (f == NULL)
+		return;
+	for (i = 0; i < f->nstage; i++) {
+		if (f->stage[i].hasre)
+			regfree(&f->stage[i].re);
+		free(f->stage[i].held);
+	}
+	free(f->stage);
+	free(f);
+}
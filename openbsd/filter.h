@@ -0,0 +1,10 @@
+/* output filters after a | on the command line, see filter.c */
+
+struct filter;
+
+struct filter	*filter_compile(int, char **, const char *);
+void	filter_line(struct filter *, const char *, size_t,
+	    void (*)(const char *, size_t, void *), void *);
+void	filter_end(struct filter *, void (*)(const char *, size_t, void *),
+	    void *);
+void	filter_free(struct filter *);
@@ -17,6 +17,9 @@
 #include <sys/tree.h>
 
 #include <stdio.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
 #include <ctype.h>
 #include <fcntl.h>
 #include <stdlib.h>
@@ -28,6 +31,7 @@
 #include <sys/param.h>
 #include <sys/sockio.h>
 #include <sys/ioctl.h>
+#include <sys/sysctl.h>
 #include <sys/un.h>
 #include <net/if.h>
 #include <net/if_types.h>
@@ -49,14 +53,23 @@
 #include <limits.h>
 #include "ip.h"
 #include "bridge.h"
+#include "ifrate.h"
+#include "json.h"
 #include "stringlist.h"
 #include "externs.h"
 #include "ctl.h"
 
 char *iftype(int int_type);
 const char *get_linkstate(int, int);
-void show_int_status(char *, int, FILE *);
+void show_int_status(struct ifaddrs *, int, FILE *);
+static void show_int_entry(int, struct ifaddrs *, FILE *);
+static void show_int_json(int, struct ifaddrs *);
+static int show_int_rates(int, char **);
+static int ifrate_collect(struct ifrates *, double, char **, size_t *);
+static char *ifrate_fmt(double, char *, size_t);
+static void ifrate_sig(int);
 char *get_hwdaddr(char *ifname);
+static char *sdl_hwdaddr(struct sockaddr_dl *);
 void pack_ifaliasreq(struct ifaliasreq *, ip_t *, struct in_addr *, char *);
 void pack_in6aliasreq(struct in6_aliasreq *, ip_t *, struct in6_addr *, char *);
 void ipv6ll_db_store(struct sockaddr_in6 *, struct sockaddr_in6 *, int, char *);
@@ -70,6 +83,8 @@ int show_vlan(int, int);
 static struct ifmpwreq imrsave;
 static char imrif[IFNAMSIZ];
 
+static struct json ifjson;	/* output json mode */
+
 static const struct {
 	char *name;
 	u_int8_t type;
@@ -127,20 +142,26 @@ get_linkstate(int mt, int link_state)
 	return buf;
 }
 
+/*
+ * One line of "show interface status".  link is the interface's AF_LINK
+ * entry in a getifaddrs(3) snapshot taken by the caller, which provides
+ * flags, if_data and link type.
+ */
 void
-show_int_status(char *ifname, int ifs, FILE *outfile)
+show_int_status(struct ifaddrs *link, int ifs, FILE *outfile)
 {
 	struct ifreq ifr;
 	struct ifmediareq ifmr;
 	int flags;
-	struct if_data if_data;
-	struct sockaddr_dl *sdl = NULL;
+	struct if_data *if_data = link->ifa_data;
+	struct sockaddr_dl *sdl = (struct sockaddr_dl *)link->ifa_addr;
 	const char *link_state_desc = NULL;
-	struct ifaddrs *ifap, *ifa;
+	char *ifname = link->ifa_name;
 	uint64_t *media_list = NULL, seen_options = 0;
 	const char *ifm_type = NULL, *ifm_subtype = NULL;
 	char ifm_options_current[128];
 	char ifm_options_active[128];
+	char media[512];
 
 	ifm_options_current[0] = '\0';
 	ifm_options_active[0] = '\0';
@@ -148,13 +169,7 @@ show_int_status(char *ifname, int ifs, FILE *outfile)
 	memset(&ifr, 0, sizeof(ifr));
 	strlcpy(ifr.ifr_name, ifname, sizeof(ifr.ifr_name));
 
-	flags = get_ifflags(ifname, ifs);
-	ifr.ifr_data = (caddr_t)&if_data;
-	if (ioctl(ifs, SIOCGIFDATA, (caddr_t)&ifr) < 0) {
-		printf("%% show_int_status: SIOCGIFDATA: %s\n",
-		    strerror(errno));
-		return;
-	}
+	flags = link->ifa_flags;
 	if (ioctl(ifs, SIOCGIFRDOMAIN, (caddr_t)&ifr) == -1) {
 		printf("%% show_int_status: SIOCGIFRDOMAIN: %s\n",
 		    strerror(errno));
@@ -164,20 +179,7 @@ show_int_status(char *ifname, int ifs, FILE *outfile)
 	memset(&ifmr, 0, sizeof(ifmr));
 	strlcpy(ifmr.ifm_name, ifname, sizeof(ifmr.ifm_name));
 
-	if (getifaddrs(&ifap) != 0) {
-		printf("%% show_int_status: getifaddrs: %s\n",
-		    strerror(errno));
-		return;
-	}
-	for (ifa = ifap; ifa; ifa = ifa->ifa_next) {
-		if (ifa->ifa_addr->sa_family == AF_LINK &&
-		    (strcmp(ifname, ifa->ifa_name) == 0)) {
-			sdl = (struct sockaddr_dl *)ifa->ifa_addr;
-			link_state_desc = get_linkstate(sdl->sdl_type,
-			    if_data.ifi_link_state);
-			break;
-		}
-	}
+	link_state_desc = get_linkstate(sdl->sdl_type, if_data->ifi_link_state);
 
 	if (ioctl(ifs, SIOCGIFMEDIA, (caddr_t)&ifmr) != -1 &&
 	    ifmr.ifm_count > 0) {
@@ -191,6 +193,7 @@ show_int_status(char *ifname, int ifs, FILE *outfile)
 		if (ioctl(ifs, SIOCGIFMEDIA, (caddr_t)&ifmr) == -1) {
 			printf("%% show_int_status: SIOCGIFMEDIA: %s\n",
 			    strerror(errno));
+			free(media_list);
 			return;
 		}
 		if (link_state_desc == NULL)
@@ -214,9 +217,7 @@ show_int_status(char *ifname, int ifs, FILE *outfile)
 		ifm_subtype = get_ifm_subtype_str(ifmr.ifm_active);
 
 
-	fprintf(outfile, "  %-7s %-7s %-15s %10u  %s%s%s%s%s%s%s\n", ifname,
-	    (flags & IFF_UP) ? "up" : "down", link_state_desc,
-	    ifr.ifr_rdomainid,
+	snprintf(media, sizeof(media), "%s%s%s%s%s%s%s",
 	    ifm_type ? ifm_type : "",
 	    ifm_type ? " " : "",
 	    ifm_subtype ? ifm_subtype : "",
@@ -225,112 +226,78 @@ show_int_status(char *ifname, int ifs, FILE *outfile)
 	    ifm_options_current[0] != '\0' ? " " : "",
 	    ifm_options_active[0] != '\0' ? ifm_options_active : "");
 
+	if (json_output) {
+		json_object(&ifjson, NULL);
+		json_string(&ifjson, "name", ifname);
+		json_bool(&ifjson, "up", flags & IFF_UP);
+		json_string(&ifjson, "link_state", link_state_desc);
+		json_uint(&ifjson, "rdomain", ifr.ifr_rdomainid);
+		json_string(&ifjson, "media", media);
+		json_end(&ifjson);
+	} else
+		fprintf(outfile, "  %-7s %-7s %-15s %10u  %s\n", ifname,
+		    (flags & IFF_UP) ? "up" : "down", link_state_desc,
+		    ifr.ifr_rdomainid, media);
+
 	free(media_list);
 }
 
-int
-show_int(int argc, char **argv, FILE *outfile)
+/*
+ * "show interface status": a line for each AF_LINK entry of the
+ * getifaddrs(3) snapshot ifap, in one walk over it.
+ */
+void
+show_int_status_list(struct ifaddrs *ifap, int ifs, FILE *outfile)
 {
-	struct ifaddrs *ifap, *ifa;
-	struct if_nameindex *ifn_list, *ifnp;
+	struct ifaddrs *ifa;
+
+	if (!json_output)
+		fputs("% Name    Status  Link        Routing-Domain  Media\n",
+		    outfile);
+	for (ifa = ifap; ifa; ifa = ifa->ifa_next)
+		if (ifa->ifa_addr != NULL &&
+		    ifa->ifa_addr->sa_family == AF_LINK &&
+		    ifa->ifa_data != NULL)
+			show_int_status(ifa, ifs, outfile);
+}
+
+/*
+ * Display one interface.  link is the interface's AF_LINK entry in a
+ * getifaddrs(3) snapshot, which lists the interface's addresses right
+ * after it.
+ */
+static void
+show_int_entry(int ifs, struct ifaddrs *link, FILE *outfile)
+{
+	struct ifaddrs *ifa;
 	struct ifreq ifr, ifrdesc;
-	struct if_data if_data;
+	struct if_data *if_data;
 	struct sockaddr_in *sin = NULL, *sinmask = NULL, *sindest;
 	struct sockaddr_in6 *sin6 = NULL, *sin6mask = NULL, *sin6dest;
 	struct timeval tv;
+	struct ifbreq *req;
+	u_int nreq;
 
 	short tmp;
-	int ifs, br, flags, days, hours, mins, pntd;
+	int br, flags, days, hours, mins, pntd;
 	int ippntd = 0;
 	int physrt, physttl;
 	time_t c;
-	char *type, *lladdr;
-	char ifname[IFNAMSIZ];
+	char *type, *lladdr, *ifname = link->ifa_name;
 
 	char tmp_str[512], tmp_str2[512], ifdescr[IFDESCRSIZE];
 
-	memset(ifname, 0, sizeof(ifname));
-
-	if (argc == 4) {
-		/*
-		 * Allow "interface-name interface-number" as some
-		 * network switches do: interface em 0
-		 */
-		const char *errstr;
-		size_t len2 = strlen(argv[2]);
-		strlcpy(ifname, argv[2], sizeof(ifname));
-		strtonum(argv[3], 0, INT_MAX, &errstr);
-		if (errstr) {
-			printf("%% interface unit %s is %s\n", argv[3], errstr);
-			return(1);
-		}
-		if (len2 > 0 && isdigit((unsigned char)(argv[2][len2 - 1]))) {
-			printf("%% interface unit %s is redundant\n", argv[3]);
-			return(1);
-		}
-		strlcat(ifname, argv[3], sizeof(ifname));
-		printf("%% Interface name is %s not \"%s %s\"\n",
-		    ifname, argv[2], argv[3]);
-	} if (argc == 3)
-		strlcpy(ifname, argv[2], sizeof(ifname));
-
-	if ((ifs = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
-		printf("%% show_int: %s\n", strerror(errno));
-		return(1);
-	}
-
-	/*
-	 * Show all interfaces when no ifname specified.
-	 */
-	if (ifname[0] == '\0') {
-		if ((ifn_list = if_nameindex()) == NULL) {
-			printf("%% show_int: if_nameindex failed\n");
-			close(ifs);
-			return 0;
-		}
-		for (ifnp = ifn_list; ifnp->if_name != NULL; ifnp++) {
-			char *args[] = { NULL, NULL, ifnp->if_name };
-
-			show_int(3, args, outfile);
-		}
-		if_freenameindex(ifn_list);
-		close(ifs);
-		return(0);
-	} else if (isprefix(ifname, "status")) {
-		if ((ifn_list = if_nameindex()) == NULL) {
-			printf("%% show_int: if_nameindex failed\n");
-			close(ifs);
-			return 0;
-		}
-		fputs("% Name    Status  Link        Routing-Domain  Media\n",
-		    outfile);
-		for (ifnp = ifn_list; ifnp->if_name != NULL; ifnp++)
-			show_int_status(ifnp->if_name, ifs, outfile);
-		if_freenameindex(ifn_list);
-		close(ifs);
-		return(0);
-	} else if (!is_valid_ifname(ifname)) {
-		printf("%% interface %s not found\n", ifname);
-		close(ifs);
-		return(1);
-	}
-
-	if (!(br = is_bridge(ifs, (char *)ifname)))
+	if (!(br = is_bridge(ifs, ifname)))
 		br = 0;
 
+	memset(&ifr, 0, sizeof(ifr));
 	strlcpy(ifr.ifr_name, ifname, sizeof(ifr.ifr_name));
 
 	/*
 	 * Show up/down status and last change time
 	 */
-	flags = get_ifflags(ifname, ifs);
-
-	ifr.ifr_data = (caddr_t)&if_data;
-	if (ioctl(ifs, SIOCGIFDATA, (caddr_t)&ifr) < 0) {
-		printf("%% show_int: SIOCGIFDATA: %s\n", strerror(errno));
-		close(ifs);
-		return(1);
-	}
+	flags = link->ifa_flags;
+	if_data = link->ifa_data;
 
 	fprintf(outfile, "%% %s", ifname);
 
@@ -347,9 +314,9 @@ show_int(int argc, char **argv, FILE *outfile)
 	fprintf(outfile, "  %s is %s", br ? "Bridge" : "Interface",
 	    flags & IFF_UP ? "up" : "down");
 
-	if (if_data.ifi_lastchange.tv_sec) {
+	if (if_data->ifi_lastchange.tv_sec) {
 		gettimeofday(&tv, (struct timezone *)0);
-		c = difftime(tv.tv_sec, if_data.ifi_lastchange.tv_sec);
+		c = difftime(tv.tv_sec, if_data->ifi_lastchange.tv_sec);
 		days = c / (24 * 60 * 60);
 		c %= (24 * 60 * 60);
 		hours = c / (60 * 60);
@@ -365,46 +332,35 @@ show_int(int argc, char **argv, FILE *outfile)
 	fprintf(outfile, ", protocol is %s\n",
 	    flags & IFF_RUNNING ? "up" : "down");
 
-	type = iftype(if_data.ifi_type);
+	type = iftype(if_data->ifi_type);
 
 	fprintf(outfile, "  Interface type %s", type);
-	if (if_data.ifi_type != IFT_WIREGUARD) {
+	if (if_data->ifi_type != IFT_WIREGUARD) {
 		if (flags & IFF_BROADCAST)
 			fprintf(outfile, " (Broadcast)");
 		else if (flags & IFF_POINTOPOINT)
 			fprintf(outfile, " (PointToPoint)");
 	}
 
-	if ((lladdr = get_hwdaddr(ifname)) != NULL)
+	lladdr = sdl_hwdaddr((struct sockaddr_dl *)link->ifa_addr);
+	if (lladdr != NULL)
 		fprintf(outfile, ", hardware address %s", lladdr);
 	fputc('\n', outfile);
 
 	show_wg(ifs, ifname, outfile);
 	show_umb(ifs, ifname, outfile);
 	show_trunk(ifs, ifname, outfile);
-	if (media_status(ifs, ifname, "  Media type ", outfile))
-		return(1);
+	media_status(ifs, ifname, "  Media type ", outfile);
 
 	/*
 	 * Print interface IP address, and broadcast or
 	 * destination if available.  But, don't print broadcast
 	 * if it is what we would expect given the ip and netmask!
 	 */
-	if (getifaddrs(&ifap) != 0) {
-		printf("%% show_int: getifaddrs failed: %s\n",
-		    strerror(errno));
-		return(1);
-	}
-
-	/*
-	 * Cycle through getifaddrs for interfaces with our
-	 * desired name that sport AF_INET, print the IP and
-	 * related information.
-	 */
-	for (ifa = ifap; ifa; ifa = ifa->ifa_next) {
-		if (ifa->ifa_addr == NULL)
-			continue;
+	for (ifa = link->ifa_next; ifa; ifa = ifa->ifa_next) {
 		if (strncmp(ifname, ifa->ifa_name, IFNAMSIZ))
+			break;
+		if (ifa->ifa_addr == NULL)
 			continue;
 
 		switch (ifa->ifa_addr->sa_family) {
@@ -478,7 +434,6 @@ show_int(int argc, char **argv, FILE *outfile)
 	if (ippntd) {
 		fputc('\n', outfile);
 	}
-	freeifaddrs(ifap);
 
 	if (!br) {
 		if (phys_status(ifs, ifname, tmp_str, tmp_str2,
@@ -502,18 +457,18 @@ show_int(int argc, char **argv, FILE *outfile)
 		/*
 		 * Display MTU, line rate
 		 */
-		fprintf(outfile, " MTU %u bytes", if_data.ifi_mtu);
+		fprintf(outfile, " MTU %u bytes", if_data->ifi_mtu);
 		if (ioctl(ifs, SIOCGIFHARDMTU, (caddr_t)&ifr) != -1) {
 			if (ifr.ifr_hardmtu)
 				fprintf(outfile, " (hardmtu %u)",
 				    ifr.ifr_hardmtu);
 		}
-		if (if_data.ifi_baudrate)
+		if (if_data->ifi_baudrate)
 			fprintf(outfile, ", Line Rate %qu %s",
-			    MBPS(if_data.ifi_baudrate) ?
-			    MBPS(if_data.ifi_baudrate) :
-			    if_data.ifi_baudrate / 1000,
-			    MBPS(if_data.ifi_baudrate) ? "Mbps" : "Kbps");
+			    MBPS(if_data->ifi_baudrate) ?
+			    MBPS(if_data->ifi_baudrate) :
+			    if_data->ifi_baudrate / 1000,
+			    MBPS(if_data->ifi_baudrate) ? "Mbps" : "Kbps");
 
 		fputc('\n', outfile);
 	}
@@ -532,31 +487,31 @@ show_int(int argc, char **argv, FILE *outfile)
 	 * Display remaining info from if_data structure
 	 */
 	fprintf(outfile, "  %qu packets input, %qu bytes, %qu errors, %qu drops\n",
-	    if_data.ifi_ipackets, if_data.ifi_ibytes, if_data.ifi_ierrors,
-	    if_data.ifi_iqdrops);
+	    if_data->ifi_ipackets, if_data->ifi_ibytes, if_data->ifi_ierrors,
+	    if_data->ifi_iqdrops);
 	fprintf(outfile, "  %qu packets output, %qu bytes, %qu errors, "
 	    "%qu unsupported\n",
-	    if_data.ifi_opackets, if_data.ifi_obytes, if_data.ifi_oerrors,
-	    if_data.ifi_noproto);
-	if (if_data.ifi_ibytes && if_data.ifi_ipackets &&
-	    (if_data.ifi_ibytes / if_data.ifi_ipackets) >= ETHERMIN) {
+	    if_data->ifi_opackets, if_data->ifi_obytes, if_data->ifi_oerrors,
+	    if_data->ifi_noproto);
+	if (if_data->ifi_ibytes && if_data->ifi_ipackets &&
+	    (if_data->ifi_ibytes / if_data->ifi_ipackets) >= ETHERMIN) {
 		/* < ETHERMIN means byte counter probably rolled over */
-		fprintf(outfile, "  %qu input", if_data.ifi_ibytes /
-		    if_data.ifi_ipackets);
+		fprintf(outfile, "  %qu input", if_data->ifi_ibytes /
+		    if_data->ifi_ipackets);
 		pntd = 1;
 	} else
 		pntd = 0;
-	if (if_data.ifi_obytes && if_data.ifi_opackets &&
-	    (if_data.ifi_obytes / if_data.ifi_opackets) >= ETHERMIN) {
+	if (if_data->ifi_obytes && if_data->ifi_opackets &&
+	    (if_data->ifi_obytes / if_data->ifi_opackets) >= ETHERMIN) {
 		/* < ETHERMIN means byte counter probably rolled over */
 		fprintf(outfile, "%s%qu output", pntd ? ", " : "  ",
-		    if_data.ifi_obytes / if_data.ifi_opackets);
+		    if_data->ifi_obytes / if_data->ifi_opackets);
 		pntd = 1;
 	}
 	if (pntd)
 		fprintf(outfile, " (average bytes/packet)\n");
 
-	switch(if_data.ifi_type) {
+	switch(if_data->ifi_type) {
 	/*
 	 * These appear to be the only interface types to increase collision
 	 * count in the OpenBSD 3.2 kernel.
@@ -565,7 +520,7 @@ show_int(int argc, char **argv, FILE *outfile)
 	case IFT_SLIP:
 	case IFT_PROPVIRTUAL:
 	case IFT_IEEE80211:
-		fprintf(outfile, "  %qu collisions\n", if_data.ifi_collisions);
+		fprintf(outfile, "  %qu collisions\n", if_data->ifi_collisions);
 		break;
 	default:
 		break;
@@ -579,29 +534,486 @@ show_int(int argc, char **argv, FILE *outfile)
 		}
 		printifhwfeatures(ifs, ifname, outfile);
 		if (br) {
-			if ((tmp = bridge_list(ifs, ifname, "    ", tmp_str,
-			    sizeof(tmp_str), SHOW_STPSTATE))) {
+			req = bridge_members(ifs, ifname, &nreq);
+			if (req != NULL && (tmp = bridge_list(req, nreq,
+			    "    ", SHOW_STPSTATE, NULL))) {
 				fprintf(outfile, "  STP member state%s:\n",
 				    tmp > 1 ?  "s" : "");
-				fprintf(outfile, "%s", tmp_str);
+				bridge_list(req, nreq, "    ", SHOW_STPSTATE,
+				    outfile);
 			}
+			free(req);
 			bridge_addrs(ifs, ifname, "  ", "    ", outfile);
 		}
 		media_supported(ifs, ifname, "  ", "    ", outfile);
 	}
+}
+
+/*
+ * One interface as a JSON record, from the same getifaddrs(3) snapshot
+ * as show_int_entry().
+ */
+static void
+show_int_json(int ifs, struct ifaddrs *link)
+{
+	struct ifaddrs *ifa;
+	struct ifreq ifr;
+	struct if_data *if_data = link->ifa_data;
+	struct sockaddr_dl *sdl = (struct sockaddr_dl *)link->ifa_addr;
+	struct sockaddr_in *sin;
+	struct sockaddr_in6 *sin6;
+	char *lladdr, *ifname = link->ifa_name, ifdescr[IFDESCRSIZE];
+	int flags = link->ifa_flags;
+
+	json_object(&ifjson, NULL);
+	json_string(&ifjson, "name", ifname);
+
+	memset(&ifr, 0, sizeof(ifr));
+	strlcpy(ifr.ifr_name, ifname, sizeof(ifr.ifr_name));
+	memset(ifdescr, 0, sizeof(ifdescr));
+	ifr.ifr_data = (caddr_t)&ifdescr;
+	if (ioctl(ifs, SIOCGIFDESCR, &ifr) == 0 && ifdescr[0] != '\0')
+		json_string(&ifjson, "description", ifdescr);
+
+	json_string(&ifjson, "type", iftype(if_data->ifi_type));
+	json_bool(&ifjson, "up", flags & IFF_UP);
+	json_bool(&ifjson, "running", flags & IFF_RUNNING);
+	json_string(&ifjson, "link_state",
+	    get_linkstate(sdl->sdl_type, if_data->ifi_link_state));
+	if ((lladdr = sdl_hwdaddr(sdl)) != NULL)
+		json_string(&ifjson, "lladdr", lladdr);
+	if (ioctl(ifs, SIOCGIFRDOMAIN, (caddr_t)&ifr) != -1)
+		json_uint(&ifjson, "rdomain", ifr.ifr_rdomainid);
+	json_uint(&ifjson, "mtu", if_data->ifi_mtu);
+	if (ioctl(ifs, SIOCGIFHARDMTU, (caddr_t)&ifr) != -1 &&
+	    ifr.ifr_hardmtu)
+		json_uint(&ifjson, "hardmtu", ifr.ifr_hardmtu);
+	json_uint(&ifjson, "baudrate", if_data->ifi_baudrate);
+	json_int(&ifjson, "last_change", if_data->ifi_lastchange.tv_sec);
+
+	json_array(&ifjson, "addresses");
+	for (ifa = link->ifa_next; ifa; ifa = ifa->ifa_next) {
+		if (strncmp(ifname, ifa->ifa_name, IFNAMSIZ))
+			break;
+		if (ifa->ifa_addr == NULL)
+			continue;
+		switch (ifa->ifa_addr->sa_family) {
+		case AF_INET:
+			sin = (struct sockaddr_in *)ifa->ifa_addr;
+			if (sin->sin_addr.s_addr == INADDR_ANY)
+				continue;
+			json_string(&ifjson, NULL,
+			    netname4(sin->sin_addr.s_addr,
+			    (struct sockaddr_in *)ifa->ifa_netmask));
+			break;
+		case AF_INET6:
+			sin6 = (struct sockaddr_in6 *)ifa->ifa_addr;
+			if (IN6_IS_ADDR_UNSPECIFIED(&sin6->sin6_addr))
+				continue;
+			in6_fillscopeid(sin6);
+			json_string(&ifjson, NULL, netname6(sin6,
+			    (struct sockaddr_in6 *)ifa->ifa_netmask));
+			break;
+		}
+	}
+	json_end(&ifjson);
+
+	json_object(&ifjson, "counters");
+	json_uint(&ifjson, "ipackets", if_data->ifi_ipackets);
+	json_uint(&ifjson, "ibytes", if_data->ifi_ibytes);
+	json_uint(&ifjson, "ierrors", if_data->ifi_ierrors);
+	json_uint(&ifjson, "iqdrops", if_data->ifi_iqdrops);
+	json_uint(&ifjson, "imcasts", if_data->ifi_imcasts);
+	json_uint(&ifjson, "opackets", if_data->ifi_opackets);
+	json_uint(&ifjson, "obytes", if_data->ifi_obytes);
+	json_uint(&ifjson, "oerrors", if_data->ifi_oerrors);
+	json_uint(&ifjson, "oqdrops", if_data->ifi_oqdrops);
+	json_uint(&ifjson, "omcasts", if_data->ifi_omcasts);
+	json_uint(&ifjson, "noproto", if_data->ifi_noproto);
+	json_uint(&ifjson, "collisions", if_data->ifi_collisions);
+	json_end(&ifjson);
+
+	json_end(&ifjson);
+}
 
+int
+show_int(int argc, char **argv, FILE *outfile)
+{
+	struct ifaddrs *ifap, *ifa;
+	int ifs, found = 0;
+	char ifname[IFNAMSIZ];
+
+	memset(ifname, 0, sizeof(ifname));
+
+	if (argc > 2 && isprefix(argv[2], "rates"))
+		return(show_int_rates(argc, argv));
+	if (argc > 4) {
+		printf("%% Too many arguments to 'show interface'\n");
+		return(1);
+	}
+
+	if (argc == 4) {
+		/*
+		 * Allow "interface-name interface-number" as some
+		 * network switches do: interface em 0
+		 */
+		const char *errstr;
+		size_t len2 = strlen(argv[2]);
+		strlcpy(ifname, argv[2], sizeof(ifname));
+		strtonum(argv[3], 0, INT_MAX, &errstr);
+		if (errstr) {
+			printf("%% interface unit %s is %s\n", argv[3], errstr);
+			return(1);
+		}
+		if (len2 > 0 && isdigit((unsigned char)(argv[2][len2 - 1]))) {
+			printf("%% interface unit %s is redundant\n", argv[3]);
+			return(1);
+		}
+		strlcat(ifname, argv[3], sizeof(ifname));
+		printf("%% Interface name is %s not \"%s %s\"\n",
+		    ifname, argv[2], argv[3]);
+	} if (argc == 3)
+		strlcpy(ifname, argv[2], sizeof(ifname));
+
+	if ((ifs = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
+		printf("%% show_int: %s\n", strerror(errno));
+		return(1);
+	}
+
+	/*
+	 * One snapshot serves every interface shown: flags, if_data and
+	 * the hardware address come from the AF_LINK entry, and the
+	 * interface's addresses follow it in the list.
+	 */
+	if (getifaddrs(&ifap) != 0) {
+		printf("%% show_int: getifaddrs failed: %s\n",
+		    strerror(errno));
+		close(ifs);
+		return(1);
+	}
+
+	if (json_output) {
+		json_begin(&ifjson, outfile);
+		json_array(&ifjson, NULL);
+	}
+
+	if (ifname[0] != '\0' && isprefix(ifname, "status")) {
+		show_int_status_list(ifap, ifs, outfile);
+		if (json_output)
+			json_end(&ifjson);
+		freeifaddrs(ifap);
+		close(ifs);
+		return(0);
+	}
+
+	for (ifa = ifap; ifa; ifa = ifa->ifa_next) {
+		if (ifa->ifa_addr == NULL ||
+		    ifa->ifa_addr->sa_family != AF_LINK ||
+		    ifa->ifa_data == NULL)
+			continue;
+		/* Show all interfaces when no ifname specified. */
+		if (ifname[0] != '\0' &&
+		    strncmp(ifname, ifa->ifa_name, IFNAMSIZ) != 0)
+			continue;
+		if (json_output)
+			show_int_json(ifs, ifa);
+		else
+			show_int_entry(ifs, ifa, outfile);
+		found = 1;
+		if (ifname[0] != '\0')
+			break;
+	}
+	if (json_output)
+		json_end(&ifjson);
+	freeifaddrs(ifap);
 	close(ifs);
+
+	if (!found && ifname[0] != '\0') {
+		printf("%% interface %s not found\n", ifname);
+		return(1);
+	}
+	return(0);
+}
+
+static volatile sig_atomic_t ifrate_stop;
+
+static void
+ifrate_sig(int signo)
+{
+	ifrate_stop = 1;
+}
+
+/*
+ * Feed the if_data counters of every interface to the rate sampler.
+ * One NET_RT_IFLIST sysctl returns them all; *bufp and *lenp keep the
+ * buffer between passes so a steady state pass does not allocate.
+ */
+static int
+ifrate_collect(struct ifrates *rates, double elapsed, char **bufp,
+    size_t *lenp)
+{
+	int mib[6] = { CTL_NET, PF_ROUTE, 0, 0, NET_RT_IFLIST, 0 };
+	struct ifrate_counters c;
+	struct if_msghdr *ifm;
+	struct sockaddr_dl *sdl;
+	char *next, *lim, *buf, name[IF_NAMESIZE];
+	size_t needed;
+
+	for (;;) {
+		if (sysctl(mib, 6, NULL, &needed, NULL, 0) == -1) {
+			printf("%% ifrate_collect: sysctl estimate: %s\n",
+			    strerror(errno));
+			return(-1);
+		}
+		if (needed > *lenp) {
+			/* leave room for interfaces arriving meanwhile */
+			needed += needed / 8;
+			if ((buf = realloc(*bufp, needed)) == NULL) {
+				printf("%% ifrate_collect: realloc: %s\n",
+				    strerror(errno));
+				return(-1);
+			}
+			*bufp = buf;
+			*lenp = needed;
+		}
+		needed = *lenp;
+		if (sysctl(mib, 6, *bufp, &needed, NULL, 0) == 0)
+			break;
+		if (errno != ENOMEM) {
+			printf("%% ifrate_collect: sysctl: %s\n",
+			    strerror(errno));
+			return(-1);
+		}
+	}
+
+	ifrate_begin(rates);
+	lim = *bufp + needed;
+	for (next = *bufp; next < lim; next += ifm->ifm_msglen) {
+		ifm = (struct if_msghdr *)next;
+		if (ifm->ifm_version != RTM_VERSION ||
+		    ifm->ifm_type != RTM_IFINFO)
+			continue;
+
+		name[0] = '\0';
+		if (ifm->ifm_addrs & RTA_IFP) {
+			sdl = (struct sockaddr_dl *)(next + ifm->ifm_hdrlen);
+			if (sdl->sdl_family == AF_LINK &&
+			    sdl->sdl_nlen < sizeof(name)) {
+				memcpy(name, sdl->sdl_data, sdl->sdl_nlen);
+				name[sdl->sdl_nlen] = '\0';
+			}
+		}
+		if (name[0] == '\0')
+			snprintf(name, sizeof(name), "#%u", ifm->ifm_index);
+
+		c.ipackets = ifm->ifm_data.ifi_ipackets;
+		c.opackets = ifm->ifm_data.ifi_opackets;
+		c.ibytes = ifm->ifm_data.ifi_ibytes;
+		c.obytes = ifm->ifm_data.ifi_obytes;
+		c.ierrors = ifm->ifm_data.ifi_ierrors;
+		c.oerrors = ifm->ifm_data.ifi_oerrors;
+		c.iqdrops = ifm->ifm_data.ifi_iqdrops;
+		c.oqdrops = ifm->ifm_data.ifi_oqdrops;
+		if (ifrate_sample(rates, ifm->ifm_index, name, &c,
+		    elapsed) == -1)
+			return(-1);
+	}
+	ifrate_end(rates);
+
+	return(0);
+}
+
+/*
+ * Scale a per second rate to k/M/G
+ */
+static char *
+ifrate_fmt(double rate, char *buf, size_t len)
+{
+	const char *unit = " kMGT";
+
+	while (rate >= 1000 && unit[1] != '\0') {
+		rate /= 1000;
+		unit++;
+	}
+	if (*unit == ' ')
+		snprintf(buf, len, "%.0f", rate);
+	else
+		snprintf(buf, len, "%.1f%c", rate, *unit);
+	return(buf);
+}
+
+/*
+ * show interface rates [<seconds>] [<count>] [bps|pps|errors]
+ *
+ * Sample all interfaces every interval and print the busiest ones,
+ * until ENTER or ^C.
+ */
+static int
+show_int_rates(int argc, char **argv)
+{
+	struct ifrates rates;
+	struct ifrate **top = NULL, *r;
+	struct timespec last, now;
+	struct pollfd pfd;
+	struct tm *tm;
+	time_t t;
+	double elapsed;
+	size_t buflen = 0, i, n;
+	char *buf = NULL, stamp[sizeof("00:00:00")];
+	char ib[16], ob[16], ip[16], op[16];
+	const char *errstr, *keyname = "bit rate";
+	int interval = 2, count = 20, key = IFRATE_SORT_BPS, argn = 0;
+	int ret = 1;
+
+	/* skip "show interface rates" */
+	for (i = 3; i < (size_t)argc; i++) {
+		if (isprefix(argv[i], "bps")) {
+			key = IFRATE_SORT_BPS;
+			keyname = "bit rate";
+		} else if (isprefix(argv[i], "pps")) {
+			key = IFRATE_SORT_PPS;
+			keyname = "packet rate";
+		} else if (isprefix(argv[i], "errors")) {
+			key = IFRATE_SORT_ERRORS;
+			keyname = "errors and drops";
+		} else if (argn == 0) {
+			interval = strtonum(argv[i], 1, 3600, &errstr);
+			if (errstr) {
+				printf("%% interval %s is %s\n", argv[i],
+				    errstr);
+				return(1);
+			}
+			argn++;
+		} else if (argn == 1) {
+			count = strtonum(argv[i], 1, INT_MAX, &errstr);
+			if (errstr) {
+				printf("%% count %s is %s\n", argv[i], errstr);
+				return(1);
+			}
+			argn++;
+		} else {
+			printf("%% Invalid argument %s\n", argv[i]);
+			return(1);
+		}
+	}
+
+	ifrate_init(&rates, IFRATE_ALPHA);
+	if (ifrate_collect(&rates, 0, &buf, &buflen) == -1)
+		goto done;
+	clock_gettime(CLOCK_MONOTONIC, &last);
+
+	ifrate_stop = 0;
+	if (signal(SIGINT, ifrate_sig) == SIG_ERR) {
+		printf("%% signal: %s\n", strerror(errno));
+		goto done;
+	}
+
+	printf("%% Sampling every %ds, press ENTER or ^C to leave ...\n",
+	    interval);
+	fflush(stdout);
+
+	pfd.fd = STDIN_FILENO;
+	pfd.events = POLLIN;
+
+	while (!ifrate_stop) {
+		switch (poll(&pfd, 1, interval * 1000)) {
+		case -1:
+			if (errno == EINTR)
+				continue;
+			printf("%% poll: %s\n", strerror(errno));
+			goto restore;
+		case 0:
+			break;
+		default:
+			/* ENTER */
+			ret = 0;
+			goto restore;
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		elapsed = (now.tv_sec - last.tv_sec) +
+		    (now.tv_nsec - last.tv_nsec) / 1e9;
+		last = now;
+		if (ifrate_collect(&rates, elapsed, &buf, &buflen) == -1)
+			goto restore;
+
+		free(top);
+		if ((top = calloc(rates.nifr + 1, sizeof(*top))) == NULL) {
+			printf("%% show_int_rates: calloc: %s\n",
+			    strerror(errno));
+			goto restore;
+		}
+		n = ifrate_top(&rates, top, count, key);
+
+		t = time(NULL);
+		if ((tm = localtime(&t)) == NULL ||
+		    strftime(stamp, sizeof(stamp), "%H:%M:%S", tm) == 0)
+			stamp[0] = '\0';
+		printf("\n%% %s top %zu of %zu interfaces by %s\n", stamp, n,
+		    rates.nifr, keyname);
+		printf("  %-15s %8s %8s %8s %8s %7s %7s %7s %7s\n", "Interface",
+		    "In bps", "Out bps", "In pps", "Out pps", "In err",
+		    "Out err", "In drop", "Outdrop");
+		for (i = 0; i < n; i++) {
+			r = top[i];
+			printf("  %-15s %8s %8s %8s %8s %7.1f %7.1f %7.1f %7.1f\n",
+			    r->name, ifrate_fmt(r->ibps, ib, sizeof(ib)),
+			    ifrate_fmt(r->obps, ob, sizeof(ob)),
+			    ifrate_fmt(r->ipps, ip, sizeof(ip)),
+			    ifrate_fmt(r->opps, op, sizeof(op)),
+			    r->ierrs, r->oerrs, r->idrops, r->odrops);
+		}
+		fflush(stdout);
+	}
+	ret = 0;
+
+ restore:
+	(void)signal(SIGINT, (sig_t)intr);
+ done:
+	free(top);
+	free(buf);
+	ifrate_free(&rates);
+	return(ret);
+}
+
+/*
+ * Absolute counters of every interface from one NET_RT_IFLIST pass, for
+ * watch.  The sysctl buffer and interface table are kept between calls.
+ */
+int
+show_int_counters(FILE *outfile, void *arg)
+{
+	static struct ifrates rates;
+	static char *buf;
+	static size_t buflen;
+	struct ifrate *r;
+	size_t i;
+
+	if (rates.alpha == 0)
+		ifrate_init(&rates, IFRATE_ALPHA);
+	if (ifrate_collect(&rates, 0, &buf, &buflen) == -1)
+		return(1);
+
+	fprintf(outfile, "%-9s %10s %13s %6s %10s %13s %6s %6s\n",
+	    "Interface", "Ipkts", "Ibytes", "Ierrs", "Opkts", "Obytes",
+	    "Oerrs", "Drops");
+	for (i = 0; i < rates.nifr; i++) {
+		r = &rates.ifr[i];
+		fprintf(outfile, "%-9s %10llu %13llu %6llu %10llu %13llu "
+		    "%6llu %6llu\n", r->name,
+		    r->last.ipackets, r->last.ibytes, r->last.ierrors,
+		    r->last.opackets, r->last.obytes, r->last.oerrors,
+		    r->last.iqdrops + r->last.oqdrops);
+	}
 	return(0);
 }
 
 int
-show_autoconf(int argc, char **argv)
+show_autoconf(int argc, char **argv, FILE *outfile)
 {
 	struct if_nameindex *ifn_list, *ifnp;
 	char *ifname = NULL;
-	char outpath[PATH_MAX];
-	int ifs = -1, fd = -1, nullfd = -1, ifxflags;
-	int have_output = 0;
+	int ifs = -1, nullfd = -1, ifxflags;
 
 	if (argc == 3) {
 		ifname = argv[2];
@@ -630,16 +1042,7 @@ show_autoconf(int argc, char **argv)
 		return (1);
 	}
 
-	strlcpy(outpath, "/tmp/nsh-XXXXXX", sizeof(outpath));
-	fd = mkstemp(outpath);
-	if (fd == -1) {
-		printf("%% mkstemp: %s\n", strerror(errno));
-		close(nullfd);
-		close(ifs);
-		if_freenameindex(ifn_list);
-		return (1);
-	}
-
+	fflush(outfile);
 	for (ifnp = ifn_list; ifnp->if_name != NULL; ifnp++) {
 		if (ifname && strcmp(ifname, ifnp->if_name) != 0)
 			continue;
@@ -649,25 +1052,19 @@ show_autoconf(int argc, char **argv)
 		if ((ifxflags & IFXF_AUTOCONF4) && dhcpleased_is_running()) {
 			char *args[] = { DHCPLEASECTL, "-l",
 			    ifnp->if_name, NULL };
-			cmdargs_output(DHCPLEASECTL, args, fd, nullfd);
-			have_output = 1;
+			cmdargs_output(DHCPLEASECTL, args, fileno(outfile),
+			    nullfd);
 		}
 #endif
 		if ((ifxflags & IFXF_AUTOCONF6) && slaacd_is_running()) {
 			char *args[] = { SLAACCTL, "show", "interface",
 			    ifnp->if_name, NULL };
-			cmdargs_output(SLAACCTL, args, fd, nullfd);
-			have_output = 1;
+			cmdargs_output(SLAACCTL, args, fileno(outfile), nullfd);
 		}
 	}
 
-	if (have_output)
-		more(outpath);
-
-	unlink(outpath);
 	if_freenameindex(ifn_list);
 	close(nullfd);
-	close(fd);
 	close(ifs);
 	return (0);
 }
@@ -945,11 +1342,8 @@ in4_brdaddr(u_int32_t addr, u_int32_t mask)
 char *
 get_hwdaddr(char *ifname)
 {
-	int i, found = 0;
 	char *val = NULL;
 	struct ifaddrs *ifap, *ifa;
-	struct ether_addr *ea;
-	struct sockaddr_dl *sdl = NULL;
 
 	if (getifaddrs(&ifap) != 0) {
 		printf("%% get_hwdaddr: getifaddrs: %s\n", strerror(errno));
@@ -959,12 +1353,27 @@ get_hwdaddr(char *ifname)
 	for (ifa = ifap; ifa; ifa = ifa->ifa_next)
 		if (ifa->ifa_addr->sa_family == AF_LINK &&
 		    (strcmp(ifname, ifa->ifa_name) == 0)) {
-			sdl = (struct sockaddr_dl *)ifa->ifa_addr;
-			found++;
+			val = sdl_hwdaddr((struct sockaddr_dl *)ifa->ifa_addr);
 			break;
 		}
 
-	if (found && sdl && sdl->sdl_alen)
+	freeifaddrs(ifap);
+
+	return(val);
+}
+
+/*
+ * Ethernet address of a link level sockaddr, in the static buffer of
+ * ether_ntoa(3), or NULL if it has none or it is all zeroes.
+ */
+static char *
+sdl_hwdaddr(struct sockaddr_dl *sdl)
+{
+	int i, found;
+	char *val = NULL;
+	struct ether_addr *ea;
+
+	if (sdl->sdl_alen)
 		switch(sdl->sdl_type) {
 		case IFT_ETHER:
 		case IFT_IEEE80211:
@@ -981,8 +1390,6 @@ get_hwdaddr(char *ifname)
 			break;
 		}
 
-	freeifaddrs(ifap);
-
 	return(val);
 }
 
@@ -2313,6 +2720,7 @@ intgroup(char *ifname, int ifs, int argc, char **argv)
 			}
 		}
 	}
+	complete_flush();	/* group changes are not announced */
 
 	return 0;
 }
@@ -2945,12 +3353,12 @@ show_vlan(int start_vnetid, int end_vnetid)
 	struct if_nameindex *ifn_list, *ifnp;
 	struct ifreq ifr;
 	struct if_parent ifp;
-	int ifs, vnetid, flags, bridx, rdomain;
+	struct brmembers brm;
+	int ifs, vnetid, flags, rdomain;
 	const char *parent, *description, *bridgename;
 	char ifdescr[IFDESCRSIZE];
 	char vnetid_str[5];
 	int found_vnetid = 0, header_shown = 0;
-	char ifix_buf[IFNAMSIZ];
 
 	if ((ifs = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
 		printf("%% show_vlan: %s\n", strerror(errno));
@@ -2962,6 +3370,15 @@ show_vlan(int start_vnetid, int end_vnetid)
 		close(ifs);
 		return 0;
 	}
+	if (bridge_members_load(ifs, &brm) == -1) {
+		if_freenameindex(ifn_list);
+		close(ifs);
+		return 0;
+	}
+	if (json_output) {
+		json_begin(&ifjson, stdout);
+		json_array(&ifjson, NULL);
+	}
 
 	for (ifnp = ifn_list; ifnp->if_name != NULL; ifnp++) {
 		if (!isprefix("vlan", ifnp->if_name) &&
@@ -2997,7 +3414,7 @@ show_vlan(int start_vnetid, int end_vnetid)
 			continue;
 		found_vnetid = 1;
 
-		if (!header_shown) {
+		if (!header_shown && !json_output) {
 			puts("% Interface  Tag   Status  Type    "
 			    "RDomain  Parent  Bridge   Description");
 			header_shown = 1;
@@ -3039,19 +3456,38 @@ show_vlan(int start_vnetid, int end_vnetid)
 		else
 			snprintf(vnetid_str, sizeof(vnetid_str), "%d", vnetid);
 
-		bridx = bridge_member_search(ifs, ifnp->if_name);
-		if (bridx)
-			bridgename = if_indextoname(bridx, ifix_buf);
-		else
+		if ((bridgename = bridge_members_find(&brm,
+		    ifnp->if_name)) == NULL)
 			bridgename = "-";
 
+		if (json_output) {
+			json_object(&ifjson, NULL);
+			json_string(&ifjson, "interface", ifnp->if_name);
+			if (vnetid != -1)
+				json_int(&ifjson, "tag", vnetid);
+			json_bool(&ifjson, "up", flags & IFF_UP);
+			json_string(&ifjson, "type",
+			    isprefix("vlan", ifnp->if_name) ?
+			    "802.1Q" : "802.1ad");
+			json_int(&ifjson, "rdomain", rdomain);
+			if (strcmp(parent, "-") != 0)
+				json_string(&ifjson, "parent", parent);
+			if (strcmp(bridgename, "-") != 0)
+				json_string(&ifjson, "bridge", bridgename);
+			json_string(&ifjson, "description", description);
+			json_end(&ifjson);
+			continue;
+		}
+
 		printf("  %-10s %-5s %-7s %-8s %6d  %-7s %-8s %s\n",
 		   ifnp->if_name, vnetid_str, (flags & IFF_UP) ? "up" : "down",
 		    isprefix("vlan", ifnp->if_name) ? "802.1Q" : "802.1ad",
 		    rdomain, parent, bridgename, description);
 	}
 
-	if (!found_vnetid) {
+	if (json_output)
+		json_end(&ifjson);
+	else if (!found_vnetid) {
 		if (end_vnetid == -1)
 			printf("%% no VLAN with tag %d configured\n",
 			    start_vnetid);
@@ -3060,6 +3496,7 @@ show_vlan(int start_vnetid, int end_vnetid)
 			    "configured\n", start_vnetid, end_vnetid);
 	}
 
+	bridge_members_free(&brm);
 	if_freenameindex(ifn_list);
 	close(ifs);
 	return 0;
@@ -0,0 +1,202 @@
+/*
+ * ifcache: process-wide interface index to name cache
+ *
+ * Route, ARP, NDP and VLAN listings translate an interface index for
+ * every entry they print.  if_indextoname(3) fetches and walks the
+ * kernel's whole interface list on each call, so instead we take one
+ * if_nameindex(3) snapshot and keep it until the kernel announces an
+ * interface change (RTM_IFINFO, RTM_IFANNOUNCE) on a routing socket.
+ *
+ * Callers run ifcache_sync() once before a listing and then use
+ * ifcache_name() per entry, which never enters the kernel unless it
+ * meets an index that is missing from a snapshot taken before the sync.
+ *
+ * Other caches of interface derived data, such as the completion lists,
+ * compare ifcache_generation() against the value they were built at.
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include <net/if.h>
+#include <net/route.h>
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "externs.h"
+
+struct ifcache_slot {
+	char	name[IF_NAMESIZE];
+};
+
+static struct ifcache_slot *ifcache;	/* indexed by interface index */
+static u_int	ifcache_nslots;
+static int	ifcache_valid;		/* snapshot matches the kernel */
+static int	ifcache_fresh;		/* snapshot taken since last sync */
+static int	ifcache_sock = -1;	/* RTM_IFINFO/RTM_IFANNOUNCE listener */
+static u_int	ifcache_gen;		/* bumped when interfaces come or go */
+
+static int	ifcache_load(void);
+static int	ifcache_listen(void);
+static void	ifcache_drain(void);
+
+static int
+ifcache_load(void)
+{
+	struct if_nameindex *ifn_list, *ifnp;
+	u_int maxindex = 0;
+
+	ifcache_valid = 0;
+
+	if ((ifn_list = if_nameindex()) == NULL) {
+		printf("%% ifcache_load: if_nameindex failed\n");
+		return (-1);
+	}
+
+	for (ifnp = ifn_list; ifnp->if_name != NULL; ifnp++)
+		if (ifnp->if_index > maxindex)
+			maxindex = ifnp->if_index;
+
+	if (maxindex + 1 > ifcache_nslots) {
+		struct ifcache_slot *n;
+
+		n = reallocarray(ifcache, maxindex + 1, sizeof(*ifcache));
+		if (n == NULL) {
+			printf("%% ifcache_load: reallocarray: %s\n",
+			    strerror(errno));
+			if_freenameindex(ifn_list);
+			return (-1);
+		}
+		ifcache = n;
+		ifcache_nslots = maxindex + 1;
+	}
+	memset(ifcache, 0, ifcache_nslots * sizeof(*ifcache));
+
+	for (ifnp = ifn_list; ifnp->if_name != NULL; ifnp++)
+		strlcpy(ifcache[ifnp->if_index].name, ifnp->if_name,
+		    sizeof(ifcache[ifnp->if_index].name));
+
+	if_freenameindex(ifn_list);
+	ifcache_valid = 1;
+	ifcache_fresh = 1;
+	return (0);
+}
+
+/*
+ * Open a non-blocking routing socket which only hears about interface
+ * arrival, departure and state changes, in every routing table.
+ */
+static int
+ifcache_listen(void)
+{
+	u_int msgfilter = ROUTE_FILTER(RTM_IFINFO) |
+	    ROUTE_FILTER(RTM_IFANNOUNCE);
+	u_int rtableid = RTABLE_ANY;
+
+	if (ifcache_sock >= 0)
+		return (ifcache_sock);
+
+	ifcache_sock = socket(AF_ROUTE, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC,
+	    AF_UNSPEC);
+	if (ifcache_sock == -1)
+		return (-1);
+
+	if (setsockopt(ifcache_sock, AF_ROUTE, ROUTE_MSGFILTER, &msgfilter,
+	    sizeof(msgfilter)) == -1 ||
+	    setsockopt(ifcache_sock, AF_ROUTE, ROUTE_TABLEFILTER, &rtableid,
+	    sizeof(rtableid)) == -1) {
+		close(ifcache_sock);
+		ifcache_sock = -1;
+		return (-1);
+	}
+
+	return (ifcache_sock);
+}
+
+/*
+ * Drain pending interface announcements and drop the snapshot if
+ * anything changed.  Without a listener we cannot tell, so every sync
+ * forces a reload, which still costs only one if_nameindex() per listing.
+ */
+static void
+ifcache_drain(void)
+{
+	struct rt_msghdr *rtm;
+	char msg[2048];
+	ssize_t n;
+	int changed = 0, announced = 0;
+
+	if (ifcache_listen() == -1) {
+		ifcache_valid = 0;
+		ifcache_gen++;
+		return;
+	}
+
+	while ((n = recv(ifcache_sock, msg, sizeof(msg), 0)) != -1) {
+		changed = 1;
+		rtm = (struct rt_msghdr *)msg;
+		if ((size_t)n <= offsetof(struct rt_msghdr, rtm_type) ||
+		    rtm->rtm_type == RTM_IFANNOUNCE)
+			announced = 1;
+	}
+	if (errno != EAGAIN && errno != EWOULDBLOCK) {
+		/* ENOBUFS: announcements were lost, assume the worst */
+		changed = announced = 1;
+	}
+
+	if (changed)
+		ifcache_valid = 0;
+	if (announced)
+		ifcache_gen++;
+}
+
+void
+ifcache_sync(void)
+{
+	ifcache_fresh = 0;
+	ifcache_drain();
+}
+
+/*
+ * Return a number which changes whenever an interface may have arrived
+ * or departed since the previous call.
+ */
+u_int
+ifcache_generation(void)
+{
+	ifcache_drain();
+	return (ifcache_gen);
+}
+
+void
+ifcache_flush(void)
+{
+	ifcache_valid = 0;
+}
+
+/*
+ * Return the name of interface index ifindex, or NULL if there is none.
+ * The returned string is only valid until the next ifcache call.
+ */
+const char *
+ifcache_name(u_int ifindex)
+{
+	if (!ifcache_valid && ifcache_load() == -1)
+		return (NULL);
+
+	if (ifindex >= ifcache_nslots || ifcache[ifindex].name[0] == '\0') {
+		/* interface may have appeared since our snapshot */
+		if (ifcache_fresh || ifcache_load() == -1)
+			return (NULL);
+		if (ifindex >= ifcache_nslots ||
+		    ifcache[ifindex].name[0] == '\0')
+			return (NULL);
+	}
+
+	return (ifcache[ifindex].name);
+}
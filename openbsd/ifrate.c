@@ -0,0 +1,230 @@
+/*
+ * ifrate: interface traffic rate sampler
+ *
+ * The caller reads the counters of every interface once per interval
+ * and passes them in between ifrate_begin() and ifrate_end().  Each
+ * interface keeps its previous snapshot and exponentially weighted
+ * moving averages of the per second deltas, so a single burst does not
+ * make the top-N listing jump around.  Nothing here talks to the
+ * kernel, which keeps the arithmetic usable with synthetic snapshots.
+ */
+
+#include <sys/types.h>
+
+#include <net/if.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ifrate.h"
+
+static struct ifrate *ifrate_lookup(struct ifrates *, u_int, const char *);
+static double	ifrate_ewma(double, double, int, double);
+static double	ifrate_key(const struct ifrate *);
+static int	ifrate_cmp(const void *, const void *);
+
+static int	ifrate_sortkey;		/* for ifrate_cmp() */
+
+void
+ifrate_init(struct ifrates *rates, double alpha)
+{
+	memset(rates, 0, sizeof(*rates));
+	rates->alpha = (alpha > 0 && alpha <= 1) ? alpha : IFRATE_ALPHA;
+}
+
+/*
+ * Find the slot of interface index, creating it if needed.  Slots stay
+ * sorted by index; the kernel lists interfaces in that order, so new
+ * interfaces nearly always go at the end.
+ */
+static struct ifrate *
+ifrate_lookup(struct ifrates *rates, u_int index, const char *name)
+{
+	struct ifrate *r;
+	size_t lo = 0, hi = rates->nifr, mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (rates->ifr[mid].index == index) {
+			r = &rates->ifr[mid];
+			if (strcmp(r->name, name) != 0) {
+				/* index reused by another interface */
+				memset(r, 0, sizeof(*r));
+				r->index = index;
+				strlcpy(r->name, name, sizeof(r->name));
+			}
+			return (r);
+		}
+		if (rates->ifr[mid].index < index)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (rates->nifr == rates->size) {
+		size_t size = rates->size ? rates->size * 2 : 64;
+
+		r = reallocarray(rates->ifr, size, sizeof(*r));
+		if (r == NULL) {
+			printf("%% ifrate_lookup: reallocarray: %s\n",
+			    strerror(errno));
+			return (NULL);
+		}
+		rates->ifr = r;
+		rates->size = size;
+	}
+	r = &rates->ifr[lo];
+	memmove(r + 1, r, (rates->nifr - lo) * sizeof(*r));
+	rates->nifr++;
+
+	memset(r, 0, sizeof(*r));
+	r->index = index;
+	strlcpy(r->name, name, sizeof(r->name));
+	return (r);
+}
+
+static double
+ifrate_ewma(double avg, double rate, int first, double alpha)
+{
+	if (first)
+		return (rate);
+	return (alpha * rate + (1 - alpha) * avg);
+}
+
+/*
+ * Start a pass over all interfaces.
+ */
+void
+ifrate_begin(struct ifrates *rates)
+{
+	size_t i;
+
+	for (i = 0; i < rates->nifr; i++)
+		rates->ifr[i].seen = 0;
+}
+
+/*
+ * Account one interface's counters, taken elapsed seconds after the
+ * previous pass.  A counter that went backwards means the interface was
+ * reset or recreated; that sample only becomes the new baseline.
+ */
+int
+ifrate_sample(struct ifrates *rates, u_int index, const char *name,
+    const struct ifrate_counters *c, double elapsed)
+{
+	struct ifrate *r;
+	const struct ifrate_counters *l;
+	double a;
+	int first;
+
+	if ((r = ifrate_lookup(rates, index, name)) == NULL)
+		return (-1);
+	r->seen = 1;
+	l = &r->last;
+
+	if (r->samples > 0 && elapsed > 0 &&
+	    c->ipackets >= l->ipackets && c->opackets >= l->opackets &&
+	    c->ibytes >= l->ibytes && c->obytes >= l->obytes &&
+	    c->ierrors >= l->ierrors && c->oerrors >= l->oerrors &&
+	    c->iqdrops >= l->iqdrops && c->oqdrops >= l->oqdrops) {
+		first = (r->samples == 1);
+		a = rates->alpha;
+
+		r->ibps = ifrate_ewma(r->ibps,
+		    (c->ibytes - l->ibytes) * 8 / elapsed, first, a);
+		r->obps = ifrate_ewma(r->obps,
+		    (c->obytes - l->obytes) * 8 / elapsed, first, a);
+		r->ipps = ifrate_ewma(r->ipps,
+		    (c->ipackets - l->ipackets) / elapsed, first, a);
+		r->opps = ifrate_ewma(r->opps,
+		    (c->opackets - l->opackets) / elapsed, first, a);
+		r->ierrs = ifrate_ewma(r->ierrs,
+		    (c->ierrors - l->ierrors) / elapsed, first, a);
+		r->oerrs = ifrate_ewma(r->oerrs,
+		    (c->oerrors - l->oerrors) / elapsed, first, a);
+		r->idrops = ifrate_ewma(r->idrops,
+		    (c->iqdrops - l->iqdrops) / elapsed, first, a);
+		r->odrops = ifrate_ewma(r->odrops,
+		    (c->oqdrops - l->oqdrops) / elapsed, first, a);
+		r->samples++;
+	} else
+		r->samples = 1;
+
+	r->last = *c;
+	return (0);
+}
+
+/*
+ * Finish a pass, forgetting interfaces which have gone away.
+ */
+void
+ifrate_end(struct ifrates *rates)
+{
+	size_t i, n;
+
+	for (i = n = 0; i < rates->nifr; i++) {
+		if (!rates->ifr[i].seen)
+			continue;
+		if (i != n)
+			rates->ifr[n] = rates->ifr[i];
+		n++;
+	}
+	rates->nifr = n;
+}
+
+static double
+ifrate_key(const struct ifrate *r)
+{
+	switch (ifrate_sortkey) {
+	case IFRATE_SORT_PPS:
+		return (r->ipps + r->opps);
+	case IFRATE_SORT_ERRORS:
+		return (r->ierrs + r->oerrs + r->idrops + r->odrops);
+	default:
+		return (r->ibps + r->obps);
+	}
+}
+
+static int
+ifrate_cmp(const void *a, const void *b)
+{
+	const struct ifrate *ra = *(const struct ifrate **)a;
+	const struct ifrate *rb = *(const struct ifrate **)b;
+	double ka, kb;
+
+	/* interfaces without a rate yet sort last */
+	if ((ra->samples > 1) != (rb->samples > 1))
+		return (ra->samples > 1 ? -1 : 1);
+	ka = ifrate_key(ra);
+	kb = ifrate_key(rb);
+	if (ka != kb)
+		return (ka > kb ? -1 : 1);
+	return (ra->index < rb->index ? -1 : ra->index > rb->index);
+}
+
+/*
+ * Fill top, which must have room for rates->nifr pointers, with the
+ * interfaces in descending order of key and return how many of them,
+ * at most n, the caller should show.
+ */
+size_t
+ifrate_top(struct ifrates *rates, struct ifrate **top, size_t n, int key)
+{
+	size_t i;
+
+	for (i = 0; i < rates->nifr; i++)
+		top[i] = &rates->ifr[i];
+	ifrate_sortkey = key;
+	qsort(top, rates->nifr, sizeof(*top), ifrate_cmp);
+
+	return (n < rates->nifr ? n : rates->nifr);
+}
+
+void
+ifrate_free(struct ifrates *rates)
+{
+	free(rates->ifr);
+	memset(rates, 0, sizeof(*rates));
+}
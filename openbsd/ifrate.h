@@ -0,0 +1,47 @@
+/* interface rate sampler, see ifrate.c */
+
+#define IFRATE_ALPHA		0.5	/* EWMA weight of the newest sample */
+
+/* sort keys for ifrate_top() */
+#define IFRATE_SORT_BPS		0
+#define IFRATE_SORT_PPS		1
+#define IFRATE_SORT_ERRORS	2
+
+struct ifrate_counters {
+	u_int64_t	ipackets;
+	u_int64_t	opackets;
+	u_int64_t	ibytes;
+	u_int64_t	obytes;
+	u_int64_t	ierrors;
+	u_int64_t	oerrors;
+	u_int64_t	iqdrops;
+	u_int64_t	oqdrops;
+};
+
+struct ifrate {
+	u_int		index;
+	char		name[IF_NAMESIZE];
+	int		samples;	/* counter snapshots taken */
+	int		seen;		/* present in the current pass */
+	struct ifrate_counters last;
+	/* smoothed per second rates, valid once samples > 1 */
+	double		ibps, obps;
+	double		ipps, opps;
+	double		ierrs, oerrs;
+	double		idrops, odrops;
+};
+
+struct ifrates {
+	struct ifrate	*ifr;		/* sorted by index */
+	size_t		 nifr;
+	size_t		 size;
+	double		 alpha;
+};
+
+void	ifrate_init(struct ifrates *, double);
+void	ifrate_begin(struct ifrates *);
+int	ifrate_sample(struct ifrates *, u_int, const char *,
+	    const struct ifrate_counters *, double);
+void	ifrate_end(struct ifrates *);
+size_t	ifrate_top(struct ifrates *, struct ifrate **, size_t, int);
+void	ifrate_free(struct ifrates *);
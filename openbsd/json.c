@@ -0,0 +1,156 @@
+/*
+ * json: streaming JSON writer for "output json"
+ *
+ * Values are written to the stream as soon as a collector hands them
+ * over, so a table of any size takes no more memory than one row.  The
+ * only state is which container is open at each depth and whether it
+ * has members yet.  Every member of the outermost container starts on
+ * a line of its own: a table comes out as one record per line, which
+ * the pager and the output filters handle like any other output, and
+ * the whole stays a single JSON document.  Keys are NULL inside arrays.
+ */
+
+#include <sys/types.h>
+
+#include <stdio.h>
+
+#include "json.h"
+
+static void	json_key(struct json *, const char *);
+static void	json_quote(FILE *, const char *);
+static void	json_open(struct json *, const char *, char, char);
+
+void
+json_begin(struct json *j, FILE *out)
+{
+	j->out = out;
+	j->depth = 0;
+}
+
+static void
+json_quote(FILE *out, const char *s)
+{
+	const unsigned char *p;
+
+	putc('"', out);
+	for (p = (const unsigned char *)s; *p != '\0'; p++) {
+		switch (*p) {
+		case '"':
+		case '\\':
+			putc('\\', out);
+			putc(*p, out);
+			break;
+		case '\b':
+			fputs("\\b", out);
+			break;
+		case '\f':
+			fputs("\\f", out);
+			break;
+		case '\n':
+			fputs("\\n", out);
+			break;
+		case '\r':
+			fputs("\\r", out);
+			break;
+		case '\t':
+			fputs("\\t", out);
+			break;
+		default:
+			if (*p < 0x20)
+				fprintf(out, "\\u%04x", *p);
+			else
+				putc(*p, out);
+		}
+	}
+	putc('"', out);
+}
+
+/*
+ * Separate a new member from the previous one and write its key.
+ */
+static void
+json_key(struct json *j, const char *key)
+{
+	if (j->depth == 0)
+		return;
+	if (j->members[j->depth - 1]++ > 0)
+		putc(',', j->out);
+	if (j->depth == 1)
+		putc('\n', j->out);
+	if (key != NULL && j->closer[j->depth - 1] == '}') {
+		json_quote(j->out, key);
+		putc(':', j->out);
+	}
+}
+
+static void
+json_open(struct json *j, const char *key, char opener, char closer)
+{
+	if (j->depth == JSON_MAXDEPTH)
+		return;
+	json_key(j, key);
+	putc(opener, j->out);
+	j->members[j->depth] = 0;
+	j->closer[j->depth] = closer;
+	j->depth++;
+}
+
+void
+json_object(struct json *j, const char *key)
+{
+	json_open(j, key, '{', '}');
+}
+
+void
+json_array(struct json *j, const char *key)
+{
+	json_open(j, key, '[', ']');
+}
+
+/*
+ * Close the innermost container; closing the outermost one ends the
+ * document.
+ */
+void
+json_end(struct json *j)
+{
+	if (j->depth == 0)
+		return;
+	j->depth--;
+	if (j->depth == 0 && j->members[0] > 0)
+		putc('\n', j->out);
+	putc(j->closer[j->depth], j->out);
+	if (j->depth == 0)
+		putc('\n', j->out);
+}
+
+void
+json_string(struct json *j, const char *key, const char *s)
+{
+	json_key(j, key);
+	if (s == NULL)
+		fputs("null", j->out);
+	else
+		json_quote(j->out, s);
+}
+
+void
+json_uint(struct json *j, const char *key, u_int64_t v)
+{
+	json_key(j, key);
+	fprintf(j->out, "%llu", (unsigned long long)v);
+}
+
+void
+json_int(struct json *j, const char *key, int64_t v)
+{
+	json_key(j, key);
+	fprintf(j->out, "%lld", (long long)v);
+}
+
+void
+json_bool(struct json *j, const char *key, int v)
+{
+	json_key(j, key);
+	fputs(v ? "true" : "false", j->out);
+}
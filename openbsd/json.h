@@ -0,0 +1,19 @@
+/* streaming JSON writer for "output json", see json.c */
+
+#define JSON_MAXDEPTH	8
+
+struct json {
+	FILE	*out;
+	int	 depth;
+	int	 members[JSON_MAXDEPTH];	/* written so far at each depth */
+	char	 closer[JSON_MAXDEPTH];		/* '}' or ']' */
+};
+
+void	json_begin(struct json *, FILE *);
+void	json_object(struct json *, const char *);
+void	json_array(struct json *, const char *);
+void	json_end(struct json *);
+void	json_string(struct json *, const char *, const char *);
+void	json_uint(struct json *, const char *, u_int64_t);
+void	json_int(struct json *, const char *, int64_t);
+void	json_bool(struct json *, const char *, int);
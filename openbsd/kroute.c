@@ -36,6 +36,7 @@
 #include <sys/sysctl.h>
 #include <sys/signal.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 
 #include <net/if.h>
 #include <net/route.h>
@@ -47,6 +48,8 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <time.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <ctype.h>
@@ -54,6 +57,7 @@
 #include <string.h>
 #include <paths.h>
 #include "ip.h"
+#include "stringlist.h"
 #define _WANT_SO_
 #include "externs.h"
 
@@ -69,7 +73,6 @@ u_long	rtm_inits;
 
 char	*mylink_ntoa(const struct sockaddr_dl *);
 
-void	 flushroutes(int, int);
 void	 print_rtmsg(struct rt_msghdr *);
 void	 print_getmsg(struct rt_msghdr *, int);
 void	 pmsg_common(struct rt_msghdr *);
@@ -104,6 +107,7 @@ struct rtdump *getrtdump(int af, int flags, int tableid)
 			if (errno != ENOENT)
 				printf("%% getrtdump: unable to get estimate: %s\n",
 				    strerror(errno));
+			freertdump(rtdump);
 			return(NULL);
 		}
 		if (needed == 0)
@@ -140,83 +144,286 @@ freertdump(struct rtdump *rtdump)
 }
 
 /*
- * Purge entries in the routing table where the first two
- * sockaddrs match requested address families
+ * Add the destinations in a routing table dump of af and flags which
+ * start with prefix to sl, in the form the route and arp commands take
+ * them, for completion.  Neighbour entries are only included if flags
+ * asks for RTF_LLINFO; local and broadcast entries never are.  At most
+ * max names are added.  Returns how many entries matched, which may be
+ * more than max.
  */
-void
-flushroutes(int af, int af2)
+int
+rtdump_names(int af, int flags, int tableid, const char *prefix,
+    size_t max, StringList *sl)
 {
-	int rlen, seqno, s;
-	char *next;
+	struct rtdump *rtdump;
 	struct rt_msghdr *rtm;
+	struct sockaddr *sa, *dst, *mask;
+	char *next, *cp, *name, buf[ADDRNAMELEN];
+	size_t prefixlen = strlen(prefix), matched = 0;
+	int i;
+
+	if ((rtdump = getrtdump(af, flags, tableid)) == NULL)
+		return (0);
+
+	for (next = rtdump->buf; next < rtdump->lim; next += rtm->rtm_msglen) {
+		rtm = (struct rt_msghdr *)next;
+		if (rtm->rtm_version != RTM_VERSION || rtm->rtm_errno)
+			continue;
+		if (rtm->rtm_flags & (RTF_LOCAL | RTF_BROADCAST))
+			continue;
+		if ((rtm->rtm_flags & RTF_LLINFO) != (flags & RTF_LLINFO))
+			continue;
+
+		dst = mask = NULL;
+		cp = next + rtm->rtm_hdrlen;
+		for (i = 1; i; i <<= 1)
+			if (i & rtm->rtm_addrs) {
+				sa = (struct sockaddr *)cp;
+				if (i == RTA_DST)
+					dst = sa;
+				else if (i == RTA_NETMASK)
+					mask = sa;
+				ADVANCE(cp, sa);
+			}
+		if (dst == NULL || (dst->sa_family != AF_INET &&
+		    dst->sa_family != AF_INET6))
+			continue;
+
+		if ((rtm->rtm_flags & RTF_HOST) || mask == NULL)
+			routename_r(dst, buf, sizeof(buf));
+		else
+			netname_r(dst, mask, buf, sizeof(buf));
+		if (strncmp(buf, prefix, prefixlen) != 0)
+			continue;
+		if (++matched > max)
+			continue;
+		if ((name = strdup(buf)) == NULL) {
+			printf("%% rtdump_names: strdup: %s\n",
+			    strerror(errno));
+			break;
+		}
+		sl_add(sl, name);
+	}
+
+	freertdump(rtdump);
+	return (matched);
+}
+
+#define FLUSH_BATCH	256	/* RTM_DELETE messages per sendmmsg(2) */
+
+/*
+ * Is the route rtm, whose destination is dst, inside prefix pfx?
+ */
+static int
+flush_match(struct rt_msghdr *rtm, struct sockaddr *dst, ip_t *pfx)
+{
+	struct sockaddr *sa, *mask = NULL;
+	u_char *a, *b;
+	int i, plen, maxlen, bits = pfx->bitlen;
+
+	if (dst->sa_family != pfx->family)
+		return (0);
+	switch (pfx->family) {
+	case AF_INET:
+		a = (u_char *)&((struct sockaddr_in *)dst)->sin_addr;
+		b = (u_char *)&pfx->addr.in;
+		maxlen = 32;
+		break;
+	case AF_INET6:
+		a = (u_char *)&((struct sockaddr_in6 *)dst)->sin6_addr;
+		b = (u_char *)&pfx->addr.in6;
+		maxlen = 128;
+		break;
+	default:
+		return (0);
+	}
+
+	if (rtm->rtm_flags & RTF_HOST)
+		plen = maxlen;
+	else {
+		sa = dst;
+		for (i = RTA_DST; i < RTA_NETMASK; i <<= 1)
+			if (rtm->rtm_addrs & i)
+				sa = (struct sockaddr *)((char *)sa +
+				    ROUNDUP(sa->sa_len));
+		if (rtm->rtm_addrs & RTA_NETMASK)
+			mask = sa;
+		plen = mask_prefixlen(pfx->family, mask, NULL);
+	}
+	if (plen < bits)
+		return (0);
+
+	if (memcmp(a, b, bits / 8) != 0)
+		return (0);
+	if ((bits & 7) &&
+	    ((a[bits / 8] ^ b[bits / 8]) & (0xff << (8 - (bits & 7)))))
+		return (0);
+	return (1);
+}
+
+static void
+flush_report(struct rt_msghdr *rtm, int error)
+{
+	struct sockaddr *sa, *sa2;
+	char dst[ADDRNAMELEN], gate[ADDRNAMELEN];
+
+	sa = (struct sockaddr *)((char *)rtm + rtm->rtm_hdrlen);
+	sa2 = (struct sockaddr *)(ROUNDUP(sa->sa_len) + (char *)sa);
+	printf("%% %-20.20s %-20.20s %s\n", routename_r(sa, dst, sizeof(dst)),
+	    routename_r(sa2, gate, sizeof(gate)),
+	    error ? strerror(error) : "flushed");
+}
+
+/*
+ * Purge entries in the routing table where the first two
+ * sockaddrs match requested address families, optionally only those
+ * inside prefix.
+ *
+ * Matching entries are collected from one dump and deleted in batches
+ * with sendmmsg(2).  A batch stops at the first message the kernel
+ * rejects; that message is accounted for and the batch resumes after
+ * it.  Per-entry output is only printed in verbose mode, otherwise a
+ * progress line and a summary.
+ */
+int
+flushroutes(int af, int af2, char *prefix, int tableid)
+{
+	struct mmsghdr msgs[FLUSH_BATCH];
+	struct iovec iov[FLUSH_BATCH];
+	struct rt_msghdr *rtm, **rtms = NULL;
 	struct sockaddr *sa, *sa2;
 	struct rtdump *rtdump;
+	ip_t pfx;
+	char *next, *what;
+	size_t nrtms = 0, maxrtms = 0, i, j, n;
+	u_int flushed = 0, gone = 0, failed = 0;
+	int s, sent, seqno = 0, lasterr = 0, progress;
+
+	if (prefix) {
+		memset(&pfx, 0, sizeof(pfx));
+		parse_ip_pfx(prefix, ASSUME_NETMASK, &pfx);
+		if (pfx.family == 0)
+			return (1);
+		if (af2 == AF_LINK) {
+			if (pfx.family != af) {
+				printf("%% %s is not an IPv4 prefix\n", prefix);
+				return (1);
+			}
+		} else
+			af = af2 = pfx.family;
+	}
+	if (af2 == AF_LINK)
+		what = "ARP entries";
+	else
+		what = (af == AF_INET6) ? "IPv6 routes" : "IPv4 routes";
 
 	s = socket(PF_ROUTE, SOCK_RAW, 0);
 	if (s < 0) {
 		printf("%% Unable to open routing socket: %s\n",
 		    strerror(errno));
-		return;
+		return (1);
 	}
 
-	shutdown(s, 0); /* Don't want to read back our messages */
-	rtdump = getrtdump(af, 0, 0);
+	shutdown(s, SHUT_RD); /* Don't want to read back our messages */
+	rtdump = getrtdump(af, 0, tableid);
 	if (rtdump == NULL) {
 		close(s);
-		return;
+		return (0);
 	}
 
-	seqno = 0;
 	for (next = rtdump->buf; next < rtdump->lim; next += rtm->rtm_msglen) {
 		rtm = (struct rt_msghdr *)next;
+		if (rtm->rtm_version != RTM_VERSION)
+			continue;
 		if ((rtm->rtm_flags & (RTF_GATEWAY|RTF_STATIC|RTF_LLINFO)) == 0)
 			continue;
-		if (verbose) {
-			printf("\n%% Read message:\n");
-			print_rtmsg(rtm);
-		}
 		sa = (struct sockaddr *)((char *)rtm + rtm->rtm_hdrlen);
 		sa2 = (struct sockaddr *)(ROUNDUP(sa->sa_len) + (char *)sa);
-		if (sa->sa_family != af) {
-			if (verbose) {
-				printf("%% Ignoring message ");
-				printf("(af %d requested, message ", af);
-				printf("af %d)\n", sa->sa_family);
-			}
+		if (sa->sa_family != af || sa2->sa_family != af2)
 			continue;
-		}
-		if (sa2->sa_family != af2) {
-			if (verbose) {
-				printf("%% Ignoring message ");
-				printf("(af2 %d requested, message ", af);
-				printf("af %d)\n", sa2->sa_family);
-			}
+		if (prefix && !flush_match(rtm, sa, &pfx))
 			continue;
+		if (nrtms == maxrtms) {
+			struct rt_msghdr **nr;
+
+			maxrtms = maxrtms ? maxrtms * 2 : FLUSH_BATCH;
+			nr = reallocarray(rtms, maxrtms, sizeof(*rtms));
+			if (nr == NULL) {
+				printf("%% flushroutes: reallocarray: %s\n",
+				    strerror(errno));
+				goto done;
+			}
+			rtms = nr;
 		}
-		rtm->rtm_type = RTM_DELETE;
-		rtm->rtm_seq = seqno;
-		rlen = write(s, next, rtm->rtm_msglen);
-		if (rlen < (int)rtm->rtm_msglen) {
-			printf("%% Unable to write to routing socket: %s\n",
-			    strerror(errno));
-			break;
+		rtms[nrtms++] = rtm;
+	}
+
+	if (nrtms == 0) {
+		printf("%% No entries found to flush\n");
+		goto done;
+	}
+
+	progress = !verbose && isatty(STDOUT_FILENO);
+
+	for (i = 0; i < nrtms; i += n) {
+		n = nrtms - i < FLUSH_BATCH ? nrtms - i : FLUSH_BATCH;
+		memset(msgs, 0, n * sizeof(msgs[0]));
+		for (j = 0; j < n; j++) {
+			rtm = rtms[i + j];
+			rtm->rtm_type = RTM_DELETE;
+			rtm->rtm_seq = ++seqno;
+			iov[j].iov_base = rtm;
+			iov[j].iov_len = rtm->rtm_msglen;
+			msgs[j].msg_hdr.msg_iov = &iov[j];
+			msgs[j].msg_hdr.msg_iovlen = 1;
 		}
-		seqno++;
-		if (verbose) {
-			printf("\n%% Wrote message:\n");
-			print_rtmsg(rtm);
-		} else {
-			printf("%% %-20.20s ", routename(sa));
-			printf("%-20.20s flushed\n", routename(sa2));
+
+		for (j = 0; j < n; ) {
+			sent = sendmmsg(s, msgs + j, n - j, 0);
+			if (sent > 0) {
+				flushed += sent;
+				if (verbose)
+					while (sent-- > 0)
+						flush_report(rtms[i + j++], 0);
+				else
+					j += sent;
+				continue;
+			}
+			if (errno == EINTR)
+				continue;
+			/* sendmmsg stopped at msgs[j], record why and skip it */
+			if (errno == ESRCH)
+				gone++;
+			else {
+				failed++;
+				lasterr = errno;
+			}
+			if (verbose)
+				flush_report(rtms[i + j], errno);
+			j++;
+		}
+
+		if (progress) {
+			printf("\r%% Flushing %s: %zu/%zu", what, i + n, nrtms);
+			fflush(stdout);
 		}
 	}
-	if (verbose)
+	if (progress)
 		printf("\n");
-	if (!seqno)
-		printf("%% No entires found to flush\n");
+
+	printf("%% Flushed %u of %zu %s", flushed, nrtms, what);
+	if (gone)
+		printf(", %u already gone", gone);
+	printf("\n");
+	if (failed)
+		printf("%% %u could not be flushed: %s\n", failed,
+		    strerror(lasterr));
+
+done:
+	free(rtms);
 	freertdump(rtdump);
 	close(s);
-	return;
+	return (failed ? 1 : 0);
 }
 
 static char hexlist[] = "0123456789abcdef";
@@ -277,20 +484,181 @@ _monitor_sig(int signo)
 	return;
 }
 
+/*
+ * Routing socket message types which may be selected with
+ * "show monitor <type> ...", in ROUTE_MSGFILTER bit order.
+ */
+static struct rtmtype {
+	char	*name;
+	int	 type;
+} rtmtypes[] = {
+	{ "add",	RTM_ADD },
+	{ "delete",	RTM_DELETE },
+	{ "change",	RTM_CHANGE },
+	{ "get",	RTM_GET },
+	{ "losing",	RTM_LOSING },
+	{ "redirect",	RTM_REDIRECT },
+	{ "miss",	RTM_MISS },
+	{ "resolve",	RTM_RESOLVE },
+	{ "newaddr",	RTM_NEWADDR },
+	{ "deladdr",	RTM_DELADDR },
+	{ "ifinfo",	RTM_IFINFO },
+	{ "ifannounce",	RTM_IFANNOUNCE },
+	{ "desync",	RTM_DESYNC },
+	{ "invalidate",	RTM_INVALIDATE },
+	{ "bfd",	RTM_BFD },
+	{ "proposal",	RTM_PROPOSAL },
+	{ "chgaddrattr", RTM_CHGADDRATTR },
+	{ "80211info",	RTM_80211INFO },
+	{ "source",	RTM_SOURCE },
+	{ NULL,		0 }
+};
+
+#define MONITOR_NTYPES	256		/* rtm_type is a u_char */
+#define MONITOR_BUFSIZE	(64 * 1024)	/* largest message we accept */
+#define MONITOR_SOCKBUF	(4 * 1024 * 1024) /* kernel queue we ask for */
+#define MONITOR_BATCH	4096		/* most messages per wakeup */
+#define MONITOR_SLICE	100		/* most ms spent per wakeup */
+
+static void
+monitor_usage(void)
+{
+	struct rtmtype *t;
+
+	printf("%% show monitor [summary] [rtable <table id>|all] "
+	    "[<type> ...]\n");
+	printf("%% types:");
+	for (t = rtmtypes; t->name != NULL; t++)
+		printf(" %s", t->name);
+	printf("\n");
+}
+
+static const char *
+monitor_typename(int type)
+{
+	struct rtmtype *t;
+
+	for (t = rtmtypes; t->name != NULL; t++)
+		if (t->type == type)
+			return (t->name);
+	return (NULL);
+}
+
+/*
+ * Print per-type counters, either as totals or as rates over secs.
+ */
+static void
+monitor_counts(u_int64_t *count, u_int64_t *last, double secs)
+{
+	const char *name;
+	u_int64_t n, total = 0;
+	int i;
+
+	for (i = 0; i < MONITOR_NTYPES; i++)
+		total += count[i] - (last ? last[i] : 0);
+
+	if (last)
+		printf("total %.0f/s", total / secs);
+	else
+		printf("%% %llu messages:", total);
+
+	for (i = 0; i < MONITOR_NTYPES; i++) {
+		if ((n = count[i] - (last ? last[i] : 0)) == 0)
+			continue;
+		if ((name = monitor_typename(i)) != NULL)
+			printf(" %s", name);
+		else
+			printf(" type%d", i);
+		if (last)
+			printf(" %.0f/s", n / secs);
+		else
+			printf(" %llu", n);
+	}
+	printf("\n");
+}
+
+/*
+ * show monitor [summary] [rtable <table id>|all] [<type> ...]
+ *
+ * The kernel does the type and rtable filtering.  Each wakeup drains
+ * what is queued on the socket, so a burst of updates costs one poll(2)
+ * rather than one per message.  A wakeup handles at most MONITOR_BATCH
+ * messages or MONITOR_SLICE ms of them, so that during a storm ENTER,
+ * ^C and the summary still get their turn.
+ */
 int
 monitor(int argc, char **argv)
 {
-	int s, m, n, saveverbose;
-	fd_set fds; 
-	struct timeval to;
-	char msg[2048];
+	struct pollfd pfd[2];
+	struct rt_msghdr *rtm;
+	struct rtmtype *t;
+	struct timespec start, now, lastsum, wakeup;
+	u_int64_t count[MONITOR_NTYPES], lastcount[MONITOR_NTYPES];
+	u_int64_t truncated = 0, lost = 0;
+	u_int msgfilter = 0, rtableid = RTABLE_ANY, nmsg;
+	time_t sec, lastsec = 0;
+	ssize_t n;
+	double secs;
+	int s, i, saveverbose, summary = 0, sockbuf;
+	char *msg, stamp[32];
+	const char *errstr;
+
+	/* skip "show monitor" */
+	for (i = 2; i < argc; i++) {
+		if (isprefix(argv[i], "summary")) {
+			summary = 1;
+		} else if (isprefix(argv[i], "rtable")) {
+			if (++i >= argc) {
+				monitor_usage();
+				return 1;
+			}
+			if (isprefix(argv[i], "all")) {
+				rtableid = RTABLE_ANY;
+				continue;
+			}
+			rtableid = strtonum(argv[i], 0, RT_TABLEID_MAX, &errstr);
+			if (errstr) {
+				printf("%% invalid table id: %s\n", errstr);
+				return 1;
+			}
+		} else {
+			for (t = rtmtypes; t->name != NULL; t++)
+				if (isprefix(argv[i], t->name))
+					break;
+			if (t->name == NULL) {
+				printf("%% Invalid argument %s\n", argv[i]);
+				monitor_usage();
+				return 1;
+			}
+			msgfilter |= ROUTE_FILTER(t->type);
+		}
+	}
 
-	s = socket(PF_ROUTE, SOCK_RAW, 0);
+	s = socket(PF_ROUTE, SOCK_RAW | SOCK_NONBLOCK, 0);
 	if (s < 0) {
 		printf("%% Unable to open routing socket: %s\n",
 		    strerror(errno));
 		return 1;
 	}
+	if (msgfilter && setsockopt(s, AF_ROUTE, ROUTE_MSGFILTER, &msgfilter,
+	    sizeof(msgfilter)) == -1)
+		printf("%% monitor: ROUTE_MSGFILTER: %s\n", strerror(errno));
+	if (rtableid != RTABLE_ANY && setsockopt(s, AF_ROUTE,
+	    ROUTE_TABLEFILTER, &rtableid, sizeof(rtableid)) == -1)
+		printf("%% monitor: ROUTE_TABLEFILTER: %s\n", strerror(errno));
+
+	/* ask for a deep queue so a storm does not overflow between wakeups */
+	for (sockbuf = MONITOR_SOCKBUF; sockbuf >= 64 * 1024; sockbuf /= 2)
+		if (setsockopt(s, SOL_SOCKET, SO_RCVBUF, &sockbuf,
+		    sizeof(sockbuf)) == 0)
+			break;
+
+	if ((msg = malloc(MONITOR_BUFSIZE)) == NULL) {
+		printf("%% monitor: malloc: %s\n", strerror(errno));
+		close(s);
+		return 1;
+	}
+
 	saveverbose = verbose;
 	verbose = 1;
 
@@ -298,44 +666,110 @@ monitor(int argc, char **argv)
 	if (signal (SIGINT, _monitor_sig) == SIG_ERR) {
 		perror (strerror(errno));
 		verbose = saveverbose;
+		free(msg);
 		close (s);
 		return (0);
 	}
 
+	memset(count, 0, sizeof(count));
+	memset(lastcount, 0, sizeof(lastcount));
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	lastsum = start;
+
 	printf("%% Entering monitor mode ... press ENTER or ^C to leave ...\n");
+	fflush(stdout);
 
-	for(; sigflag != SIGINT ;) {
-		time_t now;
+	pfd[0].fd = s;
+	pfd[0].events = POLLIN;
+	pfd[1].fd = STDIN_FILENO;
+	pfd[1].events = POLLIN;
 
-		FD_ZERO (&fds);
-		FD_SET (s, &fds);
-		FD_SET (0, &fds);
-		to.tv_sec = 1;
-		to.tv_usec = 0;
+	for(; sigflag != SIGINT ;) {
+		if (poll(pfd, 2, 1000) == -1) {
+			if (errno == EINTR)
+				continue;
+			printf ("%% poll: %s\n", strerror(errno));
+			break;
+		}
+		if (pfd[1].revents & (POLLIN|POLLHUP))
+			break;
 
-		m = select (s + 1, &fds, NULL, NULL, &to);
+		/* drain the socket, a slice at a time */
+		clock_gettime(CLOCK_MONOTONIC, &wakeup);
+		for (nmsg = 0; (pfd[0].revents & POLLIN) &&
+		    sigflag != SIGINT && nmsg < MONITOR_BATCH; nmsg++) {
+			if (nmsg % 64 == 63) {
+				clock_gettime(CLOCK_MONOTONIC, &now);
+				if ((now.tv_sec - wakeup.tv_sec) * 1000 +
+				    (now.tv_nsec - wakeup.tv_nsec) / 1000000 >=
+				    MONITOR_SLICE)
+					break;
+			}
+			n = recv(s, msg, MONITOR_BUFSIZE, 0);
+			if (n == -1) {
+				if (errno == ENOBUFS) {
+					/* kernel queue overflowed */
+					lost++;
+					if (!summary)
+						printf("%% routing socket "
+						    "overflow, messages lost\n");
+					continue;
+				}
+				if (errno != EAGAIN && errno != EINTR)
+					printf("%% recv: %s\n", strerror(errno));
+				break;
+			}
+			rtm = (struct rt_msghdr *)msg;
+			if (n < 4)	/* msglen, version and type */
+				continue;
+			count[rtm->rtm_type]++;
+			if (n < rtm->rtm_msglen) {
+				truncated++;
+				if (!summary)
+					printf("%% Message truncated: %zd of "
+					    "%d bytes\n", n, rtm->rtm_msglen);
+				continue;
+			}
+			if (summary)
+				continue;
 
-		if (m < 0) {
-			printf ("%% select: %s\n", strerror(errno));
-			break;
+			/* format the timestamp at most once a second */
+			if ((sec = time(NULL)) != lastsec) {
+				lastsec = sec;
+				strftime(stamp, sizeof(stamp), "%a %b %e %T %Y",
+				    localtime(&sec));
+			}
+			printf("%% Message of size %zd on %s\n", n, stamp);
+			print_rtmsg(rtm);
 		}
 
-		if (m > 0) {
-			if (FD_ISSET (s, &fds)) {
-				ioctl (s, FIONBIO, 1); 	/* non-blocking io */
-				n = read (s, msg, 2048);
-				now = time(NULL);
-				printf("%% Message of size %d on %s", n, ctime(&now));
-				print_rtmsg((struct rt_msghdr *)msg);
+		if (summary) {
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			secs = (now.tv_sec - lastsum.tv_sec) +
+			    (now.tv_nsec - lastsum.tv_nsec) / 1e9;
+			if (secs >= 1.0) {
+				sec = time(NULL);
+				strftime(stamp, sizeof(stamp), "%T",
+				    localtime(&sec));
+				printf("%% %s ", stamp);
+				monitor_counts(count, lastcount, secs);
+				memcpy(lastcount, count, sizeof(lastcount));
+				lastsum = now;
 			}
-			if (FD_ISSET (0, &fds)) 
-				break; 
 		}
+		fflush(stdout);
 	}
 
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	secs = (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
+	monitor_counts(count, NULL, secs);
+	if (truncated || lost)
+		printf("%% %llu truncated, %llu overflows\n", truncated, lost);
+
 	sigflag = -1;
 	verbose = saveverbose;
 	(void)signal(SIGINT, (sig_t)intr);
+	free(msg);
 	close(s);
 	return(0);
 }
@@ -385,8 +819,11 @@ print_rtmsg(rtm)
 		    rtm->rtm_version);
 		return;
 	}
-	(void)printf("%% %s: len %d, table %d, ", msgtypes[rtm->rtm_type], rtm->rtm_msglen,
-	    rtm->rtm_tableid);
+	if (rtm->rtm_type < nitems(msgtypes) - 1)
+		(void)printf("%% %s: ", msgtypes[rtm->rtm_type]);
+	else
+		(void)printf("%% message type %d: ", rtm->rtm_type);
+	(void)printf("len %d, table %d, ", rtm->rtm_msglen, rtm->rtm_tableid);
 	switch (rtm->rtm_type) {
 	case RTM_IFINFO:
 		ifm = (struct if_msghdr *)rtm;
@@ -40,6 +40,7 @@ jmp_buf toplevel;
 char *vers = NSH_VERSION_STR;
 int bridge = 0;		/* bridge mode for interface() */
 int verbose = 0;	/* verbose mode */
+int json_output = 0;	/* show commands print JSON */
 int priv = 0, privexec = 0, cli_rtable = 0;
 int editing = 0, interactive_mode = 0, config_mode = 0;;
 pid_t pid;
@@ -178,18 +179,21 @@ int
 main(int argc, char *argv[])
 {
 	int top, ch, iflag = 0, cflag = 0;
-	char rc[PATH_MAX];
+	char rc[PATH_MAX], *export = NULL;
 
 	setlocale(LC_CTYPE, "");
 
 	pid = getpid();
 
-	while ((ch = getopt(argc, argv, "c:ei:v")) != -1)
+	while ((ch = getopt(argc, argv, "c:E:ei:jv")) != -1)
 		switch (ch) {
 		case 'c':
 			cflag = 1;
 			strlcpy(rc, optarg, PATH_MAX);
 			break;
+		case 'E':
+			export = optarg;
+			break;
 		case 'e':
 			if (getuid() != 0) {
 				fprintf(stderr, "%s: Use of -e option requires "
@@ -202,6 +206,9 @@ main(int argc, char *argv[])
 			iflag = 1;
 			strlcpy(rc, optarg, PATH_MAX);
 			break;
+		case 'j':
+			json_output = 1;
+			break;
 		case 'v':
 			verbose = 1;
 			break;
@@ -216,6 +223,11 @@ main(int argc, char *argv[])
 		usage();
 	if (argc > 0)
 		usage();
+	if (export != NULL) {
+		if (cflag || iflag || privexec)
+			usage();
+		exit(exporter(export));
+	}
 	if (iflag)
 		rmtemp(SQ3DBFILE);
 
@@ -316,8 +328,10 @@ main(int argc, char *argv[])
 		(void)signal(SIGWINCH, setwinsize);
 		(void)signal(SIGINT, (sig_t)intr);
 		(void)setwinsize(0);
-	} else
+	} else {
+		more_abort();
 		putchar('\n');
+	}
 
 	for (;;) {
 		command();
@@ -331,11 +345,16 @@ main(int argc, char *argv[])
 void
 usage(void)
 {
-	fprintf(stderr, "usage: %s [-v] [-i rcfile | -c rcfile]\n", __progname);
+	fprintf(stderr, "usage: %s [-jv] [-i rcfile | -c rcfile]\n",
+	    __progname);
+	fprintf(stderr, "       %s -E socket | port\n", __progname);
+	fprintf(stderr, "           -j shows command output as JSON\n");
 	fprintf(stderr, "           -v indicates verbose operation\n");
 	fprintf(stderr, "           -i rcfile loads initial system" \
 		    " configuration from rcfile\n");
 	fprintf(stderr, "           -c rcfile loads commands from rcfile\n");
+	fprintf(stderr, "           -E serves counters to Prometheus on a"
+	    " local socket or loopback port\n");
 	exit(1);
 }
 
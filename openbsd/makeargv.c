@@ -41,6 +41,7 @@ char saveline[1024];
 int  margc;
 
 char	*margv[NARGS];			/* argv storage */
+char	margbar[] = "|";		/* unquoted | arguments point here */
 size_t	cursor_argc;			/* location of cursor in margv */
 size_t	cursor_argo;			/* offset of cursor margv[cursor_argc] */
 
@@ -49,6 +50,7 @@ makeargv(void)
 {
 	char	*cp, *cp2, *base, c;
 	char	**argp = margv;
+	int	shell = 0;
 
 	margc = 0;
 	cp = line;
@@ -59,9 +61,10 @@ makeargv(void)
 		*argp++ = "!";	/* No room in string to get this */
 		margc++;
 		cp++;
+		shell = 1;
 	}
 	while ((c = *cp)) {
-		int inquote = 0;
+		int inquote = 0, quoted = 0;
 		while (isspace((unsigned char)c))
 			c = *++cp;
 		if (c == '\0')
@@ -78,13 +81,16 @@ makeargv(void)
 				}
 			} else {
 				if (c == '\\') {
+					quoted = 1;
 					if ((c = *++cp) == '\0')
 						break;
 				} else if (c == '"') {
 					inquote = '"';
+					quoted = 1;
 					continue;
 				} else if (c == '\'') {
 					inquote = '\'';
+					quoted = 1;
 					continue;
 				} else if (isspace((unsigned char)c)) {
 					cursor_argo = 0;
@@ -94,6 +100,12 @@ makeargv(void)
 			*cp2++ = c;
 		}
 		*cp2 = '\0';
+		/*
+		 * An output filter follows a bar of its own, which is told
+		 * apart from a quoted "|" by pointing at margbar.
+		 */
+		if (!shell && !quoted && strcmp(argp[-1], "|") == 0)
+			argp[-1] = margbar;
 		if (c == '\0') {
 			cursor_argc--;
 			break;
@@ -17,107 +17,779 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
 #include <termios.h>
 #include <errno.h>
 #include <string.h>
 #include <stdlib.h>
 #include <sys/ttycom.h>
 #include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 #include <wchar.h>
 
 #include "externs.h"
+#include "filter.h"
 
 #define PAGERPROMPT	" --More-- "
-#define BACKOVERPROMPT	"\b\b\b\b\b\b\b\b\b\b          \b\b\b\b\b\b\b\b\b\b"
+
+#define MORE_OBUFSIZE	65536	/* flush output at least this often */
+#define MORE_KEEPSIZE	(1024 * 1024)	/* line index kept between calls */
+#define MORE_READAHEAD	4096	/* lines indexed per search step */
+#define MORE_PATSIZE	256
+
+/* where the pager is in the line index */
+struct more_pos {
+	size_t	line;		/* next line to show */
+	size_t	top;		/* first line of the current screen */
+	size_t	page;		/* lines per screen */
+	int	budget;		/* rows to show before the next prompt */
+};
 
 int	nsh_cbreak(void);
 void	nsh_nocbreak(void);
 
+static int	more_width(const char *, size_t);
+static void	more_put(const char *, size_t);
+static void	more_flush(void);
+static void	more_index(const char *, size_t, void *);
+static size_t	more_read(FILE *, size_t);
+static void	more_compile(const char *);
+static ssize_t	more_search(FILE *, size_t);
+static int	more_getpattern(char *, size_t);
+static int	more_prompt(const char *);
+static int	more_command(FILE *, struct more_pos *);
+static int	more_page(FILE *);
+static int	more_onstdout(void);
+static int	more_reap(void);
+static void	more_sigint(int);
+static void	more_sigpipe(int);
+
 static struct termios	oldtty;
 
+static pid_t	more_pid = -1;		/* pager reading from more_pipe */
+static FILE	*more_pipe;
+static sig_t	more_oldsigpipe;
+static int	more_savedout = -1;	/* stdout while it is the pager */
+static struct filter *more_stdfilter;
+static volatile sig_atomic_t more_intr;
+
 struct winsize winsize;
 
 /*
- * Display file
+ * Scratch space kept between calls, so paging a long file does not
+ * allocate per line: the line read, its wide character form and the
+ * output collected until the next prompt.
  */
-int
-more(char *fname)
+static char	*more_line;
+static size_t	 more_linesize;
+static wchar_t	*more_ws;
+static size_t	 more_wssize;
+static char	*more_obuf;
+static size_t	 more_olen, more_osize;
+
+/*
+ * Lines read so far, NUL terminated one after the other in more_text
+ * and found by their offsets in more_loff, so going back to a line or
+ * jumping to one is a lookup.  The last search pattern is kept with
+ * its skip table.
+ */
+static char	*more_text;
+static size_t	 more_tlen, more_tsize;
+static size_t	*more_loff;
+static size_t	 more_nlines, more_loffsize;
+static int	 more_eof;
+static struct filter *more_filter;	/* applied to lines as they are read */
+static char	 more_pat[MORE_PATSIZE];
+static size_t	 more_patlen;
+static size_t	 more_skip[256];
+
+/*
+ * Display width of line, -1 if it holds unprintable wide characters or
+ * -2 if it is not valid in the current locale.  Pure 7-bit lines, the
+ * usual case, are measured without conversion.
+ */
+static int
+more_width(const char *line, size_t len)
 {
-	FILE   *f;
-	char   *input, c;
-	size_t	s, wlen;
-	int	i, nopager = 0;
-	wchar_t *ws = NULL;
+	size_t i;
+	int width = 0;
+	wchar_t *ws;
 
-	if ((f = fopen(fname, "r")) == NULL) {
-		if (errno == ENOENT)
-			printf ("%% File %s not found\n", fname);
+	for (i = 0; i < len; i++) {
+		if ((unsigned char)line[i] >= 0x80)
+			break;
+		if (line[i] == '\t')
+			width = (width + 8) & ~7;
+		else if (line[i] >= ' ' && line[i] < 0x7f)
+			width++;
+	}
+	if (i == len)
+		return (width);
+
+	/* a line has no more wide characters than bytes */
+	if (len + 1 > more_wssize) {
+		if ((ws = reallocarray(more_ws, len + 1, sizeof(*ws))) == NULL)
+			return (-1);
+		more_ws = ws;
+		more_wssize = len + 1;
+	}
+	if (mbstowcs(more_ws, line, more_wssize) == (size_t)-1)
+		return (-2);
+	return (wcswidth(more_ws, wcslen(more_ws)));
+}
+
+/*
+ * Queue output for the screen, or write it straight away if there is no
+ * room to queue it.
+ */
+static void
+more_put(const char *buf, size_t len)
+{
+	size_t size;
+	char *p;
+
+	if (more_olen + len > more_osize) {
+		size = more_osize ? more_osize : MORE_OBUFSIZE;
+		while (size < more_olen + len)
+			size *= 2;
+		if ((p = realloc(more_obuf, size)) == NULL) {
+			more_flush();
+			fwrite(buf, 1, len, stdout);
+			return;
+		}
+		more_obuf = p;
+		more_osize = size;
+	}
+	memcpy(more_obuf + more_olen, buf, len);
+	more_olen += len;
+}
+
+/*
+ * Write queued output with as few write(2) calls as it takes; a line
+ * buffered stdout would make one per line.
+ */
+static void
+more_flush(void)
+{
+	size_t off;
+	ssize_t n;
+
+	fflush(stdout);
+	for (off = 0; off < more_olen; off += n) {
+		n = write(STDOUT_FILENO, more_obuf + off, more_olen - off);
+		if (n == -1) {
+			if (errno == EINTR) {
+				n = 0;
+				continue;
+			}
+			break;
+		}
+	}
+	more_olen = 0;
+}
+
+/*
+ * Append line, NUL terminated at len, to the index.  The output
+ * filters call this for each line they let through.
+ */
+static void
+more_index(const char *line, size_t len, void *arg)
+{
+	size_t	size, *loff;
+	char	*p;
+
+	if (more_tlen + len + 1 > more_tsize) {
+		size = more_tsize ? more_tsize : MORE_OBUFSIZE;
+		while (size < more_tlen + len + 1)
+			size *= 2;
+		if ((p = realloc(more_text, size)) == NULL) {
+			more_eof = 1;
+			return;
+		}
+		more_text = p;
+		more_tsize = size;
+	}
+	if (more_nlines == more_loffsize) {
+		size = more_loffsize ? more_loffsize * 2 : 1024;
+		if ((loff = reallocarray(more_loff, size,
+		    sizeof(*loff))) == NULL) {
+			more_eof = 1;
+			return;
+		}
+		more_loff = loff;
+		more_loffsize = size;
+	}
+
+	memcpy(more_text + more_tlen, line, len + 1);
+	more_loff[more_nlines++] = more_tlen;
+	more_tlen += len + 1;
+}
+
+/*
+ * Index lines of f until there are want of them or f ends.  Returns
+ * the number of lines indexed.
+ */
+static size_t
+more_read(FILE *f, size_t want)
+{
+	ssize_t	len;
+
+	while (more_nlines < want && !more_eof) {
+		if ((len = getline(&more_line, &more_linesize, f)) == -1) {
+			more_eof = 1;
+			if (more_filter != NULL)
+				filter_end(more_filter, more_index, NULL);
+			break;
+		}
+		if (len > 0 && more_line[len - 1] == '\n')
+			more_line[--len] = '\0';
+
+		if (more_filter != NULL)
+			filter_line(more_filter, more_line, len, more_index,
+			    NULL);
 		else
-			printf ("%% more: fopen(%s): %s\n", fname,
-			    strerror(errno));
-		return(0);
+			more_index(more_line, len, NULL);
+	}
+	return (more_nlines);
+}
+
+/*
+ * Set up a Horspool skip table for pattern; searching the index then
+ * mostly moves a whole pattern length per comparison.
+ */
+static void
+more_compile(const char *pattern)
+{
+	size_t i;
+
+	more_patlen = strlcpy(more_pat, pattern, sizeof(more_pat));
+	if (more_patlen >= sizeof(more_pat))
+		more_patlen = sizeof(more_pat) - 1;
+	for (i = 0; i < nitems(more_skip); i++)
+		more_skip[i] = more_patlen;
+	for (i = 0; i + 1 < more_patlen; i++)
+		more_skip[(unsigned char)more_pat[i]] = more_patlen - 1 - i;
+}
+
+/*
+ * First line at or after start holding the pattern, indexing more of f
+ * as needed, or -1.  Lines never hold a NUL, so a match cannot span
+ * the terminators between them.
+ */
+static ssize_t
+more_search(FILE *f, size_t start)
+{
+	const u_char *text, *pat = (const u_char *)more_pat;
+	size_t from, pos, last, lo, hi, mid, n;
+	u_char c;
+
+	if (more_patlen == 0 || more_read(f, start + 1) <= start)
+		return (-1);
+	last = more_patlen - 1;
+	from = more_loff[start];
+	for (;;) {
+		text = (const u_char *)more_text;
+		for (pos = from; pos + last < more_tlen;
+		    pos += more_skip[c]) {
+			c = text[pos + last];
+			if (c == pat[last] &&
+			    memcmp(text + pos, pat, last) == 0)
+				goto found;
+		}
+		from = more_tlen;
+		n = more_nlines;
+		if (more_read(f, n + MORE_READAHEAD) == n)
+			return (-1);
+	}
+found:
+	for (lo = start, hi = more_nlines; hi - lo > 1; ) {
+		mid = (lo + hi) / 2;
+		if (more_loff[mid] <= pos)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	return (lo);
+}
+
+/*
+ * Read a search pattern after a "/" prompt.  Returns -1 if cancelled.
+ */
+static int
+more_getpattern(char *buf, size_t size)
+{
+	size_t len = 0;
+	int c;
+
+	printf("/");
+	fflush(stdout);
+	for (;;) {
+		c = getchar();
+		if (c == EOF || c == '\033' ||
+		    ((c == '\b' || c == 0x7f) && len == 0)) {
+			printf("\r%*s\r", (int)len + 1, "");
+			return (-1);
+		}
+		if (c == '\r' || c == '\n')
+			break;
+		if (c == '\b' || c == 0x7f) {
+			len--;
+			printf("\b \b");
+		} else if (len + 1 < size && (c >= ' ' || c == '\t')) {
+			buf[len++] = c;
+			putchar(c);
+		}
+		fflush(stdout);
 	}
+	printf("\r%*s\r", (int)len + 1, "");
+	buf[len] = '\0';
+	return (0);
+}
+
+/*
+ * Prompt for a key, behind msg if there is one, and erase the prompt.
+ */
+static int
+more_prompt(const char *msg)
+{
+	int c, n;
+
+	n = printf("%s%s", msg ? msg : "", PAGERPROMPT);
+	fflush(stdout);
+	c = getchar();
+	printf("\r%*s\r", n, "");
+	return (c);
+}
+
+/*
+ * Act on keys at the prompt until one moves on.  Returns 0 if the user
+ * quit.
+ */
+static int
+more_command(FILE *f, struct more_pos *mp)
+{
+	char	pattern[sizeof(more_pat)], msg[64];
+	const char *m = NULL;
+	size_t	count = 0, target;
+	ssize_t	match;
+	int	c;
+
+	for (;;) {
+		c = more_prompt(m);
+		m = NULL;
+		if (c >= '0' && c <= '9') {
+			count = count * 10 + (c - '0');
+			continue;
+		}
+		switch (c) {
+		case EOF:
+		case 'q':
+			return (0);
+		case '\r':
+		case '\n':
+		case 'j':
+		case CTRL('n'):
+			/* one more line */
+			mp->budget = 1;
+			mp->top++;
+			return (1);
+		case ' ':
+		case 'f':
+		case CTRL('f'):
+			mp->budget = mp->page;
+			mp->top = mp->line;
+			return (1);
+		case 'g':
+		case 'G':
+			if (count > 0)
+				target = count - 1;
+			else if (c == 'g')
+				target = 0;
+			else {
+				/* the last screen, below the skip notice */
+				more_read(f, SIZE_MAX);
+				target = more_nlines > mp->page - 1 ?
+				    more_nlines - (mp->page - 1) : 0;
+			}
+			if (more_read(f, target + 1) <= target) {
+				snprintf(msg, sizeof(msg),
+				    "(only %zu lines)", more_nlines);
+				m = msg;
+				count = 0;
+				continue;
+			}
+			break;
+		case '/':
+			if (more_getpattern(pattern, sizeof(pattern)) == -1)
+				continue;
+			if (pattern[0] != '\0')
+				more_compile(pattern);
+			/* FALLTHROUGH */
+		case 'n':
+			if (more_patlen == 0) {
+				m = "(no previous pattern)";
+				continue;
+			}
+			if ((match = more_search(f, mp->top + 1)) == -1) {
+				m = "(pattern not found)";
+				continue;
+			}
+			target = match;
+			break;
+		default:
+			count = 0;
+			continue;
+		}
+
+		/* jump, the line index makes this a lookup */
+		printf("...skipping to line %zu\n", target + 1);
+		mp->line = mp->top = target;
+		mp->budget = mp->page - 1;
+		return (1);
+	}
+}
 
-	if (!interactive_mode || nsh_cbreak() < 0)
-		nopager = 1;
+/*
+ * Page f to the screen, taking the terminal only once a screen has
+ * filled.  Lines read are indexed so the pager can go back to them.
+ * Returns 0 if the user quit, 1 once f was shown to its end.
+ */
+static int
+more_page(FILE *f)
+{
+	struct more_pos mp;
+	size_t	len, wlen;
+	int	width, rows, used = 0, cbreak = 0, ret = 1;
+	int	nopager = !interactive_mode;
+	char	*text;
+	wchar_t *ws;
+
+	more_tlen = more_nlines = 0;
+	more_eof = 0;
 
-	for (i = 0; (input = fgetln(f, &s)) != NULL; i++) {
-		int extra_rows = 0;
+	memset(&mp, 0, sizeof(mp));
+	mp.page = winsize.ws_row > 1 ? winsize.ws_row - 1 : 1;
+	mp.budget = mp.page;
 
-		/*
-		 * We replace newline (or whatever was at the end of
-	         * the line) with NUL termination
-		 */
-		input[s - 1] = '\0';
+	while (more_read(f, mp.line + 1) > mp.line) {
+		text = more_text + more_loff[mp.line];
+		len = (mp.line + 1 < more_nlines ?
+		    more_loff[mp.line + 1] : more_tlen) - more_loff[mp.line] - 1;
 
 		/* Account for lines overflowing the terminal's width. */
-		if (mbs2ws(&ws, &wlen, input) == 0) {
-			int width = wcswidth(ws, wcslen(ws));
-			if (width == -1) { /* unprintable wide character */
+		ws = NULL;
+		if ((width = more_width(text, len)) == -2 &&
+		    mbs2ws(&ws, &wlen, text) == 0) {
+			/* invalid in this locale, show it made visible */
+			if ((width = wcswidth(ws, wcslen(ws))) == -1) {
 				free(ws);
 				ws = NULL;
-			} else
-				extra_rows = width / winsize.ws_col;
-		} else
-			ws = NULL;
-
-		if (!nopager && i + extra_rows >= (winsize.ws_row - 1)) {
-			for (;;) {
-				printf(PAGERPROMPT);
-				fflush(0);
-				c = getchar();
-				printf(BACKOVERPROMPT);
-				if (c == 'q')
+			}
+		}
+		rows = 1 + (width > 0 ? width / winsize.ws_col : 0);
+
+		if (!nopager && used > 0 && used + rows > mp.budget) {
+			more_flush();
+			if (!cbreak) {
+				if (nsh_cbreak() < 0)
+					nopager = 1;
+				else
+					cbreak = 1;
+			}
+			if (cbreak) {
+				free(ws);
+				if (!more_command(f, &mp)) {
+					ret = 0;
 					goto quit;
-				if (c == '\r' || c == '\n' || c == 'j' ||
-				    c == CTRL('n')) {
-					i--; /* skip one line */
-					break;
-				}
-				if (c == ' ' || c == 'f' || c == CTRL('f')) {
-					i = 0; /* skip one page */
-					break;
 				}
+				mp.page = winsize.ws_row > 1 ?
+				    winsize.ws_row - 1 : 1;
+				used = 0;
+				continue;
 			}
 		}
 
 		if (ws) {
+			more_flush();
 			printf("%ls\n", ws);
 			free(ws);
-			ws = NULL;
+		} else {
+			more_put(text, len);
+			more_put("\n", 1);
+		}
+		if (more_olen >= MORE_OBUFSIZE)
+			more_flush();
+		used += rows;
+
+		if (nopager && mp.line + 1 == more_nlines) {
+			/* nothing to go back to, keep no more than needed */
+			more_tlen = more_nlines = 0;
+			mp.line = 0;
 		} else
-			printf("%s\n", input);
-		i += extra_rows;
+			mp.line++;
 	}
+	if (more_intr)
+		ret = 0;
 quit:
-	if (!nopager)
+	more_flush();
+	if (cbreak)
 		nsh_nocbreak();
 
+	if (more_tsize > MORE_KEEPSIZE) {
+		free(more_text);
+		free(more_loff);
+		more_text = NULL;
+		more_loff = NULL;
+		more_tsize = more_loffsize = 0;
+	}
+	more_tlen = more_nlines = 0;
+
+	return(ret);
+}
+
+/*
+ * Display file
+ */
+int
+more(char *fname)
+{
+	FILE   *f;
+
+	if ((f = fopen(fname, "r")) == NULL) {
+		if (errno == ENOENT)
+			printf ("%% File %s not found\n", fname);
+		else
+			printf ("%% more: fopen(%s): %s\n", fname,
+			    strerror(errno));
+		return(0);
+	}
+
+	more_page(f);
+
 	fclose(f);
-	free(ws);
 	return(1);
 }
 
+/*
+ * Display what can be read from fd, such as the read end of a pipe,
+ * until end of file.  Returns 0 if the user quit early.
+ */
+int
+more_fd(int fd)
+{
+	FILE   *f;
+	int	ret;
+
+	if ((fd = dup(fd)) == -1) {
+		printf("%% more_fd: dup: %s\n", strerror(errno));
+		return(1);
+	}
+	if ((f = fdopen(fd, "r")) == NULL) {
+		printf("%% more_fd: fdopen: %s\n", strerror(errno));
+		close(fd);
+		return(1);
+	}
+	ret = more_page(f);
+	fclose(f);
+	return(ret);
+}
+
+/*
+ * Display len bytes of buf.  Returns 0 if the user quit early.
+ */
+int
+more_buf(const char *buf, size_t len)
+{
+	FILE   *f;
+	int	ret;
+
+	if (len == 0)
+		return(1);
+	if ((f = fmemopen((void *)buf, len, "r")) == NULL) {
+		printf("%% more_buf: fmemopen: %s\n", strerror(errno));
+		return(1);
+	}
+	ret = more_page(f);
+	fclose(f);
+	return(ret);
+}
+
+static void
+more_sigint(int signo)
+{
+	more_intr = 1;
+}
+
+static void
+more_sigpipe(int signo)
+{
+	/* writes to a pager which has quit fail with EPIPE instead */
+}
+
+/*
+ * Is stdout the pipe to the pager?
+ */
+static int
+more_onstdout(void)
+{
+	struct stat out, sb;
+
+	return (more_pipe != NULL && fstat(STDOUT_FILENO, &out) == 0 &&
+	    fstat(fileno(more_pipe), &sb) == 0 &&
+	    out.st_dev == sb.st_dev && out.st_ino == sb.st_ino);
+}
+
+/*
+ * Return a stream which is paged while it is written to, by a child
+ * reading the other end of a pipe, so the first screen shows before
+ * the producer is done.  The child passes lines through filter first,
+ * if there is one.  Once the user quits, writes to the stream fail and
+ * the producer may check ferror() to stop early.  Without a terminal
+ * and a filter, or if the pager cannot be started, this is just stdout.
+ */
+FILE *
+more_open(struct filter *filter)
+{
+	struct sigaction sa;
+	int fds[2];
+
+	/* within a filtered command, whose pager already reads stdout */
+	if (more_onstdout())
+		return(stdout);
+	/* a pager left behind when ^C unwound its producer */
+	more_reap();
+
+	if (!interactive_mode && filter == NULL)
+		return(stdout);
+	if (pipe2(fds, O_CLOEXEC) == -1) {
+		printf("%% more_open: pipe2: %s\n", strerror(errno));
+		return(stdout);
+	}
+
+	fflush(stdout);
+	switch (more_pid = fork()) {
+	case -1:
+		printf("%% more_open: fork: %s\n", strerror(errno));
+		close(fds[0]);
+		close(fds[1]);
+		return(stdout);
+	case 0:
+		close(fds[1]);
+		more_filter = filter;
+		/* ^C quits; no SA_RESTART so a blocked read returns */
+		memset(&sa, 0, sizeof(sa));
+		sa.sa_handler = more_sigint;
+		sigemptyset(&sa.sa_mask);
+		sigaction(SIGINT, &sa, NULL);
+		_exit(more_fd(fds[0]) ? 0 : 1);
+	}
+
+	close(fds[0]);
+	more_oldsigpipe = signal(SIGPIPE, more_sigpipe);
+	if ((more_pipe = fdopen(fds[1], "w")) == NULL) {
+		printf("%% more_open: fdopen: %s\n", strerror(errno));
+		close(fds[1]);
+		more_reap();
+		return(stdout);
+	}
+	return(more_pipe);
+}
+
+/*
+ * Finish a stream from more_open(), waiting for the user to page
+ * through the rest of it.  Returns 0 if the user quit early.
+ */
+int
+more_close(FILE *f)
+{
+	if (f != more_pipe) {
+		fflush(f);
+		return(1);
+	}
+	return(more_reap());
+}
+
+/*
+ * Point stdout, and with it the output of programs run meanwhile, at a
+ * pager which passes lines through filter.  The filter is freed by
+ * more_endstdout().  Returns -1 if the pager could not be started.
+ */
+int
+more_stdout(struct filter *filter)
+{
+	FILE *f;
+
+	if ((f = more_open(filter)) == stdout) {
+		filter_free(filter);
+		return(-1);
+	}
+	fflush(stdout);
+	if ((more_savedout = dup(STDOUT_FILENO)) == -1 ||
+	    dup2(fileno(f), STDOUT_FILENO) == -1) {
+		printf("%% more_stdout: dup: %s\n", strerror(errno));
+		if (more_savedout != -1)
+			close(more_savedout);
+		more_savedout = -1;
+		more_close(f);
+		filter_free(filter);
+		return(-1);
+	}
+	more_stdfilter = filter;
+	return(0);
+}
+
+/*
+ * Put stdout back after more_stdout() and wait for the pager.  Returns
+ * 0 if the user quit early.
+ */
+int
+more_endstdout(void)
+{
+	if (more_savedout == -1)
+		return(1);
+
+	fflush(stdout);
+	dup2(more_savedout, STDOUT_FILENO);
+	close(more_savedout);
+	more_savedout = -1;
+	filter_free(more_stdfilter);
+	more_stdfilter = NULL;
+	return(more_reap());
+}
+
+/*
+ * Clean up after ^C unwound a command that was being paged.
+ */
+void
+more_abort(void)
+{
+	more_endstdout();
+	more_reap();
+}
+
+static int
+more_reap(void)
+{
+	int status = 0;
+
+	if (more_pipe != NULL) {
+		fclose(more_pipe);
+		more_pipe = NULL;
+	}
+	if (more_pid == -1)
+		return(1);
+
+	while (waitpid(more_pid, &status, 0) == -1)
+		if (errno != EINTR)
+			break;
+	more_pid = -1;
+	signal(SIGPIPE, more_oldsigpipe);
+
+	return(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
 int
 nsh_cbreak(void)
 {
@@ -112,20 +112,19 @@
 static int tflag;
 static int rtsock = -1;
 
-char host_buf[NI_MAXHOST];		/* getnameinfo() */
-char ifix_buf[IFNAMSIZ];		/* if_indextoname() */
+char host_buf[ADDRNAMELEN];		/* routename_r() */
 
 static int getsocket(void);
 int parse_host(const char *, struct sockaddr_in6 *);
 int ndpset(int, char **);
 void ndpget(const char *);
 int ndpdelete(const char *);
-void ndpdump(struct sockaddr_in6 *, int);
-static struct in6_nbrinfo *getnbrinfo(struct in6_addr *, int, int);
+void ndpdump(struct sockaddr_in6 *, int, int);
+static struct in6_nbrinfo *getnbrinfo(int, struct in6_addr *, int, int);
 int ndp_ether_aton(const char *, u_char *);
 int rtmsg_ndp(int);
 int rtget_ndp(struct sockaddr_in6 **, struct sockaddr_dl **);
-void conf_ndp(FILE *output, char *delim);
+void conf_ndp(FILE *output, char *delim, struct rtdump *);
 void conf_ndp_entry(FILE *, char *, struct  rt_msghdr *);
 
 static int
@@ -289,7 +288,7 @@ ndpget(const char *host)
 		return;
 
 	found_entry = 0;
-	ndpdump(sin, 0);
+	ndpdump(sin, 0, NDP_DETAIL);
 	if (found_entry == 0)
 		printf("%s -- no entry\n", host);
 }
@@ -345,63 +344,100 @@ delete:
 #define W_LL	17
 #define W_IF	7
 
+static const struct ndpstate {
+	int	 state;
+	char	 flag;
+	char	*name;
+} ndpstates[] = {
+	{ ND6_LLINFO_NOSTATE,		'N',	"nostate" },
+	{ ND6_LLINFO_INCOMPLETE,	'I',	"incomplete" },
+	{ ND6_LLINFO_REACHABLE,		'R',	"reachable" },
+	{ ND6_LLINFO_STALE,		'S',	"stale" },
+	{ ND6_LLINFO_DELAY,		'D',	"delay" },
+	{ ND6_LLINFO_PROBE,		'P',	"probe" },
+	{ 0,				0,	NULL }
+};
+
+/*
+ * Print the NDP state counts gathered by ndpdump()
+ */
+static void
+ndpsummary(u_int total, u_int *statecount, u_int unknown, u_int noinfo,
+    u_int routers, u_int permanent, u_int local, u_int proxy)
+{
+	const struct ndpstate *st;
+	int i;
+
+	printf("%% %u neighbor cache entries\n", total);
+	printf("\n  %-16s %10s\n", "State", "Entries");
+	for (st = ndpstates, i = 0; st->name != NULL; st++, i++)
+		if (statecount[i])
+			printf("  %-16s %10u\n", st->name, statecount[i]);
+	if (unknown)
+		printf("  %-16s %10u\n", "unknown", unknown);
+	if (noinfo)
+		printf("  %-16s %10u\n", "no information", noinfo);
+
+	printf("\n  %-16s %10u\n", "routers", routers);
+	printf("  %-16s %10u\n", "permanent", permanent);
+	printf("  %-16s %10u\n", "local", local);
+	printf("  %-16s %10u\n", "proxy", proxy);
+}
+
 /*
  * Dump the entire neighbor cache
+ *
+ * NDP_BRIEF takes everything from the routing table dump.  NDP_DETAIL
+ * adds the neighbor state, router flag and probe count, and
+ * NDP_SUMMARY only counts states; both need a SIOCGNBRINFO_IN6 ioctl
+ * per entry, which is issued on a single socket for the whole walk.
  */
 void
-ndpdump(struct sockaddr_in6 *addr, int cflag)
+ndpdump(struct sockaddr_in6 *addr, int cflag, int mode)
 {
-	int mib[7];
-	size_t needed;
-	char *lim, *buf = NULL, *next;
+	const struct ndpstate *st;
+	struct rtdump *rtdump;
+	char *next;
 	struct rt_msghdr *rtm;
 	struct sockaddr_in6 *sin;
 	struct sockaddr_dl *sdl;
 	struct in6_nbrinfo *nbi;
 	struct timeval now;
+	u_int statecount[nitems(ndpstates)];
+	u_int total = 0, unknown = 0, noinfo = 0, routers = 0;
+	u_int permanent = 0, local = 0, proxy = 0;
 	int addrwidth;
 	int llwidth;
 	int ifwidth;
-	char *ifname;
+	int nbrsock = -1, i;
+	time_t expire;
+	const char *ifname;
+	char lladdr[ETHER_STRLEN];
 
 	/* Print header */
-	if (!tflag && !cflag)
-		printf("%-*.*s %-*.*s %*.*s %-9.9s %1s %5s\n",
+	if (!tflag && !cflag && mode != NDP_SUMMARY)
+		printf("%-*.*s %-*.*s %*.*s %-9.9s %s%5s\n",
 		    W_ADDR, W_ADDR, "Neighbor", W_LL, W_LL, "Linklayer Address",
-		    W_IF, W_IF, "Netif", "Expire", "S", "Flags");
-
-	lim = NULL;
-	mib[0] = CTL_NET;
-	mib[1] = PF_ROUTE;
-	mib[2] = 0;
-	mib[3] = AF_INET6;
-	mib[4] = NET_RT_FLAGS;
-	mib[5] = RTF_LLINFO;
-	mib[6] = cli_rtable;
-	while (1) {
-		if (sysctl(mib, 7, NULL, &needed, NULL, 0) == -1) {
-			printf("%% sysctl(PF_ROUTE estimate): %s\n",
-			    strerror(errno));
-			return;
-		}
-		if (needed == 0)
-			break;
-		if ((buf = realloc(buf, needed)) == NULL) {
-			printf("%% realloc: %s\n", strerror(errno));
-			return;
-		}
-		if (sysctl(mib, 7, buf, &needed, NULL, 0) == -1) {
-			if (errno == ENOMEM)
-				continue;
-			printf("%% sysctl(PF_ROUTE, NET_RT_FLAGS): %s\n",
-			    strerror(errno));
-			return;
-		}
-		lim = buf + needed;
-		break;
+		    W_IF, W_IF, "Netif", "Expire",
+		    mode == NDP_DETAIL ? "S " : "", "Flags");
+
+	if ((rtdump = getrtdump(AF_INET6, RTF_LLINFO, cli_rtable)) == NULL) {
+		if (mode == NDP_SUMMARY)
+			printf("%% 0 neighbor cache entries\n");
+		return;
 	}
+	ifcache_sync();
 
-	for (next = buf; next && lim && next < lim; next += rtm->rtm_msglen) {
+	if (!cflag && mode != NDP_BRIEF &&
+	    (nbrsock = socket(AF_INET6, SOCK_DGRAM, 0)) == -1) {
+		printf("%% socket: %s\n", strerror(errno));
+		freertdump(rtdump);
+		return;
+	}
+	memset(statecount, 0, sizeof(statecount));
+	gettimeofday(&now, 0);
+
+	for (next = rtdump->buf; next < rtdump->lim; next += rtm->rtm_msglen) {
 		int isrouter = 0, prbs = 0;
 
 		rtm = (struct rt_msghdr *)next;
@@ -450,18 +486,52 @@ ndpdump(struct sockaddr_in6 *addr, int cflag)
 			found_entry = 1;
 		} else if (IN6_IS_ADDR_MULTICAST(&sin->sin6_addr))
 			continue;
-		getnameinfo((struct sockaddr *)sin, sin->sin6_len, host_buf,
-		    sizeof(host_buf), NULL, 0, NI_NUMERICHOST);
+
 		if (cflag) {
-			if (rtm->rtm_flags & RTF_CLONED)
+			if (rtm->rtm_flags & RTF_CLONED) {
+				routename_r((struct sockaddr *)sin, host_buf,
+				    sizeof(host_buf));
 				ndpdelete(host_buf);
+			}
+			continue;
+		}
+
+		nbi = NULL;
+		if (nbrsock != -1)
+			nbi = getnbrinfo(nbrsock, &sin->sin6_addr,
+			    sdl->sdl_index, mode == NDP_DETAIL);
+
+		if (mode == NDP_SUMMARY) {
+			total++;
+			if (nbi == NULL)
+				noinfo++;
+			else {
+				for (st = ndpstates, i = 0; st->name != NULL;
+				    st++, i++)
+					if (st->state == nbi->state)
+						break;
+				if (st->name != NULL)
+					statecount[i]++;
+				else
+					unknown++;
+				if (nbi->isrouter)
+					routers++;
+			}
+			if ((rtm->rtm_flags & RTF_LOCAL) ||
+			    rtm->rtm_rmx.rmx_expire == 0)
+				permanent++;
+			if (rtm->rtm_flags & RTF_LOCAL)
+				local++;
+			if (rtm->rtm_flags & RTF_ANNOUNCE)
+				proxy++;
 			continue;
 		}
-		gettimeofday(&now, 0);
+
 		if (tflag) {
 			char buf[sizeof("00:00:00")];
 			struct tm *tm;
 
+			gettimeofday(&now, 0);
 			tm = localtime(&now.tv_sec);
 			if (tm != NULL) {
 				strftime(buf, sizeof(buf), "%H:%M:%S", tm);
@@ -469,13 +539,16 @@ ndpdump(struct sockaddr_in6 *addr, int cflag)
 			}
 		}
 
+		routename_r((struct sockaddr *)sin, host_buf, sizeof(host_buf));
+		ether_str_r(sdl, lladdr, sizeof(lladdr));
+
 		addrwidth = strlen(host_buf);
 		if (addrwidth < W_ADDR)
 			addrwidth = W_ADDR;
-		llwidth = strlen(ether_str(sdl));
+		llwidth = strlen(lladdr);
 		if (W_ADDR + W_LL - addrwidth > llwidth)
 			llwidth = W_ADDR + W_LL - addrwidth;
-		ifname = if_indextoname(sdl->sdl_index, ifix_buf);
+		ifname = ifcache_name(sdl->sdl_index);
 		if (!ifname)
 			ifname = "?";
 		ifwidth = strlen(ifname);
@@ -483,47 +556,32 @@ ndpdump(struct sockaddr_in6 *addr, int cflag)
 			ifwidth = W_ADDR + W_LL + W_IF - addrwidth - llwidth;
 
 		printf("%-*.*s %-*.*s %*.*s", addrwidth, addrwidth, host_buf,
-		    llwidth, llwidth, ether_str(sdl), ifwidth, ifwidth, ifname);
+		    llwidth, llwidth, lladdr, ifwidth, ifwidth, ifname);
 
 		/* Print neighbor discovery specific information */
-		nbi = getnbrinfo(&sin->sin6_addr, sdl->sdl_index, 1);
-		if (nbi) {
-			if (nbi->expire > now.tv_sec) {
-				printf(" %-9.9s",
-				    sec2str(nbi->expire - now.tv_sec));
-			} else if (nbi->expire == 0)
-				printf(" %-9.9s", "permanent");
-			else
-				printf(" %-9.9s", "expired");
-
-			switch (nbi->state) {
-			case ND6_LLINFO_NOSTATE:
-				 printf(" N");
-				 break;
-			case ND6_LLINFO_INCOMPLETE:
-				 printf(" I");
-				 break;
-			case ND6_LLINFO_REACHABLE:
-				 printf(" R");
-				 break;
-			case ND6_LLINFO_STALE:
-				 printf(" S");
-				 break;
-			case ND6_LLINFO_DELAY:
-				 printf(" D");
-				 break;
-			case ND6_LLINFO_PROBE:
-				 printf(" P");
-				 break;
-			default:
-				 printf(" ?");
-				 break;
-			}
-
-			isrouter = nbi->isrouter;
-			prbs = nbi->asked;
-		} else {
-			printf("  ");
+		if (nbi)
+			expire = nbi->expire;
+		else if (rtm->rtm_flags & RTF_LOCAL)
+			expire = 0;
+		else
+			expire = rtm->rtm_rmx.rmx_expire;
+		if (expire > now.tv_sec)
+			printf(" %-9.9s", sec2str(expire - now.tv_sec));
+		else if (expire == 0)
+			printf(" %-9.9s", "permanent");
+		else
+			printf(" %-9.9s", "expired");
+
+		if (mode == NDP_DETAIL) {
+			if (nbi) {
+				for (st = ndpstates; st->name != NULL; st++)
+					if (st->state == nbi->state)
+						break;
+				printf(" %c", st->name ? st->flag : '?');
+				isrouter = nbi->isrouter;
+				prbs = nbi->asked;
+			} else
+				printf("  ");
 		}
 
 		printf(" %s%s%s",
@@ -537,36 +595,32 @@ ndpdump(struct sockaddr_in6 *addr, int cflag)
 		printf("\n");
 	}
 
-	if (!nbi)
-		printf("\n%% %s: failed to get neighbor information\n",
-		    routename6(sin));
+	if (mode == NDP_SUMMARY)
+		ndpsummary(total, statecount, unknown, noinfo, routers,
+		    permanent, local, proxy);
 
-	free(buf);
+	if (nbrsock != -1)
+		close(nbrsock);
+	freertdump(rtdump);
 }
 
 static struct in6_nbrinfo *
-getnbrinfo(struct in6_addr *addr, int ifindex, int warning)
+getnbrinfo(int s, struct in6_addr *addr, int ifindex, int warning)
 {
 	static struct in6_nbrinfo nbi;
-	int s;
-
-	if ((s = socket(AF_INET6, SOCK_DGRAM, 0)) == -1) {
-		printf("%% socket: %s\n", strerror(errno));
-		return NULL;
-	}
+	const char *ifname;
 
 	bzero(&nbi, sizeof(nbi));
-	if_indextoname(ifindex, nbi.ifname);
+	if ((ifname = ifcache_name(ifindex)) != NULL)
+		strlcpy(nbi.ifname, ifname, sizeof(nbi.ifname));
 	nbi.addr = *addr;
 	if (ioctl(s, SIOCGNBRINFO_IN6, (caddr_t)&nbi) == -1) {
 		if (warning)
 			printf("%% getnbrinfo: ioctl(SIOCGNBRINFO_IN6): %s\n",
 			    strerror(errno));
-		close(s);
 		return(NULL);
 	}
 
-	close(s);
 	return(&nbi);
 }
 
@@ -738,15 +792,18 @@ rtget_ndp(struct sockaddr_in6 **sinp, struct sockaddr_dl **sdlp)
 	return (0);
 }
 
+/*
+ * Print NDP entries from a RTF_LLINFO dump of any address family
+ */
 void
-conf_ndp(FILE *output, char *delim)
+conf_ndp(FILE *output, char *delim, struct rtdump *rtdump)
 {
 	char *next;
 	struct rt_msghdr *rtm;
-	struct rtdump *rtdump;
+	struct sockaddr *sa;
 
-	if ((rtdump = getrtdump(AF_INET6, RTF_LLINFO, 0)) == NULL)
-	    return;
+	if (rtdump == NULL)
+		return;
 
 	for (next = rtdump->buf; next < rtdump->lim; next += rtm->rtm_msglen) {
 		rtm = (struct rt_msghdr *)next;
@@ -754,9 +811,11 @@ conf_ndp(FILE *output, char *delim)
 			continue;
 		if (!(rtm->rtm_flags & RTF_HOST))
 			continue;
+		sa = (struct sockaddr *)(next + rtm->rtm_hdrlen);
+		if (sa->sa_family != AF_INET6)
+			continue;
 		conf_ndp_entry(output, delim, rtm);
 	}
-	freertdump(rtdump);
 	return;
 }
 
@@ -765,14 +824,16 @@ conf_ndp_entry(FILE *output, char *delim, struct rt_msghdr *rtm)
 {
 	struct sockaddr_in6 *sin6;
 	struct sockaddr_dl *sdl;
+	char host[ADDRNAMELEN], lladdr[ETHER_STRLEN];
 	
 	sin6 = (struct sockaddr_in6 *)((char *)rtm + rtm->rtm_hdrlen);
-	in6_fillscopeid(sin6);
 	sdl = (struct sockaddr_dl *)((char *)sin6 + ROUNDUP(sin6->sin6_len));
 	if (sdl->sdl_family != AF_LINK)
 		return;
 
-	fprintf(output, "%s%s %s", delim, routename6(sin6), ether_str(sdl));
+	fprintf(output, "%s%s %s", delim,
+	    routename_r((struct sockaddr *)sin6, host, sizeof(host)),
+	    ether_str_r(sdl, lladdr, sizeof(lladdr)));
 	if (rtm->rtm_flags & RTF_ANNOUNCE)
 		fputs(" proxy", output);
 	fputs("\n", output);
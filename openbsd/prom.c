@@ -0,0 +1,136 @@
+/*
+ * prom: Prometheus text exposition writer for the exporter
+ *
+ * A metric family is announced once with its type and optional help,
+ * then all of its samples follow, each with its own label pairs.  The
+ * format requires a family's samples to be written together, so the
+ * caller walks families in the outer loop; a family announced again
+ * straight after itself carries on.  Names are forced into the metric
+ * name alphabet and label values and help are escaped.  prom_render()
+ * runs a table of collectors into one buffer.  Nothing here talks to
+ * the kernel, which keeps the format usable with synthetic collectors.
+ */
+
+#include <sys/types.h>
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "prom.h"
+
+static void	prom_escape(FILE *, const char *, int);
+
+void
+prom_begin(struct prom *p, FILE *out)
+{
+	p->out = out;
+	p->name[0] = '\0';
+}
+
+/*
+ * Write s, escaping backslash and newline, and double quotes in a label
+ * value.
+ */
+static void
+prom_escape(FILE *out, const char *s, int quote)
+{
+	for (; *s != '\0'; s++) {
+		if (*s == '\\')
+			fputs("\\\\", out);
+		else if (*s == '\n')
+			fputs("\\n", out);
+		else if (*s == '"' && quote)
+			fputs("\\\"", out);
+		else
+			putc(*s, out);
+	}
+}
+
+/*
+ * Start the metric family name of type counter, gauge or untyped,
+ * unless it is the family being written.
+ */
+void
+prom_family(struct prom *p, const char *name, const char *type,
+    const char *help)
+{
+	char buf[PROM_NAMELEN], c;
+	size_t i;
+
+	/* [a-zA-Z_:][a-zA-Z0-9_:]* */
+	for (i = 0; name[i] != '\0' && i < sizeof(p->name) - 1; i++) {
+		c = name[i];
+		if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+		    c == '_' || c == ':' || (i > 0 && c >= '0' && c <= '9'))
+			buf[i] = c;
+		else
+			buf[i] = '_';
+	}
+	buf[i] = '\0';
+	if (strcmp(buf, p->name) == 0)
+		return;
+	memcpy(p->name, buf, i + 1);
+
+	if (help != NULL) {
+		fprintf(p->out, "# HELP %s ", p->name);
+		prom_escape(p->out, help, 0);
+		putc('\n', p->out);
+	}
+	fprintf(p->out, "# TYPE %s %s\n", p->name, type);
+}
+
+/*
+ * One sample of the current family, followed by label name and value
+ * pairs and a NULL.
+ */
+void
+prom_sample(struct prom *p, u_int64_t v, ...)
+{
+	va_list ap;
+	const char *label, *value;
+	int n = 0;
+
+	fputs(p->name, p->out);
+	va_start(ap, v);
+	while ((label = va_arg(ap, const char *)) != NULL) {
+		value = va_arg(ap, const char *);
+		fprintf(p->out, "%s%s=\"", n++ ? "," : "{", label);
+		prom_escape(p->out, value, 1);
+		putc('"', p->out);
+	}
+	va_end(ap);
+	if (n > 0)
+		putc('}', p->out);
+	fprintf(p->out, " %llu\n", (unsigned long long)v);
+}
+
+/*
+ * Run the n collectors in one pass and return what they wrote in *buf,
+ * to be freed by the caller.
+ */
+int
+prom_render(void (*const collectors[])(struct prom *), size_t n,
+    char **buf, size_t *len)
+{
+	struct prom p;
+	FILE *out;
+	size_t i;
+
+	if ((out = open_memstream(buf, len)) == NULL) {
+		printf("%% prom_render: open_memstream: %s\n",
+		    strerror(errno));
+		return (-1);
+	}
+	prom_begin(&p, out);
+	for (i = 0; i < n; i++)
+		(*collectors[i])(&p);
+	if (fclose(out) == EOF) {
+		printf("%% prom_render: %s\n", strerror(errno));
+		free(*buf);
+		return (-1);
+	}
+	return (0);
+}
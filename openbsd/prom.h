@@ -0,0 +1,14 @@
+/* Prometheus text exposition writer for the exporter, see prom.c */
+
+#define PROM_NAMELEN	128
+
+struct prom {
+	FILE	*out;
+	char	 name[PROM_NAMELEN];	/* family being written */
+};
+
+void	prom_begin(struct prom *, FILE *);
+void	prom_family(struct prom *, const char *, const char *, const char *);
+void	prom_sample(struct prom *, u_int64_t, ...);
+int	prom_render(void (*const [])(struct prom *), size_t, char **,
+	    size_t *);
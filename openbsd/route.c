@@ -244,18 +244,71 @@ int is_ip_addr(char *arg)
 	return(0);
 }
 
-void show_route(char *arg, int tableid)
+static int show_route_hdr;
+
+static void
+show_route_entry(struct rt_msghdr *rtm)
+{
+	struct sockaddr *sa = (struct sockaddr *)((char *)rtm +
+	    rtm->rtm_hdrlen);
+
+	if (show_route_hdr && !json_output) {
+		show_route_hdr = 0;
+		pr_rthdr(sa->sa_family);
+	}
+	p_rtentry(rtm);
+}
+
+/*
+ * show route <prefix> [longer-prefixes|exact|best]
+ * Without a match keyword, ask the kernel for the route it would use.
+ */
+void show_route(char *arg, char *match, int tableid)
 {
 	ip_t dest;
 	struct rt_metrics rt_metrics;
+	struct rtdump *rtdump;
+	struct rtree *rtree;
+	int how;
 
 	memset(&dest, 0, sizeof(ip_t));
 	memset(&rt_metrics, 0, sizeof(rt_metrics));
 
+	if (match == NULL)
+		how = -1;
+	else if (isprefix(match, "longer-prefixes"))
+		how = RTREE_LONGER;
+	else if (isprefix(match, "exact"))
+		how = RTREE_EXACT;
+	else if (isprefix(match, "best"))
+		how = RTREE_BEST;
+	else {
+		printf("%% Invalid argument %s\n", match);
+		printf("%% show route <prefix> [longer-prefixes|exact|best]\n");
+		return;
+	}
+
 	parse_ip_pfx(arg, NO_NETMASK, &dest);
 	if (dest.family == 0)
 		return;
 
+	if (how != -1) {
+		if ((rtdump = getrtdump(dest.family, 0, tableid)) == NULL)
+			return;
+		if ((rtree = rtree_build(rtdump, dest.family)) != NULL) {
+			ifcache_sync();
+			show_route_hdr = 1;
+			p_rtbegin();
+			if (rtree_match(rtree, &dest.addr, dest.bitlen, how,
+			    show_route_entry) == 0 && !json_output)
+				printf("%% No matching route\n");
+			p_rtend();
+			rtree_free(rtree);
+		}
+		freertdump(rtdump);
+		return;
+	}
+
 	ip_route(&dest, NULL, RTM_GET, RTF_UP, tableid, rt_metrics, 0);
 
 	/*
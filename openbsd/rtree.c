@@ -0,0 +1,330 @@
+/*
+ * rtree: path compressed binary radix (Patricia) tree over a route dump
+ *
+ * Prefix queries against a full table would otherwise compare every
+ * route in the dump.  rtree_build() indexes one getrtdump() result by
+ * destination and prefix length, and rtree_match() then visits only
+ * the nodes on the path to the query prefix and, for longer-prefixes,
+ * the subtree below it.  Nodes point into the dump, which must outlive
+ * the tree.
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include <net/if.h>
+#include <net/route.h>
+#include <netinet/in.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "externs.h"
+
+#define RTREE_KEYLEN	16	/* bytes, enough for an IPv6 address */
+
+struct rtroute {
+	struct rt_msghdr	*rtm;
+	struct rtroute		*next;
+};
+
+struct rtnode {
+	struct rtnode	*child[2];
+	struct rtroute	*routes;	/* NULL for glue nodes */
+	struct rtroute	**tail;
+	int		 plen;
+	u_int8_t	 key[RTREE_KEYLEN];
+};
+
+struct rtree {
+	struct rtnode	*root;
+	int		 af;
+	int		 maxlen;	/* address length in bits */
+};
+
+static int	rtree_key(int, struct sockaddr *, u_int8_t *);
+static int	rtree_common(const u_int8_t *, const u_int8_t *, int);
+static void	rtree_mask(u_int8_t *, int);
+static struct rtnode *rtree_node(const u_int8_t *, int);
+static struct rtnode *rtree_insert(struct rtree *, const u_int8_t *, int);
+static int	rtree_print(struct rtnode *, int, void (*)(struct rt_msghdr *));
+static void	rtree_freenode(struct rtnode *);
+
+#define BIT(key, n)	(((key)[(n) >> 3] >> (7 - ((n) & 7))) & 1)
+
+/*
+ * Copy the address bytes of sa into key.
+ */
+static int
+rtree_key(int af, struct sockaddr *sa, u_int8_t *key)
+{
+	memset(key, 0, RTREE_KEYLEN);
+
+	if (sa == NULL || sa->sa_family != af)
+		return (-1);
+
+	switch (af) {
+	case AF_INET:
+		memcpy(key, &((struct sockaddr_in *)sa)->sin_addr,
+		    sizeof(struct in_addr));
+		break;
+	case AF_INET6:
+		memcpy(key, &((struct sockaddr_in6 *)sa)->sin6_addr,
+		    sizeof(struct in6_addr));
+		break;
+	default:
+		return (-1);
+	}
+	return (0);
+}
+
+/*
+ * Number of leading bits, up to len, that a and b have in common.
+ */
+static int
+rtree_common(const u_int8_t *a, const u_int8_t *b, int len)
+{
+	int i, n = 0;
+	u_int8_t x;
+
+	for (i = 0; n < len; i++, n += 8) {
+		if ((x = a[i] ^ b[i]) == 0)
+			continue;
+		while (!(x & 0x80)) {
+			x <<= 1;
+			n++;
+		}
+		break;
+	}
+	return (n < len ? n : len);
+}
+
+/*
+ * Clear all bits of key past plen.
+ */
+static void
+rtree_mask(u_int8_t *key, int plen)
+{
+	int i = plen >> 3;
+
+	if (i >= RTREE_KEYLEN)
+		return;
+	if (plen & 7)
+		key[i++] &= 0xff << (8 - (plen & 7));
+	memset(key + i, 0, RTREE_KEYLEN - i);
+}
+
+static struct rtnode *
+rtree_node(const u_int8_t *key, int plen)
+{
+	struct rtnode *n;
+
+	if ((n = calloc(1, sizeof(*n))) == NULL) {
+		printf("%% rtree_node: calloc: %s\n", strerror(errno));
+		return (NULL);
+	}
+	memcpy(n->key, key, RTREE_KEYLEN);
+	rtree_mask(n->key, plen);
+	n->plen = plen;
+	n->tail = &n->routes;
+	return (n);
+}
+
+/*
+ * Find or create the node for key/plen.
+ */
+static struct rtnode *
+rtree_insert(struct rtree *t, const u_int8_t *key, int plen)
+{
+	struct rtnode **np, *n, *new, *glue;
+	int common;
+
+	for (np = &t->root; (n = *np) != NULL; ) {
+		common = rtree_common(n->key, key,
+		    n->plen < plen ? n->plen : plen);
+		if (common == n->plen) {
+			if (n->plen == plen)
+				return (n);
+			/* n covers key, keep going */
+			np = &n->child[BIT(key, n->plen)];
+			continue;
+		}
+
+		if ((new = rtree_node(key, plen)) == NULL)
+			return (NULL);
+		if (common == plen) {
+			/* key covers n, hang n below it */
+			new->child[BIT(n->key, plen)] = n;
+			*np = new;
+			return (new);
+		}
+		/* n and key diverge, join them with a glue node */
+		if ((glue = rtree_node(key, common)) == NULL) {
+			free(new);
+			return (NULL);
+		}
+		glue->child[BIT(n->key, common)] = n;
+		glue->child[BIT(key, common)] = new;
+		*np = glue;
+		return (new);
+	}
+
+	return (*np = rtree_node(key, plen));
+}
+
+/*
+ * Index every route of family af in rtdump.
+ */
+struct rtree *
+rtree_build(struct rtdump *rtdump, int af)
+{
+	struct rtree *t;
+	struct rt_msghdr *rtm;
+	struct sockaddr *sa, *rti_info[RTAX_MAX];
+	struct rtnode *n;
+	struct rtroute *r;
+	u_int8_t key[RTREE_KEYLEN];
+	char *next;
+	int i, plen;
+
+	if ((t = calloc(1, sizeof(*t))) == NULL) {
+		printf("%% rtree_build: calloc: %s\n", strerror(errno));
+		return (NULL);
+	}
+	t->af = af;
+	t->maxlen = (af == AF_INET6) ? 128 : 32;
+
+	for (next = rtdump->buf; next < rtdump->lim; next += rtm->rtm_msglen) {
+		rtm = (struct rt_msghdr *)next;
+		if (rtm->rtm_version != RTM_VERSION)
+			continue;
+
+		sa = (struct sockaddr *)(next + rtm->rtm_hdrlen);
+		for (i = 0; i < RTAX_MAX; i++) {
+			if (rtm->rtm_addrs & (1 << i)) {
+				rti_info[i] = sa;
+				sa = (struct sockaddr *)((char *)sa +
+				    ROUNDUP(sa->sa_len));
+			} else
+				rti_info[i] = NULL;
+		}
+		if (rtree_key(af, rti_info[RTAX_DST], key) == -1)
+			continue;
+
+		if (rtm->rtm_flags & RTF_HOST)
+			plen = t->maxlen;
+		else
+			plen = mask_prefixlen(af, rti_info[RTAX_NETMASK], NULL);
+
+		if ((n = rtree_insert(t, key, plen)) == NULL ||
+		    (r = malloc(sizeof(*r))) == NULL) {
+			if (n != NULL)
+				printf("%% rtree_build: malloc: %s\n",
+				    strerror(errno));
+			rtree_free(t);
+			return (NULL);
+		}
+		r->rtm = rtm;
+		r->next = NULL;
+		*n->tail = r;
+		n->tail = &r->next;
+	}
+
+	return (t);
+}
+
+/*
+ * Print the routes of n and, if subtree is set, of everything below it
+ * in address order.
+ */
+static int
+rtree_print(struct rtnode *n, int subtree, void (*pr)(struct rt_msghdr *))
+{
+	struct rtroute *r;
+	int count = 0;
+
+	if (n == NULL)
+		return (0);
+	for (r = n->routes; r != NULL; r = r->next, count++)
+		pr(r->rtm);
+	if (subtree) {
+		count += rtree_print(n->child[0], 1, pr);
+		count += rtree_print(n->child[1], 1, pr);
+	}
+	return (count);
+}
+
+/*
+ * Run pr on each route matching addr/plen:
+ *	RTREE_EXACT	routes for exactly this prefix
+ *	RTREE_LONGER	this prefix and all more specific ones
+ *	RTREE_BEST	the longest prefix covering addr/plen
+ * A plen of -1 means a host address.  Returns the number of routes.
+ */
+int
+rtree_match(struct rtree *t, void *addr, int plen, int how,
+    void (*pr)(struct rt_msghdr *))
+{
+	struct rtnode *n, *best = NULL;
+	u_int8_t key[RTREE_KEYLEN];
+
+	if (plen < 0 || plen > t->maxlen)
+		plen = t->maxlen;
+	memset(key, 0, sizeof(key));
+	memcpy(key, addr, t->maxlen / 8);
+	rtree_mask(key, plen);
+
+	for (n = t->root; n != NULL; n = n->child[BIT(key, n->plen)]) {
+		if (n->plen >= plen) {
+			/* at or below the query, n must lie inside it */
+			if (rtree_common(n->key, key, plen) < plen)
+				break;
+			if (n->plen == plen && n->routes != NULL)
+				best = n;
+			if (how == RTREE_LONGER)
+				return (rtree_print(n, 1, pr));
+			break;
+		}
+		if (rtree_common(n->key, key, n->plen) < n->plen)
+			break;
+		if (n->routes != NULL)
+			best = n;
+	}
+
+	switch (how) {
+	case RTREE_EXACT:
+		if (best == NULL || best->plen != plen)
+			return (0);
+		/* FALLTHROUGH */
+	case RTREE_BEST:
+		return (rtree_print(best, 0, pr));
+	}
+	return (0);
+}
+
+static void
+rtree_freenode(struct rtnode *n)
+{
+	struct rtroute *r, *rnext;
+
+	if (n == NULL)
+		return;
+	rtree_freenode(n->child[0]);
+	rtree_freenode(n->child[1]);
+	for (r = n->routes; r != NULL; r = rnext) {
+		rnext = r->next;
+		free(r);
+	}
+	free(n);
+}
+
+void
+rtree_free(struct rtree *t)
+{
+	if (t == NULL)
+		return;
+	rtree_freenode(t->root);
+	free(t);
+}
@@ -55,9 +55,9 @@
 #include <unistd.h>
 
 #include "externs.h"
+#include "json.h"
 
 char	*any_ntoa(const struct sockaddr *);
-char	*link_print(struct sockaddr *);
 
 #define PLEN  (LONG_BIT / 4 + 2)
 
@@ -70,6 +70,8 @@ struct bits {
 	int	b_mask;
 	char	b_val;
 };
+static struct json rtjson;	/* p_rtentry() in output json mode */
+
 static const struct bits bits[] = {
 	{ RTF_UP,	'U' },
 	{ RTF_GATEWAY,	'G' },
@@ -101,6 +103,9 @@ void	p_protocol(struct sadb_protocol *, struct sockaddr *, struct
 	    sadb_protocol *, int);
 void	p_sockaddr(struct sockaddr *, struct sockaddr *, int, int);
 void	p_flags(int, char *);
+static char *sockaddr_name_r(struct sockaddr *, struct sockaddr *, int,
+	    char *);
+static char *flags_str(int, char *, size_t);
 void	index_pfk(struct sadb_msg *, void **);
 
 /*
@@ -130,7 +135,9 @@ p_rttables(int af, u_int tableid, int flags)
 	rtdump = getrtdump(af, flags, tableid);
 	if (rtdump == NULL)
 		return;
+	ifcache_sync();
 
+	p_rtbegin();
 	for (next = rtdump->buf; next < rtdump->lim; next += rtm->rtm_msglen) {
 		rtm = (struct rt_msghdr *)next;
 		if (rtm->rtm_version != RTM_VERSION)
@@ -138,7 +145,7 @@ p_rttables(int af, u_int tableid, int flags)
 		sa = (struct sockaddr *)(next + rtm->rtm_hdrlen);
 		if (af != AF_UNSPEC && sa->sa_family != af)
 			continue;
-		if (next == rtdump->buf) {
+		if (next == rtdump->buf && !json_output) {
 			/* start of the loop? print headers */
 			pr_flags(sa->sa_family);
 		pr_family(sa->sa_family);
@@ -146,9 +153,11 @@ p_rttables(int af, u_int tableid, int flags)
 		}
 		p_rtentry(rtm);
 	}
+	p_rtend();
 	freertdump(rtdump);
 
-	if (af != 0 && af != PF_KEY)
+	/* encap flows have no JSON form yet */
+	if ((af != 0 && af != PF_KEY) || json_output)
 		return;
 
 	mib[0] = CTL_NET;
@@ -197,6 +206,218 @@ p_rttables(int af, u_int tableid, int flags)
 	}
 }
 
+/*
+ * Route summary: one pass over a dump, counting only.
+ */
+static const struct rtsumflag {
+	int	 flag;
+	char	*name;
+} rtsumflags[] = {
+	{ RTF_GATEWAY,	"gateway" },
+	{ RTF_HOST,	"host" },
+	{ RTF_STATIC,	"static" },
+	{ RTF_DYNAMIC,	"dynamic" },
+	{ RTF_LOCAL,	"local" },
+	{ RTF_CONNECTED, "connected" },
+	{ RTF_BROADCAST, "broadcast" },
+	{ RTF_LLINFO,	"llinfo" },
+	{ RTF_CLONED,	"cloned" },
+	{ RTF_MPATH,	"multipath" },
+	{ RTF_MPLS,	"mpls" },
+	{ RTF_REJECT,	"reject" },
+	{ RTF_BLACKHOLE, "blackhole" },
+	{ 0, NULL }
+};
+
+static const struct rtsumprio {
+	int	 prio;
+	char	*name;
+} rtsumprios[] = {
+	{ RTP_LOCAL,		"local" },
+	{ RTP_CONNECTED,	"connected" },
+	{ RTP_STATIC,		"static" },
+	{ RTP_EIGRP,		"eigrp" },
+	{ RTP_OSPF,		"ospf" },
+	{ RTP_ISIS,		"isis" },
+	{ RTP_RIP,		"rip" },
+	{ RTP_BGP,		"bgp" },
+	{ RTP_DEFAULT,		"default" },
+	{ RTP_PROPOSAL_STATIC,	"proposal static" },
+	{ RTP_PROPOSAL_DHCLIENT, "proposal dhcp" },
+	{ RTP_PROPOSAL_SLAAC,	"proposal slaac" },
+	{ RTP_PROPOSAL_UMB,	"proposal umb" },
+	{ RTP_PROPOSAL_PPP,	"proposal ppp" },
+	{ RTP_PROPOSAL_SOLICIT,	"proposal solicit" },
+	{ 0, NULL }
+};
+
+/*
+ * Rough kernel cost of one route: rtentry, its sockaddrs and the
+ * ART node and table slot pointing at it.
+ */
+#define RTSUM_ENTRYSIZE	256
+
+static int
+p_rtsummary_table(int af, u_int tableid)
+{
+	struct rtdump *rtdump;
+	struct rt_msghdr *rtm;
+	struct sockaddr *sa, *mask;
+	const struct rtsumflag *f;
+	const struct rtsumprio *p;
+	const char *ifname;
+	u_int plencount[129], priocount[RTP_MASK + 1], flagcount[32];
+	u_int *ifcount = NULL, nifcount = 0, routes = 0, down = 0, labels = 0;
+	int i, plen, maxlen = (af == AF_INET6) ? 128 : 32;
+	char *next, prio[24];
+
+	if ((rtdump = getrtdump(af, 0, tableid)) == NULL)
+		return (0);
+
+	memset(plencount, 0, sizeof(plencount));
+	memset(priocount, 0, sizeof(priocount));
+	memset(flagcount, 0, sizeof(flagcount));
+
+	for (next = rtdump->buf; next < rtdump->lim; next += rtm->rtm_msglen) {
+		rtm = (struct rt_msghdr *)next;
+		if (rtm->rtm_version != RTM_VERSION)
+			continue;
+		sa = (struct sockaddr *)(next + rtm->rtm_hdrlen);
+		if (!(rtm->rtm_addrs & RTA_DST) || sa->sa_family != af)
+			continue;
+		routes++;
+
+		if (rtm->rtm_flags & RTF_HOST)
+			plen = maxlen;
+		else {
+			mask = NULL;
+			if (rtm->rtm_addrs & RTA_NETMASK) {
+				mask = (struct sockaddr *)((char *)sa +
+				    ROUNDUP(sa->sa_len));
+				if (rtm->rtm_addrs & RTA_GATEWAY)
+					mask = (struct sockaddr *)((char *)mask
+					    + ROUNDUP(mask->sa_len));
+			}
+			plen = mask_prefixlen(af, mask, NULL);
+		}
+		if (plen >= 0 && plen <= maxlen)
+			plencount[plen]++;
+
+		priocount[rtm->rtm_priority & RTP_MASK]++;
+		if (rtm->rtm_priority & RTP_DOWN)
+			down++;
+
+		for (i = 0; i < 32; i++)
+			if (rtm->rtm_flags & (1 << i))
+				flagcount[i]++;
+		if (rtm->rtm_addrs & RTA_LABEL)
+			labels++;
+
+		if (rtm->rtm_index >= nifcount) {
+			u_int n = rtm->rtm_index + 16, *nc;
+
+			if ((nc = reallocarray(ifcount, n, sizeof(*nc))) ==
+			    NULL) {
+				printf("%% p_rtsummary: reallocarray: %s\n",
+				    strerror(errno));
+				free(ifcount);
+				freertdump(rtdump);
+				return (-1);
+			}
+			memset(nc + nifcount, 0, (n - nifcount) * sizeof(*nc));
+			ifcount = nc;
+			nifcount = n;
+		}
+		ifcount[rtm->rtm_index]++;
+	}
+
+	printf("%% %s routing table %u: %u routes", af == AF_INET6 ?
+	    "IPv6" : "IPv4", tableid, routes);
+	if (down)
+		printf(", %u down", down);
+	printf("\n");
+
+	printf("\n  %-20s %10s\n", "Prefix length", "Routes");
+	for (i = 0; i <= maxlen; i++)
+		if (plencount[i])
+			printf("  /%-19d %10u\n", i, plencount[i]);
+
+	printf("\n  %-20s %10s\n", "Interface", "Routes");
+	ifcache_sync();
+	for (i = 0; i < (int)nifcount; i++) {
+		if (ifcount[i] == 0)
+			continue;
+		if ((ifname = ifcache_name(i)) == NULL)
+			printf("  %-20d %10u\n", i, ifcount[i]);
+		else
+			printf("  %-20s %10u\n", ifname, ifcount[i]);
+	}
+
+	printf("\n  %-20s %10s\n", "Priority", "Routes");
+	for (i = 0; i <= RTP_MASK; i++) {
+		if (priocount[i] == 0)
+			continue;
+		for (p = rtsumprios; p->name != NULL; p++)
+			if (p->prio == i)
+				break;
+		if (p->name != NULL)
+			snprintf(prio, sizeof(prio), "%-3d %s", i, p->name);
+		else
+			snprintf(prio, sizeof(prio), "%d", i);
+		printf("  %-20s %10u\n", prio, priocount[i]);
+	}
+
+	printf("\n  %-20s %10s\n", "Flag", "Routes");
+	for (f = rtsumflags; f->name != NULL; f++) {
+		i = ffs(f->flag) - 1;
+		if (flagcount[i])
+			printf("  %-20s %10u\n", f->name, flagcount[i]);
+	}
+	if (labels)
+		printf("  %-20s %10u\n", "label", labels);
+
+	printf("\n  Memory: %zu KB route dump, about %llu KB in kernel\n\n",
+	    (size_t)(rtdump->lim - rtdump->buf) / 1024,
+	    (unsigned long long)routes * RTSUM_ENTRYSIZE / 1024);
+
+	free(ifcount);
+	freertdump(rtdump);
+	return (0);
+}
+
+/*
+ * Print a route summary for tableid, or for every existing table if
+ * tableid is RTABLE_ANY.
+ */
+void
+p_rtsummary(int af, u_int tableid)
+{
+	struct rt_tableinfo info;
+	size_t len;
+	int mib[6];
+	u_int t;
+
+	if (tableid != RTABLE_ANY) {
+		p_rtsummary_table(af, tableid);
+		return;
+	}
+
+	mib[0] = CTL_NET;
+	mib[1] = PF_ROUTE;
+	mib[2] = 0;
+	mib[3] = 0;
+	mib[4] = NET_RT_TABLE;
+
+	for (t = 0; t <= RT_TABLEID_MAX; t++) {
+		mib[5] = t;
+		len = sizeof(info);
+		if (sysctl(mib, 6, &info, &len, NULL, 0) == -1)
+			continue;	/* ENOENT: no such table */
+		if (p_rtsummary_table(af, t) == -1)
+			break;
+	}
+}
+
 /* 
  * column widths; each followed by one space
  * width of destination/gateway column
@@ -237,6 +458,26 @@ get_rtaddrs(int addrs, struct sockaddr *sa, struct sockaddr **rti_info)
 	}
 }
 
+/*
+ * Start and finish a list of p_rtentry() entries.  Only output json
+ * mode needs this, for the array around them.
+ */
+void
+p_rtbegin(void)
+{
+	if (!json_output)
+		return;
+	json_begin(&rtjson, stdout);
+	json_array(&rtjson, NULL);
+}
+
+void
+p_rtend(void)
+{
+	if (json_output)
+		json_end(&rtjson);
+}
+
 /*
  * Print a routing table entry.
  */
@@ -245,7 +486,8 @@ p_rtentry(struct rt_msghdr *rtm)
 {
 	struct sockaddr	*sa = (struct sockaddr *)((char *)rtm + rtm->rtm_hdrlen);
 	struct sockaddr	*mask, *rti_info[RTAX_MAX];
-	char		 ifbuf[IF_NAMESIZE];
+	const char	*ifname;
+	char		 buf[ADDRNAMELEN], fbuf[33];
 	int interesting = RTF_UP | RTF_GATEWAY | RTF_HOST | RTF_DYNAMIC |
 	    RTF_LLINFO | RTF_STATIC | RTF_REJECT | RTF_MPLS | RTF_CLONED |
 	    RTF_LOCAL;
@@ -259,6 +501,29 @@ p_rtentry(struct rt_msghdr *rtm)
 	if ((sa = rti_info[RTAX_DST]) == NULL)
 		return;
 
+	if (json_output) {
+		json_object(&rtjson, NULL);
+		json_string(&rtjson, "destination",
+		    sockaddr_name_r(sa, mask, rtm->rtm_flags, buf));
+		if (rti_info[RTAX_GATEWAY] != NULL)
+			json_string(&rtjson, "gateway",
+			    sockaddr_name_r(rti_info[RTAX_GATEWAY], NULL,
+			    RTF_HOST, buf));
+		json_string(&rtjson, "flags",
+		    flags_str(rtm->rtm_flags & interesting, fbuf,
+		    sizeof(fbuf)));
+		json_uint(&rtjson, "refs", rtm->rtm_rmx.rmx_refcnt);
+		json_uint(&rtjson, "use", rtm->rtm_rmx.rmx_pksent);
+		json_uint(&rtjson, "mtu", rtm->rtm_rmx.rmx_mtu);
+		json_bool(&rtjson, "mtu_locked",
+		    rtm->rtm_rmx.rmx_locks & RTV_MTU);
+		json_uint(&rtjson, "priority", rtm->rtm_priority);
+		json_string(&rtjson, "interface",
+		    ifcache_name(rtm->rtm_index));
+		json_end(&rtjson);
+		return;
+	}
+
 	p_sockaddr(sa, mask, rtm->rtm_flags, WID_DST(sa->sa_family));
 	p_sockaddr(rti_info[RTAX_GATEWAY], NULL, RTF_HOST,
 	    WID_GW(sa->sa_family));
@@ -270,7 +535,9 @@ p_rtentry(struct rt_msghdr *rtm)
 	else
 		printf("%6s ", "-");
 	putchar((rtm->rtm_rmx.rmx_locks & RTV_MTU) ? 'L' : ' ');
-	printf(" %.16s", if_indextoname(rtm->rtm_index, ifbuf));
+	if ((ifname = ifcache_name(rtm->rtm_index)) == NULL)
+		ifname = "?";
+	printf(" %.16s", ifname);
 	putchar('\n');
 }
 
@@ -346,13 +613,13 @@ pr_family(int af)
 void
 p_encap(struct sockaddr *sa, struct sockaddr *mask, int width)
 {
-	char 		*cp;
+	char 		*cp, buf[ADDRNAMELEN];
 	unsigned short	 port = 0;
 
 	if (mask)
-		cp = netname(sa, mask);
+		cp = netname_r(sa, mask, buf, sizeof(buf));
 	else
-		cp = routename(sa);
+		cp = routename_r(sa, buf, sizeof(buf));
 
 	switch (sa->sa_family) {
 	case AF_INET:
@@ -432,28 +699,31 @@ p_protocol(struct sadb_protocol *sap, struct sockaddr *sa, struct sadb_protocol
 	}
 }
 
-void
-p_sockaddr(struct sockaddr *sa, struct sockaddr *mask, int flags, int width)
+/*
+ * Format sa, as a network if mask applies, into buf of ADDRNAMELEN bytes
+ */
+static char *
+sockaddr_name_r(struct sockaddr *sa, struct sockaddr *mask, int flags,
+    char *buf)
 {
-	char *cp;
-
 	switch (sa->sa_family) {
 	case AF_INET6:
-	    {
-		in6_fillscopeid((struct sockaddr_in6 *)sa);
 		if (flags & RTF_HOST)
-			cp = routename(sa);
-		else
-			cp = netname(sa, mask);
-		break;
-	    }
+			return (routename_r(sa, buf, ADDRNAMELEN));
+		return (netname_r(sa, mask, buf, ADDRNAMELEN));
 	default:
 		if ((flags & RTF_HOST) || mask == NULL)
-			cp = routename(sa);
-		else
-			cp = netname(sa, mask);
-		break;
+			return (routename_r(sa, buf, ADDRNAMELEN));
+		return (netname_r(sa, mask, buf, ADDRNAMELEN));
 	}
+}
+
+void
+p_sockaddr(struct sockaddr *sa, struct sockaddr *mask, int flags, int width)
+{
+	char *cp, buf[ADDRNAMELEN];
+
+	cp = sockaddr_name_r(sa, mask, flags, buf);
 	if (width < 0)
 		printf("%s", cp);
 	else {
@@ -461,99 +731,38 @@ p_sockaddr(struct sockaddr *sa, struct sockaddr *mask, int flags, int width)
 	}
 }
 
-void
-p_flags(int f, char *format)
+static char *
+flags_str(int f, char *name, size_t len)
 {
-	char name[33], *flags;
+	char *flags;
 	const struct bits *p = bits;
 
-	for (flags = name; p->b_mask && flags < &name[sizeof(name) - 2]; p++)
+	for (flags = name; p->b_mask && flags < &name[len - 2]; p++)
 		if (p->b_mask & f)
 			*flags++ = p->b_val;
 	*flags = '\0';
-	printf(format, name);
+	return (name);
 }
 
-static char line_show[MAXHOSTNAMELEN];
-static char domain[MAXHOSTNAMELEN];
-
-char *
-routename(struct sockaddr *sa)
+void
+p_flags(int f, char *format)
 {
-	char *cp = NULL;
-	static int first = 1;
-	struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)sa;
-
-	if (first) {
-		first = 0;
-		if (gethostname(domain, sizeof(domain)) == 0 &&
-		    (cp = strchr(domain, '.')))
-			(void)strlcpy(domain, cp + 1, sizeof(domain));
-		else
-			domain[0] = '\0';
-		cp = NULL;
-	}
-
-	switch (sa->sa_family) {
-	case AF_INET:
-		if (sa->sa_len == 0)
-			return("0.0.0.0");
-		else
-			return
-			    (routename4(((struct sockaddr_in *)sa)->
-			    sin_addr.s_addr));
+	char name[33];
 
-	case AF_INET6:
-		if (sa->sa_len == sizeof(struct sockaddr_in6))
-			in6_fillscopeid(sin6);
-		return (routename6(sin6));
-
-	case AF_LINK:
-		return (link_print(sa));
+	printf(format, flags_str(f, name, sizeof(name)));
+}
 
-	case AF_UNSPEC:
-		if (sa->sa_len == sizeof(struct sockaddr_rtlabel)) {
-			static char name[RTLABEL_LEN];
-			struct sockaddr_rtlabel *sr;
+static char line_show[MAXHOSTNAMELEN];
 
-			sr = (struct sockaddr_rtlabel *)sa;
-			(void)strlcpy(name, sr->sr_label, sizeof(name));
-			return (name);
-		}
-		/* FALLTHROUGH */
-	default:
-		(void)snprintf(line_show, sizeof(line_show), "(%d) %s",
-		    sa->sa_family, any_ntoa(sa));
-		break;
-	}
-	return (line_show);
-}
+/*
+ * routename(), netname() and friends are kept for existing callers and
+ * format into the shared line_show buffer, see addrname.c.
+ */
 
-void
-in6_fillscopeid(struct sockaddr_in6 *sin6)
+char *
+routename(struct sockaddr *sa)
 {
-	if ((IN6_IS_ADDR_LINKLOCAL(&sin6->sin6_addr) ||
-	    IN6_IS_ADDR_MC_LINKLOCAL(&sin6->sin6_addr) ||
-	    IN6_IS_ADDR_MC_INTFACELOCAL(&sin6->sin6_addr)) &&
-	    sin6->sin6_scope_id == 0) {
-		sin6->sin6_scope_id =
-		    ntohs(*(u_int16_t *)&sin6->sin6_addr.s6_addr[2]);
-		sin6->sin6_addr.s6_addr[2] = sin6->sin6_addr.s6_addr[3] = 0;
-	}
-}
-
-void
-in6_clearscopeid(struct sockaddr_in6 *sin6)
-{
-	if ((IN6_IS_ADDR_LINKLOCAL(&sin6->sin6_addr) ||
-	    IN6_IS_ADDR_MC_LINKLOCAL(&sin6->sin6_addr) ||
-	    IN6_IS_ADDR_MC_INTFACELOCAL(&sin6->sin6_addr)) &&
-	    *(u_int16_t *)&sin6->sin6_addr.s6_addr[2] == 0 &&
-	    sin6->sin6_scope_id) {
-		*(u_int16_t *)&sin6->sin6_addr.s6_addr[2] =
-		    htons(sin6->sin6_scope_id & 0xffff);
-		sin6->sin6_scope_id = 0;
-	}
+	return (routename_r(sa, line_show, sizeof(line_show)));
 }
 
 char *
@@ -562,7 +771,8 @@ routename4(in_addr_t in)
 	struct in_addr	 ina;
 
 	ina.s_addr = in;
-	strlcpy(line_show, inet_ntoa(ina), sizeof(line_show));
+	if (inet_ntop(AF_INET, &ina, line_show, sizeof(line_show)) == NULL)
+		line_show[0] = '\0';
 
 	return (line_show);
 }
@@ -570,11 +780,7 @@ routename4(in_addr_t in)
 char *
 routename6(struct sockaddr_in6 *sin6)
 {
-	if (getnameinfo((struct sockaddr *)sin6, sin6->sin6_len,
-	    line_show, sizeof(line_show), NULL, 0, NI_NUMERICHOST) != 0)
-		strncpy(line_show, "", sizeof(line_show));
-
-	return (line_show);
+	return (inet6_ntop_r(sin6, line_show, sizeof(line_show)));
 }
 
 /*
@@ -584,104 +790,22 @@ routename6(struct sockaddr_in6 *sin6)
 char *
 netname4(in_addr_t in, struct sockaddr_in *maskp)
 {
-	in_addr_t mask;
-	int mbits;
-
-	if (maskp->sin_len == 0) {
-		/*
-		 * annoying.  why can't the kernel just tell the truth?
-		 */
-		maskp->sin_addr.s_addr = 0;
-	}
-	in = ntohl(in);
-	mask = maskp ? ntohl(maskp->sin_addr.s_addr) : 0;
-	mbits = mask ? 33 - ffs(mask) : 0;
-#define C(x)	((x) & 0xff)
-	snprintf(line_show, sizeof(line_show), "%u.%u.%u.%u/%d", C(in >> 24),
-	    C(in >> 16), C(in >> 8), C(in), mbits);
-#undef C
-	return (line_show);
+	struct sockaddr_in sin;
+
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_len = sizeof(sin);
+	sin.sin_family = AF_INET;
+	sin.sin_addr.s_addr = in;
+
+	return (netname_r((struct sockaddr *)&sin, (struct sockaddr *)maskp,
+	    line_show, sizeof(line_show)));
 }
 
 char *
 netname6(struct sockaddr_in6 *sa6, struct sockaddr_in6 *mask)
 {
-	struct sockaddr_in6 sin6;
-	u_char *p;
-	int masklen, final = 0, illegal = 0;
-	int i, lim, error;
-	char hbuf[NI_MAXHOST];
-
-	sin6 = *sa6;
-
-	masklen = 0;
-	if (mask) {
-		lim = mask->sin6_len - offsetof(struct sockaddr_in6, sin6_addr);
-		lim = lim < (int)sizeof(struct in6_addr) ?
-		    lim : (int)sizeof(struct in6_addr);
-		for (p = (u_char *)&mask->sin6_addr, i = 0; i < lim; p++) {
-			if (final && *p) {
-				illegal++;
-				continue;
-			}
-
-			switch (*p & 0xff) {
-			case 0xff:
-				masklen += 8;
-				break;
-			case 0xfe:
-				masklen += 7;
-				final++;
-				break;
-			case 0xfc:
-				masklen += 6;
-				final++;
-				break;
-			case 0xf8:
-				masklen += 5;
-				final++;
-				break;
-			case 0xf0:
-				masklen += 4;
-				final++;
-				break;
-			case 0xe0:
-				masklen += 3;
-				final++;
-				break;
-			case 0xc0:
-				masklen += 2;
-				final++;
-				break;
-			case 0x80:
-				masklen += 1;
-				final++;
-				break;
-			case 0x00:
-				final++;
-				break;
-			default:
-				final++;
-				illegal++;
-				break;
-			}
-
-			i++;
-		}
-	} else
-		masklen = 128;
-
-	/* This will warn us if the kernel supplies an insane mask */
-	if (illegal)
-		printf("%% netname6: illegal prefixlen\n");
-
-	error = getnameinfo((struct sockaddr *)&sin6, sin6.sin6_len,
-	    hbuf, sizeof(hbuf), NULL, 0, NI_NUMERICHOST);
-	if (error)
-		hbuf[0] = '\0';
-
-	snprintf(line_show, sizeof(line_show), "%s/%d", hbuf, masklen);
-	return (line_show);
+	return (netname_r((struct sockaddr *)sa6, (struct sockaddr *)mask,
+	    line_show, sizeof(line_show)));
 }
 
 /*
@@ -691,42 +815,7 @@ netname6(struct sockaddr_in6 *sa6, struct sockaddr_in6 *mask)
 char *
 netname(struct sockaddr *sa, struct sockaddr *mask)
 {
-	switch (sa->sa_family) {
-
-	case AF_INET:
-		return netname4(((struct sockaddr_in *)sa)->sin_addr.s_addr,
-		    (struct sockaddr_in *)mask);
-	case AF_INET6:
-		return netname6((struct sockaddr_in6 *)sa,
-		    (struct sockaddr_in6 *)mask);
-	case AF_LINK:
-		return (link_print(sa));
-	default:
-		snprintf(line_show, sizeof(line_show), "af %d: %s",
-		    sa->sa_family, any_ntoa(sa));
-		break;
-	}
-	return (line_show);
-}
-
-static const char hexlist[] = "0123456789abcdef";
-
-char *
-any_ntoa(const struct sockaddr *sa)
-{
-	static char obuf[240];
-	const char *in = sa->sa_data;
-	char *out = obuf;
-	int len = sa->sa_len - offsetof(struct sockaddr, sa_data);
-
-	*out++ = 'Q';
-	do {
-		*out++ = hexlist[(*in >> 4) & 15];
-		*out++ = hexlist[(*in++)    & 15];
-		*out++ = '.';
-	} while (--len > 0 && (out + 3) < &obuf[sizeof(obuf) - 1]);
-	out[-1] = '\0';
-	return (obuf);
+	return (netname_r(sa, mask, line_show, sizeof(line_show)));
 }
 
 char *
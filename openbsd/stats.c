@@ -37,7 +37,9 @@
 #include <sys/protosw.h>
 #include <sys/sysctl.h>
 #include <sys/pool.h>
+#include <sys/time.h>
 #include <errno.h>
+#include <time.h>
 
 #include <net/route.h>
 #include <netinet/in.h>
@@ -76,6 +78,8 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include "externs.h"
+#include "json.h"
+#include "prom.h"
 
 static int sflag = 1;
 
@@ -88,6 +92,158 @@ struct kinfo_pool mbpool, mclpool;
 char	*inet6name(struct in6_addr *);
 void	inet6print(struct in6_addr *, int, char *, int);
 
+static int	stats_begin(const char *, void *, void *, size_t,
+		    struct timespec *);
+static void	stats_value(const char *, u_int64_t, u_int64_t);
+static void	stats_end(void);
+
+static int statsmode = STATS_SHOW;
+static int statsraw;		/* counters go to stats_value() */
+static struct json statjson;	/* output json mode */
+static struct prom *statprom;	/* exporter */
+
+/*
+ * The protocol being shown, its copy from the previous snapshot and
+ * when that was taken, for stats_end() to move the snapshot on.
+ */
+static void *statcur, *statlast;
+static size_t statlen;
+static struct timespec *statwhen, statnow;
+static double statelapsed;
+static int statchanged;
+
+/*
+ * A counter, by its field name, for JSON or delta output.  Each stats
+ * function keeps its previous snapshot in a static struct named last.
+ */
+#define	pv(s, f)	stats_value(#f, (s).f, last.f)
+
+/*
+ * Run one of the stats functions below in mode: STATS_SHOW prints the
+ * counters, STATS_DELTA prints those which changed since the previous
+ * snapshot and STATS_MARK takes a snapshot quietly.
+ */
+void
+stats_run(void (*handler)(void), int mode)
+{
+	statsmode = mode;
+	(*handler)();
+	statsmode = STATS_SHOW;
+}
+
+/*
+ * Write the counters of handler into prom for the exporter, whatever
+ * the output mode.
+ */
+void
+stats_export(void (*handler)(void), struct prom *prom)
+{
+	statprom = prom;
+	stats_run(handler, STATS_EXPORT);
+	statprom = NULL;
+}
+
+/*
+ * Start the counters of one protocol, just read into cur: a heading, or
+ * in output json mode an object with a member for every counter, zero
+ * or not.  last and when are the function's snapshot.  Returns 1 when
+ * there is nothing to print.
+ */
+static int
+stats_begin(const char *name, void *cur, void *last, size_t len,
+    struct timespec *when)
+{
+	struct timespec elapsed;
+
+	statcur = cur;
+	statlast = last;
+	statlen = len;
+	statwhen = when;
+	clock_gettime(CLOCK_MONOTONIC, &statnow);
+
+	switch (statsmode) {
+	case STATS_EXPORT:
+		statsraw = 1;
+		return (0);
+	case STATS_MARK:
+		memcpy(last, cur, len);
+		*when = statnow;
+		return (1);
+	case STATS_DELTA:
+		if (!timespecisset(when)) {
+			memcpy(last, cur, len);
+			*when = statnow;
+			printf("%% %s: snapshot taken, changes are shown from "
+			    "now on\n", name);
+			return (1);
+		}
+		timespecsub(&statnow, when, &elapsed);
+		statelapsed = elapsed.tv_sec + elapsed.tv_nsec / 1e9;
+		statchanged = 0;
+		statsraw = 1;
+		if (json_output) {
+			json_begin(&statjson, stdout);
+			json_object(&statjson, NULL);
+			json_uint(&statjson, "elapsed_ms",
+			    elapsed.tv_sec * 1000 + elapsed.tv_nsec / 1000000);
+		} else
+			printf("%% %s: changes in %.1f seconds\n", name,
+			    statelapsed);
+		return (0);
+	}
+
+	statsraw = json_output;
+	if (json_output) {
+		json_begin(&statjson, stdout);
+		json_object(&statjson, NULL);
+	} else
+		printf("%% %s:\n", name);
+	return (0);
+}
+
+static void
+stats_value(const char *name, u_int64_t cur, u_int64_t last)
+{
+	u_int64_t delta;
+	char metric[PROM_NAMELEN];
+
+	if (statsmode == STATS_EXPORT) {
+		snprintf(metric, sizeof(metric), "nsh_%s_total", name);
+		prom_family(statprom, metric, "counter", NULL);
+		prom_sample(statprom, cur, NULL);
+		return;
+	}
+	if (statsmode != STATS_DELTA) {
+		json_uint(&statjson, name, cur);
+		return;
+	}
+	if (cur == last)
+		return;
+	/* a counter which went backwards was reset */
+	delta = cur > last ? cur - last : cur;
+	statchanged++;
+	if (json_output)
+		json_uint(&statjson, name, delta);
+	else
+		printf("\t%-32s %12llu %12.1f/s\n", name,
+		    (unsigned long long)delta,
+		    statelapsed > 0 ? delta / statelapsed : 0);
+}
+
+static void
+stats_end(void)
+{
+	if (statsmode == STATS_DELTA) {
+		if (statchanged == 0 && !json_output)
+			printf("\tno counters changed\n");
+		memcpy(statlast, statcur, statlen);
+		*statwhen = statnow;
+	}
+	if (json_output && statsmode != STATS_EXPORT)
+		json_end(&statjson);
+	statsraw = 0;
+}
+
 /*
  * Dump TCP statistics structure.
  */
@@ -95,6 +251,8 @@ void
 tcp_stats()
 {
 	struct tcpstat tcpstat;
+	static struct tcpstat last;
+	static struct timespec when;
 	int mib[] = { CTL_NET, AF_INET, IPPROTO_TCP, TCPCTL_STATS };
 	size_t len = sizeof(tcpstat);
 
@@ -104,17 +262,25 @@ tcp_stats()
 		return;
 	}
 
-	printf ("%% tcp:\n");
+	if (stats_begin("tcp", &tcpstat, &last, sizeof(last), &when))
+		return;
 
-#define	p(f, m) if (tcpstat.f || sflag <= 1) \
+#define	p(f, m) if (statsraw) pv(tcpstat, f); \
+    else if (tcpstat.f || sflag <= 1) \
     printf(m, tcpstat.f, plural(tcpstat.f))
-#define	p1(f, m) if (tcpstat.f || sflag <= 1) \
+#define	p1(f, m) if (statsraw) pv(tcpstat, f); \
+    else if (tcpstat.f || sflag <= 1) \
     printf(m, tcpstat.f)
-#define	p2(f1, f2, m) if (tcpstat.f1 || tcpstat.f2 || sflag <= 1) \
+#define	p2(f1, f2, m) if (statsraw) { \
+    pv(tcpstat, f1); pv(tcpstat, f2); } \
+    else if (tcpstat.f1 || tcpstat.f2 || sflag <= 1) \
     printf(m, tcpstat.f1, plural(tcpstat.f1), tcpstat.f2, plural(tcpstat.f2))
-#define	p2a(f1, f2, m) if (tcpstat.f1 || tcpstat.f2 || sflag <= 1) \
+#define	p2a(f1, f2, m) if (statsraw) { \
+    pv(tcpstat, f1); pv(tcpstat, f2); } \
+    else if (tcpstat.f1 || tcpstat.f2 || sflag <= 1) \
     printf(m, tcpstat.f1, plural(tcpstat.f1), tcpstat.f2)
-#define	p3(f, m) if (tcpstat.f || sflag <= 1) \
+#define	p3(f, m) if (statsraw) pv(tcpstat, f); \
+    else if (tcpstat.f || sflag <= 1) \
     printf(m, tcpstat.f, plurales(tcpstat.f))
 
 	p(tcps_sndtotal, "\t%u packet%s sent\n");
@@ -211,6 +377,7 @@ tcp_stats()
 	    "\t%qd SACK option%s received\n");
 	p(tcps_sack_snd_opts, "\t%qd SACK option%s sent\n");
 
+	stats_end();
 #undef p
 #undef p1
 #undef p2
@@ -225,6 +392,8 @@ void
 udp_stats()
 {
 	struct udpstat udpstat;
+	static struct udpstat last;
+	static struct timespec when;
 	u_long delivered;
 	int mib[] = { CTL_NET, AF_INET, IPPROTO_UDP, UDPCTL_STATS };
 	size_t len = sizeof(udpstat);
@@ -235,10 +404,13 @@ udp_stats()
 		return;
 	}
 
-	printf("%% udp:\n");
-#define	p(f, m) if (udpstat.f || sflag <= 1) \
+	if (stats_begin("udp", &udpstat, &last, sizeof(last), &when))
+		return;
+#define	p(f, m) if (statsraw) pv(udpstat, f); \
+    else if (udpstat.f || sflag <= 1) \
     printf(m, udpstat.f, plural(udpstat.f))
-#define	p1(f, m) if (udpstat.f || sflag <= 1) \
+#define	p1(f, m) if (statsraw) pv(udpstat, f); \
+    else if (udpstat.f || sflag <= 1) \
     printf(m, udpstat.f)
 	p(udps_ipackets, "\t%lu datagram%s received\n");
 	p1(udps_hdrops, "\t%lu with incomplete header\n");
@@ -258,10 +430,11 @@ udp_stats()
 		    udpstat.udps_noport -
 		    udpstat.udps_noportbcast -
 		    udpstat.udps_fullsock;
-	if (delivered || sflag <= 1)
+	if (!statsraw && (delivered || sflag <= 1))
 		printf("\t%lu delivered\n", delivered);
 	p(udps_opackets, "\t%lu datagram%s output\n");
 	p1(udps_pcbhashmiss, "\t%lu missed PCB cache\n");
+	stats_end();
 #undef p
 #undef p1
 }
@@ -273,6 +446,8 @@ void
 ip_stats()
 {
 	struct ipstat ipstat;
+	static struct ipstat last;
+	static struct timespec when;
 	int mib[] = { CTL_NET, AF_INET, IPPROTO_IP, IPCTL_STATS };
 	size_t len = sizeof(ipstat);
 
@@ -282,11 +457,14 @@ ip_stats()
 		return;
 	}
 
-	printf("%% ip:\n");
+	if (stats_begin("ip", &ipstat, &last, sizeof(last), &when))
+		return;
 
-#define	p(f, m) if (ipstat.f || sflag <= 1) \
+#define	p(f, m) if (statsraw) pv(ipstat, f); \
+    else if (ipstat.f || sflag <= 1) \
     printf(m, ipstat.f, plural(ipstat.f))
-#define	p1(f, m) if (ipstat.f || sflag <= 1) \
+#define	p1(f, m) if (statsraw) pv(ipstat, f); \
+    else if (ipstat.f || sflag <= 1) \
     printf(m, ipstat.f)
 
 	p(ips_total, "\t%lu total packet%s received\n");
@@ -321,6 +499,7 @@ ip_stats()
 	p(ips_inswcsum, "\t%lu input datagram%s software-checksummed\n");
 	p(ips_outswcsum, "\t%lu output datagram%s software-checksummed\n");
 	p(ips_notmember, "\t%lu multicast packet%s which we don't join\n");
+	stats_end();
 #undef p
 #undef p1
 }
@@ -376,6 +555,8 @@ void
 icmp_stats()
 {
 	struct icmpstat icmpstat;
+	static struct icmpstat last;
+	static struct timespec when;
 	int i, first;
 	int mib[] = { CTL_NET, AF_INET, IPPROTO_ICMP, ICMPCTL_STATS };
 	size_t len = sizeof(icmpstat);
@@ -386,16 +567,18 @@ icmp_stats()
 		return;
 	}
 
-	printf("%% icmp:\n");
+	if (stats_begin("icmp", &icmpstat, &last, sizeof(last), &when))
+		return;
 
-#define	p(f, m) if (icmpstat.f || sflag <= 1) \
+#define	p(f, m) if (statsraw) pv(icmpstat, f); \
+    else if (icmpstat.f || sflag <= 1) \
     printf(m, icmpstat.f, plural(icmpstat.f))
 
 	p(icps_error, "\t%lu call%s to icmp_error\n");
 	p(icps_oldicmp,
 	    "\t%lu error%s not generated because old message was icmp\n");
 	for (first = 1, i = 0; i < ICMP_MAXTYPE + 1; i++)
-		if (icmpstat.icps_outhist[i] != 0) {
+		if (icmpstat.icps_outhist[i] != 0 && !statsraw) {
 			if (first) {
 				printf("\tOutput packet histogram:\n");
 				first = 0;
@@ -411,7 +594,7 @@ icmp_stats()
 	p(icps_checksum, "\t%lu bad checksum%s\n");
 	p(icps_badlen, "\t%lu message%s with bad length\n");
 	for (first = 1, i = 0; i < ICMP_MAXTYPE + 1; i++)
-		if (icmpstat.icps_inhist[i] != 0) {
+		if (icmpstat.icps_inhist[i] != 0 && !statsraw) {
 			if (first) {
 				printf("\tInput packet histogram:\n");
 				first = 0;
@@ -423,6 +606,18 @@ icmp_stats()
 			printf(" %lu\n", icmpstat.icps_inhist[i]);
 		}
 	p(icps_reflect, "\t%lu message response%s generated\n");
+	if (json_output && statsmode == STATS_SHOW) {
+		/* histograms are indexed by ICMP type */
+		json_array(&statjson, "icps_outhist");
+		for (i = 0; i < ICMP_MAXTYPE + 1; i++)
+			json_uint(&statjson, NULL, icmpstat.icps_outhist[i]);
+		json_end(&statjson);
+		json_array(&statjson, "icps_inhist");
+		for (i = 0; i < ICMP_MAXTYPE + 1; i++)
+			json_uint(&statjson, NULL, icmpstat.icps_inhist[i]);
+		json_end(&statjson);
+	}
+	stats_end();
 #undef p
 }
 
@@ -433,6 +628,8 @@ void
 igmp_stats()
 {
 	struct igmpstat igmpstat;
+	static struct igmpstat last;
+	static struct timespec when;
 	int mib[] = { CTL_NET, AF_INET, IPPROTO_IGMP, IGMPCTL_STATS };
 	size_t len = sizeof(igmpstat);
 
@@ -442,11 +639,14 @@ igmp_stats()
 		return;
 	}
 
-	printf("%% igmp:\n");
+	if (stats_begin("igmp", &igmpstat, &last, sizeof(last), &when))
+		return;
 
-#define	p(f, m) if (igmpstat.f || sflag <= 1) \
+#define	p(f, m) if (statsraw) pv(igmpstat, f); \
+    else if (igmpstat.f || sflag <= 1) \
     printf(m, igmpstat.f, plural(igmpstat.f))
-#define	py(f, m) if (igmpstat.f || sflag <= 1) \
+#define	py(f, m) if (statsraw) pv(igmpstat, f); \
+    else if (igmpstat.f || sflag <= 1) \
     printf(m, igmpstat.f, igmpstat.f != 1 ? "ies" : "y")
 	p(igps_rcv_total, "\t%lu message%s received\n");
 	p(igps_rcv_tooshort, "\t%lu message%s received with too few bytes\n");
@@ -457,6 +657,7 @@ igmp_stats()
 	p(igps_rcv_badreports, "\t%lu membership report%s received with invalid field(s)\n");
 	p(igps_rcv_ourreports, "\t%lu membership report%s received for groups to which we belong\n");
 	p(igps_snd_reports, "\t%lu membership report%s sent\n");
+	stats_end();
 #undef p
 #undef py
 }
@@ -468,6 +669,8 @@ void
 ah_stats()
 {
 	struct ahstat ahstat;
+	static struct ahstat last;
+	static struct timespec when;
 	int mib[] = { CTL_NET, AF_INET, IPPROTO_AH, AHCTL_STATS };
 	size_t len = sizeof(ahstat);
 
@@ -477,11 +680,14 @@ ah_stats()
                 return;
         }
 
-	printf("%% ah:\n");
+	if (stats_begin("ah", &ahstat, &last, sizeof(last), &when))
+		return;
 
-#define p(f, m) if (ahstat.f || sflag <= 1) \
+#define p(f, m) if (statsraw) pv(ahstat, f); \
+    else if (ahstat.f || sflag <= 1) \
     printf(m, ahstat.f, plural(ahstat.f))
-#define p1(f, m) if (ahstat.f || sflag <= 1) \
+#define p1(f, m) if (statsraw) pv(ahstat, f); \
+    else if (ahstat.f || sflag <= 1) \
     printf(m, ahstat.f)
 
 	p1(ahs_input, "\t%llu input AH packets\n");
@@ -503,6 +709,7 @@ ah_stats()
 	p(ahs_ibytes, "\t%qu input byte%s\n");
 	p(ahs_obytes, "\t%qu output byte%s\n");
 
+	stats_end();
 #undef p
 #undef p1
 }
@@ -514,6 +721,8 @@ void
 esp_stats()
 {
 	struct espstat espstat;
+	static struct espstat last;
+	static struct timespec when;
 	int mib[] = { CTL_NET, AF_INET, IPPROTO_ESP, ESPCTL_STATS };
 	size_t len = sizeof(espstat);
 
@@ -523,9 +732,11 @@ esp_stats()
 		return;
 	}
 
-	printf("%% esp:\n");
+	if (stats_begin("esp", &espstat, &last, sizeof(last), &when))
+		return;
 
-#define p(f, m) if (espstat.f || sflag <= 1) \
+#define p(f, m) if (statsraw) pv(espstat, f); \
+    else if (espstat.f || sflag <= 1) \
     printf(m, espstat.f, plural(espstat.f))
 
 	p(esps_input, "\t%llu input ESP packet%s\n");
@@ -551,6 +762,7 @@ esp_stats()
 	p(esps_ibytes, "\t%qu input byte%s\n");
 	p(esps_obytes, "\t%qu output byte%s\n");
 
+	stats_end();
 #undef p
 }
 
@@ -561,6 +773,8 @@ void
 ipip_stats()
 {
 	struct ipipstat ipipstat;
+	static struct ipipstat last;
+	static struct timespec when;
 	int mib[] = { CTL_NET, AF_INET, IPPROTO_IPIP, IPIPCTL_STATS };
 	size_t len = sizeof(ipipstat);
 
@@ -570,9 +784,11 @@ ipip_stats()
 		return;
 	}
 	
-	printf("%% ipip:\n");
+	if (stats_begin("ipip", &ipipstat, &last, sizeof(last), &when))
+		return;
 
-#define p(f, m) if (ipipstat.f || sflag <= 1) \
+#define p(f, m) if (statsraw) pv(ipipstat, f); \
+    else if (ipipstat.f || sflag <= 1) \
     printf(m, ipipstat.f, plural(ipipstat.f))
 
 	p(ipips_ipackets, "\t%llu total input packet%s\n");
@@ -585,6 +801,7 @@ ipip_stats()
 	p(ipips_obytes, "\t%qu output byte%s\n");
 	p(ipips_family, "\t%llu protocol family mismatche%s\n");
 	p(ipips_unspec, "\t%llu attempts to use tunnel with unspecified endpoint%s\n");
+	stats_end();
 #undef p
 }
 
@@ -595,6 +812,8 @@ void
 carp_stats()
 {
 	struct carpstats carpstat;
+	static struct carpstats last;
+	static struct timespec when;
 	int mib[] = { CTL_NET, AF_INET, IPPROTO_CARP, CARPCTL_STATS };
 	size_t len = sizeof(carpstat);
 
@@ -604,10 +823,13 @@ carp_stats()
 		return;
 	}
 
-	printf("%% carp:\n");
-#define p(f, m) if (carpstat.f || sflag <= 1) \
+	if (stats_begin("carp", &carpstat, &last, sizeof(last), &when))
+		return;
+#define p(f, m) if (statsraw) pv(carpstat, f); \
+	else if (carpstat.f || sflag <= 1) \
 	printf(m, carpstat.f, plural(carpstat.f))
-#define p2(f, m) if (carpstat.f || sflag <= 1) \
+#define p2(f, m) if (statsraw) pv(carpstat, f); \
+	else if (carpstat.f || sflag <= 1) \
 	printf(m, carpstat.f)
 
 	p(carps_ipackets, "\t%llu packet%s received (IPv4)\n");
@@ -625,6 +847,7 @@ carp_stats()
 	p(carps_opackets6, "\t%llu packet%s sent (IPv6)\n");
 	p2(carps_onomem, "\t\t%llu send failed due to mbuf memory error\n");
 	p(carps_preempt, "\t%llu transition%s to master\n");
+	stats_end();
 #undef p
 #undef p2
 }
@@ -636,6 +859,8 @@ void
 pfsync_stats()
 {
 	struct pfsyncstats pfsyncstat;
+	static struct pfsyncstats last;
+	static struct timespec when;
 	int mib[] = { CTL_NET, AF_INET, IPPROTO_PFSYNC, PFSYNCCTL_STATS };
 	size_t len = sizeof(pfsyncstat);
 
@@ -645,10 +870,13 @@ pfsync_stats()
 		return;
 	}
 
-	printf("%% pfsync:\n");
-#define p(f, m) if (pfsyncstat.f || sflag <= 1) \
+	if (stats_begin("pfsync", &pfsyncstat, &last, sizeof(last), &when))
+		return;
+#define p(f, m) if (statsraw) pv(pfsyncstat, f); \
+	else if (pfsyncstat.f || sflag <= 1) \
 	printf(m, pfsyncstat.f, plural(pfsyncstat.f))
-#define p2(f, m) if (pfsyncstat.f || sflag <= 1) \
+#define p2(f, m) if (statsraw) pv(pfsyncstat, f); \
+	else if (pfsyncstat.f || sflag <= 1) \
 	printf(m, pfsyncstat.f)
 	p(pfsyncs_ipackets, "\t%llu packet%s received (IPv4)\n");
 	p(pfsyncs_ipackets6, "\t%llu packet%s received (IPv6)\n");
@@ -666,6 +894,7 @@ pfsync_stats()
 	p(pfsyncs_opackets6, "\t%llu packet%s sent (IPv6)\n");
 	p2(pfsyncs_onomem, "\t\t%llu send failed due to mbuf memory error\n");
 	p2(pfsyncs_oerrors, "\t\t%llu send error\n");
+	stats_end();
 #undef p
 #undef p2
 }
@@ -677,6 +906,8 @@ void
 ipcomp_stats()
 {
 	struct ipcompstat ipcompstat;
+	static struct ipcompstat last;
+	static struct timespec when;
 	int mib[] = { CTL_NET, AF_INET, IPPROTO_IPCOMP, IPCOMPCTL_STATS };
 	size_t len = sizeof(ipcompstat);
 
@@ -686,9 +917,11 @@ ipcomp_stats()
 		return;
 	}
 
-	printf("%% ipcomp:\n");
+	if (stats_begin("ipcomp", &ipcompstat, &last, sizeof(last), &when))
+		return;
 
-#define p(f, m) if (ipcompstat.f || sflag <= 1) \
+#define p(f, m) if (statsraw) pv(ipcompstat, f); \
+    else if (ipcompstat.f || sflag <= 1) \
     printf(m, ipcompstat.f, plural(ipcompstat.f))
 
 	p(ipcomps_input, "\t%llu input IPCOMP packet%s\n");
@@ -708,6 +941,7 @@ ipcomp_stats()
 	p(ipcomps_ibytes, "\t%qu input byte%s\n");
 	p(ipcomps_obytes, "\t%qu output byte%s\n");
 
+	stats_end();
 #undef p
 }
 
@@ -718,6 +952,8 @@ void
 rt_stats()
 {
 	struct rtstat rtstat;
+	static struct rtstat last;
+	static struct timespec when;
  	int mib[] = { CTL_NET, PF_ROUTE, 0, 0, NET_RT_STATS, 0 };
  	size_t size = sizeof (rtstat);
  
@@ -726,17 +962,17 @@ rt_stats()
 		return;
 	}
  
-	printf("%% routing:\n");
-	printf("\t%u bad routing redirect%s\n",
-	    rtstat.rts_badredirect, plural(rtstat.rts_badredirect));   
-	printf("\t%u dynamically created route%s\n",
-	    rtstat.rts_dynamic, plural(rtstat.rts_dynamic));
-	printf("\t%u new gateway%s due to redirects\n",
-	    rtstat.rts_newgateway, plural(rtstat.rts_newgateway));
-	printf("\t%u destination%s found unreachable\n",
-	    rtstat.rts_unreach, plural(rtstat.rts_unreach));
-	printf("\t%u use%s of a wildcard route\n",
-	    rtstat.rts_wildcard, plural(rtstat.rts_wildcard));
+	if (stats_begin("routing", &rtstat, &last, sizeof(last), &when))
+		return;
+#define	p(f, m) if (statsraw) pv(rtstat, f); \
+    else printf(m, rtstat.f, plural(rtstat.f))
+	p(rts_badredirect, "\t%u bad routing redirect%s\n");
+	p(rts_dynamic, "\t%u dynamically created route%s\n");
+	p(rts_newgateway, "\t%u new gateway%s due to redirects\n");
+	p(rts_unreach, "\t%u destination%s found unreachable\n");
+	p(rts_wildcard, "\t%u use%s of a wildcard route\n");
+	stats_end();
+#undef p
 }
 
 char *
@@ -848,6 +1084,61 @@ mbpr(void)
 	totmbufs = 0;
 	for (mp = mbtypes; mp->mt_name; mp++)
 		totmbufs += mbstat.m_mtypes[mp->mt_type];
+	totmem = (mbpool.pr_npages * page_size) +
+	    (mclpool.pr_npages * page_size);
+	totused = mbpool.pr_nout * mbpool.pr_size +
+	    mclpool.pr_nout * mclpool.pr_size;
+	totpct = (totmem == 0)? 0 : ((totused * 100)/totmem);
+
+	if (statsmode == STATS_EXPORT) {
+		prom_family(statprom, "nsh_mbufs", "gauge", "mbufs in use");
+		prom_sample(statprom, totmbufs, NULL);
+		prom_family(statprom, "nsh_mbuf_clusters", "gauge",
+		    "mbuf clusters in use");
+		prom_sample(statprom, mclpool.pr_nout, NULL);
+		prom_family(statprom, "nsh_mbuf_clusters_max", "gauge", NULL);
+		prom_sample(statprom,
+		    mclpool.pr_maxpages * mclpool.pr_itemsperpage, NULL);
+		prom_family(statprom, "nsh_mbuf_bytes", "gauge",
+		    "memory allocated to network");
+		prom_sample(statprom, totmem, NULL);
+		prom_family(statprom, "nsh_mbuf_bytes_used", "gauge", NULL);
+		prom_sample(statprom, totused, NULL);
+		prom_family(statprom, "nsh_mbuf_drops_total", "counter",
+		    "requests for memory denied");
+		prom_sample(statprom, mbstat.m_drops, NULL);
+		prom_family(statprom, "nsh_mbuf_wait_total", "counter",
+		    "requests for memory delayed");
+		prom_sample(statprom, mbstat.m_wait, NULL);
+		prom_family(statprom, "nsh_mbuf_drain_total", "counter",
+		    "calls to protocol drain routines");
+		prom_sample(statprom, mbstat.m_drain, NULL);
+		return;
+	}
+
+	if (json_output) {
+		json_begin(&statjson, stdout);
+		json_object(&statjson, NULL);
+		json_uint(&statjson, "mbufs", totmbufs);
+		/* mbufs by type, indexed by MT_* */
+		json_array(&statjson, "m_mtypes");
+		for (i = 0; i < nmbtypes; i++)
+			json_uint(&statjson, NULL, mbstat.m_mtypes[i]);
+		json_end(&statjson);
+		json_uint(&statjson, "clusters", mclpool.pr_nout);
+		json_uint(&statjson, "clusters_peak",
+		    mclpool.pr_hiwat * mclpool.pr_itemsperpage);
+		json_uint(&statjson, "clusters_max",
+		    mclpool.pr_maxpages * mclpool.pr_itemsperpage);
+		json_uint(&statjson, "kbytes", totmem / 1024);
+		json_uint(&statjson, "kbytes_used", totused / 1024);
+		json_uint(&statjson, "m_drops", mbstat.m_drops);
+		json_uint(&statjson, "m_wait", mbstat.m_wait);
+		json_uint(&statjson, "m_drain", mbstat.m_drain);
+		json_end(&statjson);
+		return;
+	}
+
 	printf("\t%d mbuf%s in use:\n", totmbufs, plural(totmbufs));
 	for (mp = mbtypes; mp->mt_name; mp++)
 		if (mbstat.m_mtypes[mp->mt_type]) {
@@ -868,11 +1159,6 @@ mbpr(void)
 	    (u_long)(mclpool.pr_nout),
 	    (u_long)(mclpool.pr_hiwat * mclpool.pr_itemsperpage),
 	    (u_long)(mclpool.pr_maxpages * mclpool.pr_itemsperpage));
-	totmem = (mbpool.pr_npages * page_size) +
-	    (mclpool.pr_npages * page_size);
-	totused = mbpool.pr_nout * mbpool.pr_size +
-	    mclpool.pr_nout * mclpool.pr_size;
-	totpct = (totmem == 0)? 0 : ((totused * 100)/totmem);
 	printf("\t%d Kbytes allocated to network (%d%% in use)\n",
 	    totmem / 1024, totpct);
 	printf("\t%lu requests for memory denied\n", mbstat.m_drops);
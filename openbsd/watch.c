@@ -0,0 +1,384 @@
+/*
+ * watch: redraw the output of a counter producing command in place
+ *
+ * Every interval the source is rendered into a scratch file and split
+ * into lines.  Each line is paired with the line of the previous frame
+ * that reads the same once its numbers are taken out, so rows may come
+ * and go without upsetting the rest.  Numbers which changed since the
+ * previous frame are highlighted or, in delta mode, replaced by their
+ * change.  The frame is cut to the terminal size that setwinsize()
+ * keeps up to date.
+ */
+
+#include <sys/types.h>
+
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "externs.h"
+
+#define WATCH_HOME	"\033[H"	/* cursor to top left */
+#define WATCH_CLEAR	"\033[H\033[2J"	/* clear screen */
+#define WATCH_EOL	"\033[K"	/* clear to end of line */
+#define WATCH_EOS	"\033[J"	/* clear to end of screen */
+#define WATCH_SO	"\033[7m"	/* standout */
+#define WATCH_SE	"\033[m"	/* standout end */
+
+struct frame {
+	char	*buf;
+	size_t	 bufsize;
+	char	**line;
+	size_t	 nline;
+	size_t	 linesize;
+};
+
+static volatile sig_atomic_t watch_stop;
+
+static void	watch_sig(int);
+static int	watch_capture(int, int (*)(FILE *, void *), void *,
+		    struct frame *);
+static int	watch_isnum(const char *, const char *);
+static const char *watch_nextnum(const char *, const char *);
+static int	watch_sameshape(const char *, const char *);
+static size_t	watch_putc(int, size_t, size_t);
+static void	watch_line(const char *, const char *, int, size_t);
+
+static void
+watch_sig(int signo)
+{
+	watch_stop = 1;
+}
+
+/*
+ * Run render with stdout pointing at the scratch file fd, which also
+ * catches the output of commands it runs, then load what it wrote into
+ * fr, one NUL terminated string per line.  Buffers only grow, so a
+ * steady state frame does not allocate.
+ */
+static int
+watch_capture(int fd, int (*render)(FILE *, void *), void *arg,
+    struct frame *fr)
+{
+	off_t len;
+	ssize_t r;
+	size_t n;
+	char *p, *end;
+	int saved;
+
+	if (ftruncate(fd, 0) == -1 || lseek(fd, 0, SEEK_SET) == -1) {
+		printf("%% watch: scratch file: %s\n", strerror(errno));
+		return(-1);
+	}
+
+	fflush(stdout);
+	if ((saved = dup(STDOUT_FILENO)) == -1) {
+		printf("%% watch: dup: %s\n", strerror(errno));
+		return(-1);
+	}
+	dup2(fd, STDOUT_FILENO);
+	(*render)(stdout, arg);
+	fflush(stdout);
+	dup2(saved, STDOUT_FILENO);
+	close(saved);
+
+	if ((len = lseek(fd, 0, SEEK_CUR)) == -1 ||
+	    lseek(fd, 0, SEEK_SET) == -1) {
+		printf("%% watch: scratch file: %s\n", strerror(errno));
+		return(-1);
+	}
+	if ((size_t)len + 1 > fr->bufsize) {
+		if ((p = realloc(fr->buf, len + 1)) == NULL) {
+			printf("%% watch: realloc: %s\n", strerror(errno));
+			return(-1);
+		}
+		fr->buf = p;
+		fr->bufsize = len + 1;
+	}
+	for (n = 0; n < (size_t)len; n += r)
+		if ((r = read(fd, fr->buf + n, len - n)) <= 0)
+			break;
+	fr->buf[n] = '\0';
+
+	fr->nline = 0;
+	for (p = fr->buf, end = fr->buf + n; p < end; p++) {
+		if (fr->nline == fr->linesize) {
+			size_t size = fr->linesize ? fr->linesize * 2 : 64;
+			char **l;
+
+			if ((l = reallocarray(fr->line, size,
+			    sizeof(*l))) == NULL) {
+				printf("%% watch: reallocarray: %s\n",
+				    strerror(errno));
+				return(-1);
+			}
+			fr->line = l;
+			fr->linesize = size;
+		}
+		fr->line[fr->nline++] = p;
+		if ((p = memchr(p, '\n', end - p)) == NULL)
+			break;
+		*p = '\0';
+	}
+
+	return(0);
+}
+
+/*
+ * Does a counter start at p?  Digits that are part of a name (em0), an
+ * address (10.0.0.1, fe80::1) or a scaled value (1.5M) do not count.
+ */
+static int
+watch_isnum(const char *line, const char *p)
+{
+	const char *q;
+
+	if (!isdigit((unsigned char)*p))
+		return(0);
+	if (p > line && (isalnum((unsigned char)p[-1]) || p[-1] == '.' ||
+	    p[-1] == ':' || p[-1] == '_' || p[-1] == '-'))
+		return(0);
+	for (q = p; isdigit((unsigned char)*q); q++)
+		;
+	if (isalpha((unsigned char)*q) || *q == '_' || *q == ':' ||
+	    (*q == '.' && isdigit((unsigned char)q[1])))
+		return(0);
+	return(1);
+}
+
+static const char *
+watch_nextnum(const char *line, const char *p)
+{
+	for (; *p != '\0'; p++) {
+		if (watch_isnum(line, p))
+			return(p);
+		/* skip the rest of a word that is not a counter */
+		while (isdigit((unsigned char)*p) &&
+		    isdigit((unsigned char)p[1]))
+			p++;
+	}
+	return(NULL);
+}
+
+/*
+ * Are a and b the same apart from their counters?
+ */
+static int
+watch_sameshape(const char *a, const char *b)
+{
+	const char *la = a, *lb = b;
+
+	for (;;) {
+		if (watch_isnum(la, a) && watch_isnum(lb, b)) {
+			while (isdigit((unsigned char)*a))
+				a++;
+			while (isdigit((unsigned char)*b))
+				b++;
+			continue;
+		}
+		if (*a != *b)
+			return(0);
+		if (*a == '\0')
+			return(1);
+		a++;
+		b++;
+	}
+}
+
+/*
+ * Print c unless the line is already full; returns the new column.
+ */
+static size_t
+watch_putc(int c, size_t col, size_t cols)
+{
+	size_t next = (c == '\t') ? (col + 8) & ~7 : col + 1;
+
+	if (next > cols)
+		return(cols);
+	if (c == '\t')
+		while (col < next) {
+			putchar(' ');
+			col++;
+		}
+	else
+		putchar(c);
+	return(next);
+}
+
+/*
+ * Print line, marking the counters that differ from those of prev,
+ * which has the same shape, or NULL if there is no previous line.
+ */
+static void
+watch_line(const char *line, const char *prev, int delta, size_t cols)
+{
+	const char *p, *num, *pnum = NULL, *s;
+	unsigned long long v, pv;
+	size_t col = 0, width;
+	char dbuf[32];
+	int changed;
+
+	for (p = line; *p != '\0' && col < cols; ) {
+		if ((num = watch_nextnum(line, p)) == NULL)
+			num = strchr(p, '\0');
+		while (p < num && col < cols)
+			col = watch_putc(*p++, col, cols);
+		if (*num == '\0' || col >= cols)
+			break;
+
+		if (prev != NULL &&
+		    (pnum = watch_nextnum(prev, pnum ? pnum : prev)) == NULL)
+			prev = NULL;
+		for (width = 0; isdigit((unsigned char)num[width]); width++)
+			;
+		v = strtoull(num, NULL, 10);
+		pv = pnum ? strtoull(pnum, NULL, 10) : v;
+		changed = (v != pv);
+
+		s = num;
+		if (delta && pnum != NULL) {
+			snprintf(dbuf, sizeof(dbuf), "%*lld", (int)width,
+			    (long long)(v - pv));
+			s = dbuf;
+			width = strlen(dbuf);
+		}
+		if (changed)
+			fputs(WATCH_SO, stdout);
+		while (width-- > 0 && col < cols)
+			col = watch_putc(*s++, col, cols);
+		if (changed)
+			fputs(WATCH_SE, stdout);
+
+		p = num;
+		while (isdigit((unsigned char)*p))
+			p++;
+		if (pnum != NULL)
+			while (isdigit((unsigned char)*pnum))
+				pnum++;
+	}
+	fputs(WATCH_EOL "\n", stdout);
+}
+
+/*
+ * Redraw render's output every interval seconds until q, ENTER or ^C;
+ * d toggles between counters and their change per refresh.
+ */
+int
+watch(char *title, int interval, int delta,
+    int (*render)(FILE *, void *), void *arg)
+{
+	struct frame frames[2], *cur = &frames[0], *prev = &frames[1], *tmp;
+	struct pollfd pfd;
+	struct tm *tm;
+	time_t t;
+	size_t i, j, next, rows, cols;
+	char path[PATH_MAX], stamp[sizeof("00:00:00")];
+	int fd, cbreak = 0, ret = 1;
+
+	memset(frames, 0, sizeof(frames));
+
+	strlcpy(path, "/tmp/nsh.watch.XXXXXXXX", sizeof(path));
+	if ((fd = mkstemp(path)) == -1) {
+		printf("%% watch: mkstemp %s: %s\n", path, strerror(errno));
+		return(1);
+	}
+	unlink(path);
+
+	watch_stop = 0;
+	if (signal(SIGINT, watch_sig) == SIG_ERR) {
+		printf("%% signal: %s\n", strerror(errno));
+		close(fd);
+		return(1);
+	}
+	if (interactive_mode && nsh_cbreak() == 0)
+		cbreak = 1;
+
+	pfd.fd = STDIN_FILENO;
+	pfd.events = POLLIN;
+
+	fputs(WATCH_CLEAR, stdout);
+	while (!watch_stop) {
+		if (watch_capture(fd, render, arg, cur) == -1)
+			goto done;
+		setwinsize(0);
+		rows = winsize.ws_row > 1 ? winsize.ws_row - 1 : 1;
+		cols = winsize.ws_col;
+
+		t = time(NULL);
+		if ((tm = localtime(&t)) == NULL ||
+		    strftime(stamp, sizeof(stamp), "%H:%M:%S", tm) == 0)
+			stamp[0] = '\0';
+		printf(WATCH_HOME "%% %.*s every %ds%s  %s" WATCH_EOL "\n",
+		    (int)(cols > 40 ? cols - 40 : 1), title, interval,
+		    delta ? ", changes" : "", stamp);
+
+		/* pair lines with the previous frame, in order */
+		for (i = j = 0; i < cur->nline && i + 1 < rows; i++) {
+			const char *pl = NULL;
+
+			for (next = j; next < prev->nline; next++)
+				if (watch_sameshape(cur->line[i],
+				    prev->line[next]))
+					break;
+			if (next < prev->nline) {
+				pl = prev->line[next];
+				j = next + 1;
+			}
+			watch_line(cur->line[i], pl, delta, cols);
+		}
+		fputs(WATCH_EOS, stdout);
+		fflush(stdout);
+
+		tmp = prev;
+		prev = cur;
+		cur = tmp;
+
+		switch (poll(&pfd, 1, interval * 1000)) {
+		case -1:
+			if (errno != EINTR) {
+				printf("%% poll: %s\n", strerror(errno));
+				goto done;
+			}
+			break;
+		case 0:
+			break;
+		default:
+			if (!cbreak) {
+				/* ENTER */
+				ret = 0;
+				goto done;
+			}
+			switch (getchar()) {
+			case 'd':
+				delta = !delta;
+				break;
+			case EOF:
+			case 'q':
+			case '\n':
+			case '\r':
+				ret = 0;
+				goto done;
+			}
+		}
+	}
+	ret = 0;
+
+ done:
+	if (cbreak)
+		nsh_nocbreak();
+	(void)signal(SIGINT, (sig_t)intr);
+	close(fd);
+	for (i = 0; i < nitems(frames); i++) {
+		free(frames[i].buf);
+		free(frames[i].line);
+	}
+	return(ret);
+}
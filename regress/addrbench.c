@@ -0,0 +1,239 @@
+/*
+ * addrbench: time the numeric address formatters of addrname.c
+ *
+ * Builds a table of synthetic prefixes, three IPv4 for every IPv6,
+ * with netmasks cut short the way the kernel hands them out, checks a
+ * few known answers and then times mask_prefixlen(), routename_r() and
+ * netname_r() over the whole table.
+ *
+ *	addrbench [count]
+ */
+
+#include <time.h>
+
+#include "externs.h"
+
+#define BENCH_COUNT	1000000
+
+struct prefix {
+	struct sockaddr_in6	dst;	/* or a sockaddr_in */
+	struct sockaddr_in6	mask;
+};
+
+static u_int64_t seed = 0x9e3779b97f4a7c15ULL;
+static int failed;
+
+static u_int64_t
+rnd(void)
+{
+	/* xorshift64 */
+	seed ^= seed << 13;
+	seed ^= seed >> 7;
+	seed ^= seed << 17;
+	return (seed);
+}
+
+/* stubs for what addrname.c borrows from the rest of nsh */
+const char *
+ifcache_name(u_int index)
+{
+	return (index == 2 ? "em0" : NULL);
+}
+
+char *
+link_print(struct sockaddr *sa)
+{
+	return ("");
+}
+
+/*
+ * Fill in a netmask of plen bits, with sa_len cut after the last
+ * non-zero byte as in routing messages.
+ */
+static void
+mkmask(int af, int plen, struct sockaddr_in6 *mask)
+{
+	u_char *p;
+	size_t off;
+	int i;
+
+	memset(mask, 0, sizeof(*mask));
+	if (af == AF_INET) {
+		off = offsetof(struct sockaddr_in, sin_addr);
+		p = (u_char *)&((struct sockaddr_in *)mask)->sin_addr;
+	} else {
+		off = offsetof(struct sockaddr_in6, sin6_addr);
+		p = (u_char *)&mask->sin6_addr;
+	}
+	for (i = 0; i < plen / 8; i++)
+		p[i] = 0xff;
+	if (plen % 8)
+		p[i++] = 0xff << (8 - plen % 8);
+	mask->sin6_family = af;
+	mask->sin6_len = off + i;
+}
+
+static void
+mkprefix(struct prefix *pfx)
+{
+	struct sockaddr_in *sin = (struct sockaddr_in *)&pfx->dst;
+	u_int64_t r = rnd();
+	int plen, i;
+
+	memset(&pfx->dst, 0, sizeof(pfx->dst));
+	if (r % 4 != 0) {
+		plen = 8 + (r >> 8) % 25;
+		sin->sin_len = sizeof(*sin);
+		sin->sin_family = AF_INET;
+		sin->sin_addr.s_addr = htonl((u_int32_t)(r >> 32) &
+		    (plen == 32 ? 0xffffffff : ~(0xffffffffU >> plen)));
+		mkmask(AF_INET, plen, &pfx->mask);
+	} else {
+		plen = 16 + (r >> 8) % 113;
+		pfx->dst.sin6_len = sizeof(pfx->dst);
+		pfx->dst.sin6_family = AF_INET6;
+		pfx->dst.sin6_addr.s6_addr[0] = 0x20;
+		pfx->dst.sin6_addr.s6_addr[1] = 0x01;
+		r = rnd();
+		for (i = 2; i < 16 && i < (plen + 7) / 8; i++)
+			pfx->dst.sin6_addr.s6_addr[i] = r >> (i % 8 * 8);
+		if (plen % 8 && i == (plen + 7) / 8)
+			pfx->dst.sin6_addr.s6_addr[i - 1] &=
+			    0xff << (8 - plen % 8);
+		mkmask(AF_INET6, plen, &pfx->mask);
+	}
+}
+
+static void
+check(const char *what, const char *got, const char *want)
+{
+	if (strcmp(got, want) != 0) {
+		printf("FAIL %s: \"%s\", want \"%s\"\n", what, got, want);
+		failed = 1;
+	}
+}
+
+static void
+known(void)
+{
+	struct sockaddr_in sin;
+	struct sockaddr_in6 sin6, mask;
+	char buf[ADDRNAMELEN];
+	int illegal;
+
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_len = sizeof(sin);
+	sin.sin_family = AF_INET;
+	inet_pton(AF_INET, "10.0.0.0", &sin.sin_addr);
+	mkmask(AF_INET, 8, &mask);
+	check("10/8", netname_r((struct sockaddr *)&sin,
+	    (struct sockaddr *)&mask, buf, sizeof(buf)), "10.0.0.0/8");
+
+	inet_pton(AF_INET, "192.168.1.0", &sin.sin_addr);
+	mkmask(AF_INET, 24, &mask);
+	check("192.168.1/24", netname_r((struct sockaddr *)&sin,
+	    (struct sockaddr *)&mask, buf, sizeof(buf)), "192.168.1.0/24");
+
+	/* default route: empty destination and mask */
+	sin.sin_len = 0;
+	mask.sin6_len = 0;
+	check("default", netname_r((struct sockaddr *)&sin,
+	    (struct sockaddr *)&mask, buf, sizeof(buf)), "0.0.0.0/0");
+
+	memset(&sin6, 0, sizeof(sin6));
+	sin6.sin6_len = sizeof(sin6);
+	sin6.sin6_family = AF_INET6;
+	inet_pton(AF_INET6, "2001:db8::", &sin6.sin6_addr);
+	mkmask(AF_INET6, 32, &mask);
+	check("2001:db8::/32", netname_r((struct sockaddr *)&sin6,
+	    (struct sockaddr *)&mask, buf, sizeof(buf)), "2001:db8::/32");
+
+	/* KAME embedded scope of interface 2 */
+	inet_pton(AF_INET6, "fe80:2::1", &sin6.sin6_addr);
+	check("fe80::1%em0", routename_r((struct sockaddr *)&sin6, buf,
+	    sizeof(buf)), "fe80::1%em0");
+
+	if (mask_prefixlen(AF_INET, NULL, NULL) != 32 ||
+	    mask_prefixlen(AF_INET6, NULL, NULL) != 128) {
+		printf("FAIL host mask\n");
+		failed = 1;
+	}
+	mkmask(AF_INET, 24, &mask);
+	((struct sockaddr_in *)&mask)->sin_addr.s_addr = htonl(0xff00ff00);
+	if (mask_prefixlen(AF_INET, (struct sockaddr *)&mask,
+	    &illegal) != 16 || !illegal) {
+		printf("FAIL non-contiguous mask\n");
+		failed = 1;
+	}
+	mkmask(AF_INET6, 65, &mask);
+	if (mask_prefixlen(AF_INET6, (struct sockaddr *)&mask,
+	    &illegal) != 65 || illegal) {
+		printf("FAIL /65 mask\n");
+		failed = 1;
+	}
+}
+
+static double
+since(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((now.tv_sec - start->tv_sec) +
+	    (now.tv_nsec - start->tv_nsec) / 1e9);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct prefix *pfx;
+	struct timespec start;
+	char buf[ADDRNAMELEN];
+	size_t count = BENCH_COUNT, i, sum = 0;
+	double secs;
+
+	if (argc > 1 && (count = strtoul(argv[1], NULL, 10)) == 0) {
+		fprintf(stderr, "usage: addrbench [count]\n");
+		return (1);
+	}
+
+	known();
+	if (failed)
+		return (1);
+
+	if ((pfx = calloc(count, sizeof(*pfx))) == NULL) {
+		perror("calloc");
+		return (1);
+	}
+	for (i = 0; i < count; i++)
+		mkprefix(&pfx[i]);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < count; i++)
+		sum += mask_prefixlen(pfx[i].dst.sin6_family,
+		    (struct sockaddr *)&pfx[i].mask, NULL);
+	secs = since(&start);
+	printf("mask_prefixlen  %zu prefixes %8.3f s %8.1f ns/call\n", count,
+	    secs, secs * 1e9 / count);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < count; i++)
+		sum += strlen(routename_r((struct sockaddr *)&pfx[i].dst, buf,
+		    sizeof(buf)));
+	secs = since(&start);
+	printf("routename_r     %zu prefixes %8.3f s %8.1f ns/call\n", count,
+	    secs, secs * 1e9 / count);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < count; i++)
+		sum += strlen(netname_r((struct sockaddr *)&pfx[i].dst,
+		    (struct sockaddr *)&pfx[i].mask, buf, sizeof(buf)));
+	secs = since(&start);
+	printf("netname_r       %zu prefixes %8.3f s %8.1f ns/call\n", count,
+	    secs, secs * 1e9 / count);
+
+	/* keep the work from being optimised away */
+	printf("checksum %zu\n", sum);
+	free(pfx);
+	return (0);
+}
@@ -0,0 +1,104 @@
+/*
+ * compat: build the pure modules of ../openbsd outside of OpenBSD
+ *
+ * Forced into every compile of this directory with -include.  On
+ * OpenBSD it only supplies what the nsh Makefile passes on the command
+ * line.  Elsewhere it pulls in the system headers first and then
+ * replaces the socket address structures with the BSD layout, which
+ * starts with a length byte, and adds the few OpenBSD names and guard
+ * macros that externs.h and the modules expect.
+ */
+
+#ifndef NSH_REGRESS_COMPAT_H
+#define NSH_REGRESS_COMPAT_H
+
+#ifndef NSH_VERSION
+#define NSH_VERSION	regress
+#endif
+
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include <net/if.h>
+#include <net/route.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef __OpenBSD__
+
+/* externs.h tests the OpenBSD header guards */
+#define _SYS_SOCKET_H_
+#define _NETINET_IN_H_
+#define _NETINET6_IN6_H_
+
+#ifndef AF_LINK
+#define AF_LINK		18
+#endif
+
+#ifndef IN6_IS_ADDR_MC_INTFACELOCAL
+#define IN6_IS_ADDR_MC_INTFACELOCAL(a)	IN6_IS_ADDR_MC_NODELOCAL(a)
+#endif
+
+struct bsd_sockaddr {
+	u_int8_t	sa_len;
+	u_int8_t	sa_family;
+	char		sa_data[14];
+};
+
+struct bsd_sockaddr_in {
+	u_int8_t	sin_len;
+	u_int8_t	sin_family;
+	u_int16_t	sin_port;
+	struct in_addr	sin_addr;
+	int8_t		sin_zero[8];
+};
+
+struct bsd_sockaddr_in6 {
+	u_int8_t	sin6_len;
+	u_int8_t	sin6_family;
+	u_int16_t	sin6_port;
+	u_int32_t	sin6_flowinfo;
+	struct in6_addr	sin6_addr;
+	u_int32_t	sin6_scope_id;
+};
+
+#define RTLABEL_LEN	32
+
+struct sockaddr_rtlabel {
+	u_int8_t	sr_len;
+	u_int8_t	sr_family;
+	char		sr_label[RTLABEL_LEN];
+};
+
+#define sockaddr	bsd_sockaddr
+#define sockaddr_in	bsd_sockaddr_in
+#define sockaddr_in6	bsd_sockaddr_in6
+
+#if defined(__GLIBC__) && !__GLIBC_PREREQ(2, 38)
+static inline size_t
+compat_strlcpy(char *dst, const char *src, size_t dsize)
+{
+	size_t len = strlen(src);
+
+	if (dsize != 0) {
+		if (len >= dsize)
+			dsize--;
+		else
+			dsize = len;
+		memcpy(dst, src, dsize);
+		dst[dsize] = '\0';
+	}
+	return (len);
+}
+#define strlcpy		compat_strlcpy
+#endif
+
+#endif /* !__OpenBSD__ */
+
+#endif /* NSH_REGRESS_COMPAT_H */
@@ -0,0 +1,141 @@
+/*
+ * ifratetest: feed synthetic counter snapshots through ifrate.c
+ *
+ * Checks the per second rates and their moving average, the top-N
+ * order for each sort key, counter resets, interfaces which go away and
+ * an interface index taken over by another interface.
+ */
+
+#include <math.h>
+
+#include "ifrate.h"
+
+static int failed;
+
+#define CHECK(c) do {							\
+	if (!(c)) {							\
+		printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #c);	\
+		failed = 1;						\
+	}								\
+} while (0)
+
+#define NEAR(a, b)	(fabs((a) - (b)) < 1e-6)
+
+static struct ifrate *
+find(struct ifrates *rates, const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < rates->nifr; i++)
+		if (strcmp(rates->ifr[i].name, name) == 0)
+			return (&rates->ifr[i]);
+	return (NULL);
+}
+
+static void
+sample(struct ifrates *rates, u_int index, const char *name,
+    u_int64_t ibytes, u_int64_t obytes, u_int64_t ipackets,
+    u_int64_t ierrors, double elapsed)
+{
+	struct ifrate_counters c;
+
+	memset(&c, 0, sizeof(c));
+	c.ibytes = ibytes;
+	c.obytes = obytes;
+	c.ipackets = ipackets;
+	c.ierrors = ierrors;
+	CHECK(ifrate_sample(rates, index, name, &c, elapsed) == 0);
+}
+
+int
+main(void)
+{
+	struct ifrates rates;
+	struct ifrate *top[8], *r;
+	size_t n;
+
+	ifrate_init(&rates, 0.5);
+
+	/* the first pass only takes a baseline */
+	ifrate_begin(&rates);
+	sample(&rates, 3, "lo0", 0, 0, 0, 0, 0);
+	sample(&rates, 1, "em0", 1000, 0, 10, 0, 0);
+	sample(&rates, 2, "em1", 1000, 0, 10, 0, 0);
+	ifrate_end(&rates);
+	CHECK(rates.nifr == 3);
+	/* kept sorted by index whatever order they come in */
+	CHECK(rates.ifr[0].index == 1 && rates.ifr[1].index == 2 &&
+	    rates.ifr[2].index == 3);
+	CHECK(rates.ifr[0].samples == 1);
+
+	/* one second later: the first rate is taken as it is */
+	ifrate_begin(&rates);
+	sample(&rates, 1, "em0", 2000, 500, 30, 0, 1.0);
+	sample(&rates, 2, "em1", 1500, 0, 110, 4, 1.0);
+	sample(&rates, 3, "lo0", 0, 0, 0, 0, 1.0);
+	ifrate_end(&rates);
+	r = find(&rates, "em0");
+	CHECK(r != NULL && r->samples == 2);
+	CHECK(NEAR(r->ibps, 8000) && NEAR(r->obps, 4000));
+	CHECK(NEAR(r->ipps, 20));
+	r = find(&rates, "em1");
+	CHECK(NEAR(r->ibps, 4000) && NEAR(r->ipps, 100) && NEAR(r->ierrs, 4));
+
+	n = ifrate_top(&rates, top, 2, IFRATE_SORT_BPS);
+	CHECK(n == 2);
+	CHECK(strcmp(top[0]->name, "em0") == 0);
+	CHECK(strcmp(top[1]->name, "em1") == 0);
+	ifrate_top(&rates, top, 3, IFRATE_SORT_PPS);
+	CHECK(strcmp(top[0]->name, "em1") == 0);
+	ifrate_top(&rates, top, 3, IFRATE_SORT_ERRORS);
+	CHECK(strcmp(top[0]->name, "em1") == 0);
+
+	/* two seconds later: alpha 0.5 averages the old and new rates */
+	ifrate_begin(&rates);
+	sample(&rates, 1, "em0", 2000, 500, 30, 0, 2.0);
+	sample(&rates, 2, "em1", 5500, 0, 110, 4, 2.0);
+	sample(&rates, 3, "lo0", 0, 0, 0, 0, 2.0);
+	ifrate_end(&rates);
+	r = find(&rates, "em0");
+	CHECK(NEAR(r->ibps, 4000) && NEAR(r->obps, 2000));
+	r = find(&rates, "em1");
+	CHECK(NEAR(r->ibps, 0.5 * 16000 + 0.5 * 4000));
+	ifrate_top(&rates, top, 3, IFRATE_SORT_BPS);
+	CHECK(strcmp(top[0]->name, "em1") == 0);
+	CHECK(strcmp(top[1]->name, "em0") == 0);
+	CHECK(strcmp(top[2]->name, "lo0") == 0);
+
+	/*
+	 * em0 was reset, so its counters went backwards and it starts
+	 * over; lo0 is gone; index 2 now belongs to vlan5.
+	 */
+	ifrate_begin(&rates);
+	sample(&rates, 1, "em0", 100, 0, 1, 0, 1.0);
+	sample(&rates, 2, "vlan5", 9000, 0, 0, 0, 1.0);
+	ifrate_end(&rates);
+	CHECK(rates.nifr == 2);
+	CHECK(find(&rates, "lo0") == NULL);
+	CHECK(find(&rates, "em1") == NULL);
+	r = find(&rates, "em0");
+	CHECK(r->samples == 1);
+	r = find(&rates, "vlan5");
+	CHECK(r != NULL && r->samples == 1 && r->ibps == 0);
+	/* interfaces without a rate yet sort last, then by index */
+	n = ifrate_top(&rates, top, 8, IFRATE_SORT_BPS);
+	CHECK(n == 2);
+	CHECK(top[0]->index == 1 && top[1]->index == 2);
+
+	/* no time passed: the sample is only a new baseline */
+	ifrate_begin(&rates);
+	sample(&rates, 1, "em0", 200, 0, 2, 0, 0);
+	sample(&rates, 2, "vlan5", 9000, 0, 0, 0, 0);
+	ifrate_end(&rates);
+	CHECK(find(&rates, "em0")->samples == 1);
+
+	ifrate_free(&rates);
+	CHECK(rates.nifr == 0 && rates.ifr == NULL);
+
+	if (!failed)
+		printf("ifratetest: ok\n");
+	return (failed);
+}
@@ -0,0 +1,264 @@
+/*
+ * ifstatus: "show interface status" over a synthetic snapshot
+ *
+ * Builds a getifaddrs(3) style list of count interfaces, each AF_LINK
+ * entry followed by an IPv4 and an IPv6 address.  ioctl(2) is replaced
+ * by a stub which answers the rdomain and media requests, so no kernel
+ * is involved.
+ *
+ * The check: show_int_status_list() over the whole snapshot must print
+ * the same rows, in order, as show_int_status() does for each interface
+ * handed over on its own, without the rest of the snapshot.  Interfaces
+ * differ in state, link state and rdomain so a row taken from the wrong
+ * entry shows up.  The exit status depends on this check only.
+ *
+ * Then show_int_status_list() is timed over growing prefixes of the
+ * snapshot and the time per interface is reported, which should not
+ * grow with the number of interfaces.
+ *
+ *	ifstatus [count]
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <sys/sockio.h>
+
+#include <net/if.h>
+#include <net/if_dl.h>
+#include <net/if_media.h>
+#include <net/if_types.h>
+#include <netinet/in.h>
+
+#include <errno.h>
+#include <ifaddrs.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "externs.h"
+
+void	show_int_status(struct ifaddrs *, int, FILE *);
+
+#define IFSTATUS_COUNT	5000
+#define IFSTATUS_RUNS	3	/* best of */
+
+struct fixture {
+	struct ifaddrs		*ifa;	/* 3 per interface */
+	struct sockaddr_dl	*sdl;
+	struct sockaddr_in	*sin;
+	struct sockaddr_in6	*sin6;
+	struct if_data		*ifd;
+	char			(*name)[IFNAMSIZ];
+	size_t			 count;
+};
+
+/*
+ * Answer for every interface without asking the kernel.
+ */
+int
+ioctl(int fd, unsigned long request, ...)
+{
+	struct ifmediareq *ifmr;
+	struct ifreq *ifr;
+	va_list ap;
+	void *arg;
+
+	va_start(ap, request);
+	arg = va_arg(ap, void *);
+	va_end(ap);
+
+	switch (request) {
+	case SIOCGIFRDOMAIN:
+		/* vlanN is in rdomain N % 4 */
+		ifr = arg;
+		ifr->ifr_rdomainid = strtoul(ifr->ifr_name + 4, NULL, 10) % 4;
+		return (0);
+	case SIOCGIFMEDIA:
+		ifmr = arg;
+		ifmr->ifm_current = IFM_ETHER | IFM_AUTO;
+		ifmr->ifm_active = IFM_ETHER | IFM_1000_T | IFM_FDX;
+		ifmr->ifm_status = IFM_AVALID | IFM_ACTIVE;
+		if (ifmr->ifm_ulist != NULL && ifmr->ifm_count > 0)
+			ifmr->ifm_ulist[0] = IFM_ETHER | IFM_AUTO;
+		ifmr->ifm_count = 1;
+		return (0);
+	}
+	errno = ENOTTY;
+	return (-1);
+}
+
+static void
+fixture_init(struct fixture *f, size_t count)
+{
+	struct ifaddrs *ifa;
+	size_t i;
+
+	f->count = count;
+	if ((f->ifa = calloc(count * 3, sizeof(*f->ifa))) == NULL ||
+	    (f->sdl = calloc(count, sizeof(*f->sdl))) == NULL ||
+	    (f->sin = calloc(count, sizeof(*f->sin))) == NULL ||
+	    (f->sin6 = calloc(count, sizeof(*f->sin6))) == NULL ||
+	    (f->ifd = calloc(count, sizeof(*f->ifd))) == NULL ||
+	    (f->name = calloc(count, sizeof(*f->name))) == NULL) {
+		perror("calloc");
+		exit(1);
+	}
+
+	for (i = 0; i < count; i++) {
+		snprintf(f->name[i], IFNAMSIZ, "vlan%zu", i);
+
+		f->sdl[i].sdl_len = sizeof(f->sdl[i]);
+		f->sdl[i].sdl_family = AF_LINK;
+		f->sdl[i].sdl_index = i + 1;
+		f->sdl[i].sdl_type = IFT_L2VLAN;
+		f->ifd[i].ifi_type = IFT_L2VLAN;
+		f->ifd[i].ifi_link_state = i % 3 ? LINK_STATE_FULL_DUPLEX :
+		    LINK_STATE_DOWN;
+		f->ifd[i].ifi_mtu = 1500;
+
+		f->sin[i].sin_len = sizeof(f->sin[i]);
+		f->sin[i].sin_family = AF_INET;
+		f->sin[i].sin_addr.s_addr = htonl(0x0a000001 + (i << 8));
+
+		f->sin6[i].sin6_len = sizeof(f->sin6[i]);
+		f->sin6[i].sin6_family = AF_INET6;
+		f->sin6[i].sin6_addr.s6_addr[0] = 0xfe;
+		f->sin6[i].sin6_addr.s6_addr[1] = 0x80;
+		f->sin6[i].sin6_addr.s6_addr[15] = 1;
+
+		ifa = &f->ifa[i * 3];
+		ifa[0].ifa_name = ifa[1].ifa_name = ifa[2].ifa_name =
+		    f->name[i];
+		ifa[0].ifa_flags = ifa[1].ifa_flags = ifa[2].ifa_flags =
+		    i % 2 ? IFF_BROADCAST : IFF_UP | IFF_RUNNING | IFF_BROADCAST;
+		ifa[0].ifa_addr = (struct sockaddr *)&f->sdl[i];
+		ifa[0].ifa_data = &f->ifd[i];
+		ifa[1].ifa_addr = (struct sockaddr *)&f->sin[i];
+		ifa[2].ifa_addr = (struct sockaddr *)&f->sin6[i];
+		ifa[0].ifa_next = &ifa[1];
+		ifa[1].ifa_next = &ifa[2];
+		ifa[2].ifa_next = i + 1 < count ? &ifa[3] : NULL;
+	}
+}
+
+/*
+ * Compare the rows for the whole snapshot with a header and then a row
+ * for each interface on its own, from a copy of its AF_LINK entry with
+ * nothing after it.  Returns 0 if they are the same.
+ */
+static int
+fixture_check(struct fixture *f)
+{
+	struct ifaddrs one;
+	char name[IFNAMSIZ], *all, *expect, *a, *e;
+	FILE *out;
+	size_t alllen, expectlen, i, rows = 0;
+	int bad = 0;
+
+	if ((out = open_memstream(&all, &alllen)) == NULL) {
+		perror("open_memstream");
+		exit(1);
+	}
+	show_int_status_list(f->ifa, -1, out);
+	fclose(out);
+
+	if ((out = open_memstream(&expect, &expectlen)) == NULL) {
+		perror("open_memstream");
+		exit(1);
+	}
+	show_int_status_list(NULL, -1, out);
+	for (i = 0; i < f->count; i++) {
+		one = f->ifa[i * 3];
+		strlcpy(name, f->name[i], sizeof(name));
+		one.ifa_name = name;
+		one.ifa_next = NULL;
+		show_int_status(&one, -1, out);
+	}
+	fclose(out);
+
+	for (a = all, e = expect; *a != '\0' && *a == *e; a++, e++)
+		if (*a == '\n')
+			rows++;
+	if (*a != *e) {
+		bad = 1;
+		while (a > all && a[-1] != '\n')
+			a--, e--;
+		printf("FAIL line %zu: %.*s\n  expected: %.*s\n", rows + 1,
+		    (int)strcspn(a, "\n"), a, (int)strcspn(e, "\n"), e);
+	} else if (rows != f->count + 1) {
+		bad = 1;
+		printf("FAIL %zu lines for %zu interfaces\n", rows, f->count);
+	}
+	free(all);
+	free(expect);
+	return (bad);
+}
+
+/*
+ * Best time of show_int_status_list() over the first n interfaces.
+ */
+static double
+fixture_time(struct fixture *f, size_t n, FILE *out)
+{
+	struct ifaddrs *last = &f->ifa[n * 3 - 1], *next = last->ifa_next;
+	struct timespec start, end;
+	double secs, best = 0;
+	int run;
+
+	last->ifa_next = NULL;
+	for (run = 0; run < IFSTATUS_RUNS; run++) {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		show_int_status_list(f->ifa, -1, out);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		secs = (end.tv_sec - start.tv_sec) +
+		    (end.tv_nsec - start.tv_nsec) / 1e9;
+		if (run == 0 || secs < best)
+			best = secs;
+	}
+	last->ifa_next = next;
+	return (best);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct fixture f;
+	const char *errstr;
+	FILE *out;
+	size_t count = IFSTATUS_COUNT, n;
+	double secs, first = 0, per = 0;
+
+	if (argc > 1) {
+		count = strtonum(argv[1], 10, 1000000, &errstr);
+		if (errstr) {
+			fprintf(stderr, "usage: ifstatus [count]\n");
+			return (1);
+		}
+	}
+	if ((out = fopen("/dev/null", "w")) == NULL) {
+		perror("/dev/null");
+		return (1);
+	}
+	fixture_init(&f, count);
+
+	if (fixture_check(&f) != 0)
+		return (1);
+	printf("ifstatus: %zu rows ok\n", count);
+
+	printf("%12s %10s %14s\n", "interfaces", "seconds", "us/interface");
+	for (n = count / 5; n <= count; n += count / 5) {
+		secs = fixture_time(&f, n, out);
+		per = secs * 1e6 / n;
+		if (first == 0)
+			first = per;
+		printf("%12zu %10.4f %14.2f\n", n, secs, per);
+	}
+
+	/* reported only, wall clock time is too noisy to fail on */
+	if (first > 0)
+		printf("last/first time per interface: %.2f\n", per / first);
+	return (0);
+}
@@ -0,0 +1,4 @@
+/* nsh's main.c with its main() renamed, so ifstatus can have its own */
+int	nsh_main(int, char *[]);
+#define main	nsh_main
+#include "main.c"
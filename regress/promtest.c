@@ -0,0 +1,119 @@
+/*
+ * promtest: drive prom.c with synthetic collectors
+ *
+ * The rendered scrape is compared with the exposition expected, which
+ * covers name sanitising, the escaping of help and label values and
+ * a family announced again by the next collector, and then checked to
+ * have exactly one TYPE line per family, announced before its samples.
+ */
+
+#include "prom.h"
+
+static int failed;
+
+static void
+coll_ifs(struct prom *p)
+{
+	prom_family(p, "nsh_if_ibytes_total", "counter",
+	    "bytes \\ received\nby \"interface\"");
+	prom_sample(p, 1234, "interface", "em0", NULL);
+	prom_sample(p, 18446744073709551615ULL, "interface", "a\"b\\c\nd",
+	    "description", "", NULL);
+	prom_family(p, "nsh_if_up", "gauge", NULL);
+	prom_sample(p, 1, "interface", "em0", NULL);
+}
+
+static void
+coll_more_ifs(struct prom *p)
+{
+	/* the family the previous collector ended with carries on */
+	prom_family(p, "nsh_if_up", "gauge", NULL);
+	prom_sample(p, 0, "interface", "em1", NULL);
+}
+
+static void
+coll_names(struct prom *p)
+{
+	prom_family(p, "9tcp-stats.x", "counter", NULL);
+	prom_sample(p, 7, NULL);
+	prom_family(p, "nsh:ok_Name9", "untyped", "help");
+	prom_sample(p, 0, "a", "1", "b", "2", "c", "3", NULL);
+}
+
+static void (*const collectors[])(struct prom *) = {
+	coll_ifs, coll_more_ifs, coll_names,
+};
+
+static const char expect[] =
+	"# HELP nsh_if_ibytes_total bytes \\\\ received\\nby \"interface\"\n"
+	"# TYPE nsh_if_ibytes_total counter\n"
+	"nsh_if_ibytes_total{interface=\"em0\"} 1234\n"
+	"nsh_if_ibytes_total{interface=\"a\\\"b\\\\c\\nd\",description=\"\"}"
+	    " 18446744073709551615\n"
+	"# TYPE nsh_if_up gauge\n"
+	"nsh_if_up{interface=\"em0\"} 1\n"
+	"nsh_if_up{interface=\"em1\"} 0\n"
+	"# TYPE _tcp_stats_x counter\n"
+	"_tcp_stats_x 7\n"
+	"# HELP nsh:ok_Name9 help\n"
+	"# TYPE nsh:ok_Name9 untyped\n"
+	"nsh:ok_Name9{a=\"1\",b=\"2\",c=\"3\"} 0\n";
+
+/*
+ * Every sample must follow the one TYPE line of its family, and no
+ * family may be announced twice.
+ */
+static void
+onetype(char *buf)
+{
+	char types[16][PROM_NAMELEN], *line, *name;
+	size_t ntypes = 0, i, len;
+
+	for (line = strtok(buf, "\n"); line != NULL;
+	    line = strtok(NULL, "\n")) {
+		if (strncmp(line, "# HELP ", 7) == 0)
+			continue;
+		if (strncmp(line, "# TYPE ", 7) == 0) {
+			name = line + 7;
+			len = strcspn(name, " ");
+			for (i = 0; i < ntypes; i++)
+				if (strlen(types[i]) == len &&
+				    strncmp(types[i], name, len) == 0) {
+					printf("FAIL second TYPE for %.*s\n",
+					    (int)len, name);
+					failed = 1;
+				}
+			if (ntypes < 16)
+				snprintf(types[ntypes++], PROM_NAMELEN, "%.*s",
+				    (int)len, name);
+			continue;
+		}
+		len = strcspn(line, "{ ");
+		if (ntypes == 0 || strlen(types[ntypes - 1]) != len ||
+		    strncmp(types[ntypes - 1], line, len) != 0) {
+			printf("FAIL sample outside its family: %s\n", line);
+			failed = 1;
+		}
+	}
+}
+
+int
+main(void)
+{
+	char *buf;
+	size_t len;
+
+	if (prom_render(collectors, sizeof(collectors) /
+	    sizeof(collectors[0]), &buf, &len) == -1)
+		return (1);
+	if (len != strlen(buf) || strcmp(buf, expect) != 0) {
+		printf("FAIL rendered:\n%s\nexpected:\n%s", buf, expect);
+		failed = 1;
+	}
+	onetype(buf);
+	free(buf);
+
+	if (!failed)
+		printf("promtest: ok\n");
+	return (failed);
+}